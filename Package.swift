@@ -24,6 +24,9 @@ let package = Package(
         .target(
             name: "RubyGatewayHelpers",
             dependencies: ["CRuby"]),
+        .executableTarget(
+            name: "RubyGatewayBenchmarks",
+            dependencies: ["RubyGateway"]),
         .testTarget(
             name: "RubyGatewayTests",
             dependencies: ["RubyGateway"],
@@ -31,7 +31,84 @@ func RB_ULONG2NUM(_ x: UInt) -> VALUE    { return rb_ulong2num_inline(x) }
 // MARK: - Floating point conversions
 
 // From platform to NUM -- FLONUM or CLASS(FLOAT) depending
-func DBL2NUM(_ dbl: Double) -> VALUE { return rb_float_new(dbl) }
+func DBL2NUM(_ dbl: Double) -> VALUE {
+    if let flonum = RB_DBL2FLONUM(dbl) {
+        return flonum
+    }
+    return rb_float_new(dbl)
+}
+
+// MARK: - Immediate tagging
+
+// Special constants are tagged in their low bits.  These mirror the macros
+// and inlines from ruby.h (2.x) / ruby/internal/special_consts.h (3.x) so
+// the common numeric cases don't need to call into Ruby at all.
+//
+// Flonums only exist on 64-bit platforms, and only if Ruby was built with
+// `USE_FLONUM` -- which is the default.
+
+let RB_USE_FLONUM = rbg_use_flonum() != 0
+let RUBY_IMMEDIATE_MASK: VALUE = RB_USE_FLONUM ? 0x07 : 0x03
+let RUBY_FIXNUM_FLAG: VALUE = 0x01
+let RUBY_FLONUM_MASK: VALUE = 0x03
+let RUBY_FLONUM_FLAG: VALUE = 0x02
+
+let RUBY_FIXNUM_MAX = Int.max >> 1
+let RUBY_FIXNUM_MIN = Int.min >> 1
+
+func RB_SPECIAL_CONST_P(_ x: VALUE) -> Bool {
+    return (x & RUBY_IMMEDIATE_MASK) != 0 || (x & ~Qnil) == 0
+}
+
+func RB_FIXNUM_P(_ x: VALUE) -> Bool {
+    return (x & RUBY_FIXNUM_FLAG) != 0
+}
+
+func RB_FIXABLE(_ x: Int) -> Bool {
+    return x >= RUBY_FIXNUM_MIN && x <= RUBY_FIXNUM_MAX
+}
+
+func RB_FIX2LONG(_ x: VALUE) -> Int {
+    return Int(bitPattern: x) >> 1
+}
+
+/// Caller checks `RB_FIXABLE()`
+func RB_LONG2FIX(_ x: Int) -> VALUE {
+    return (VALUE(bitPattern: x) << 1) | RUBY_FIXNUM_FLAG
+}
+
+func RB_FLONUM_P(_ x: VALUE) -> Bool {
+    return RB_USE_FLONUM && (x & RUBY_FLONUM_MASK) == RUBY_FLONUM_FLAG
+}
+
+/// rb_float_flonum_value -- caller checks `RB_FLONUM_P()`
+func RB_FLONUM2DBL(_ x: VALUE) -> Double {
+    guard x != 0x8000000000000002 else {
+        return 0.0
+    }
+    let b63 = x >> 63
+    // e: xx1... -> 011...
+    //    xx0... -> 100...
+    //      ^b63
+    let t = (2 &- b63) | (x & ~0x03)
+    return Double(bitPattern: UInt64((t >> 3) | (t << 61)))
+}
+
+/// rb_float_new_inline without the heap fallback -- `nil` if `dbl` can't be a flonum
+func RB_DBL2FLONUM(_ dbl: Double) -> VALUE? {
+    guard RB_USE_FLONUM else {
+        return nil
+    }
+    let v = VALUE(dbl.bitPattern)
+    let bits = Int((v >> 60) & 0x7)
+    if v != 0x3000000000000000 /* 1.72723e-77 */ && ((bits - 3) & ~0x01) == 0 {
+        return (((v << 3) | (v >> 61)) & ~0x01) | 0x02
+    } else if v == 0 {
+        // +0.0
+        return 0x8000000000000002
+    }
+    return nil
+}
 
 // MARK: - Useful VALUE constants and macros
 
@@ -35,3 +35,48 @@ final class Lock {
         return try call()
     }
 }
+
+/// Dumb pthread condition variable wrapper, with its own mutex.
+final class Condition {
+    private var mutex = pthread_mutex_t()
+    private var cond = pthread_cond_t()
+
+    init() {
+        pthread_mutex_init(&mutex, nil)
+        pthread_cond_init(&cond, nil)
+    }
+
+    func locked<T>(call: () throws -> T) rethrows -> T {
+        pthread_mutex_lock(&mutex)
+        defer { pthread_mutex_unlock(&mutex) }
+        return try call()
+    }
+
+    /// Call from inside `locked(call:)`
+    func wait() {
+        pthread_cond_wait(&cond, &mutex)
+    }
+
+    /// Call from inside `locked(call:)`
+    func broadcast() {
+        pthread_cond_broadcast(&cond)
+    }
+}
+
+/// Dumb pthread thread-specific counter.
+final class ThreadLocalCount {
+    private var key = pthread_key_t()
+
+    init() {
+        pthread_key_create(&key, nil)
+    }
+
+    var value: Int {
+        get {
+            return Int(bitPattern: pthread_getspecific(key))
+        }
+        set {
+            pthread_setspecific(key, UnsafeRawPointer(bitPattern: newValue))
+        }
+    }
+}
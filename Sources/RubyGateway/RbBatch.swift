@@ -0,0 +1,237 @@
+//
+//  RbBatch.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+@_implementationOnly import CRuby
+@_implementationOnly import RubyGatewayHelpers
+
+/// A handle to the result of one operation in an `RbBatch`.
+public struct RbBatchItem<Result> {
+    /// The position of the operation in its batch.
+    public let index: Int
+}
+
+/// A list of Ruby operations that run together under a single Ruby
+/// exception handler.
+///
+/// Each time RubyGateway calls Ruby it sets up an exception handler and
+/// checks the result.  When you need to make many calls together, for example
+/// to read all the fields of a record, it can be faster to queue them in a
+/// batch and run them in one go:
+/// ```swift
+/// let batch = RbBatch()
+/// let name = try batch.call(record, "name")
+/// let size = batch.convert(try record.get("size"), to: Int.self)
+/// try batch.run()
+/// print(batch[name], batch[size])
+/// ```
+///
+/// Operations run in the order they are queued.  The operations are
+/// independent: you cannot use the result of one as the input to another
+/// in the same batch.
+///
+/// If an operation raises an exception then the batch stops.  `run()`
+/// throws the error and `failedIndex` says which operation failed: results
+/// are available for the operations before it.
+///
+/// A batch can be run more than once, each run replacing the results of the
+/// previous one.
+public final class RbBatch {
+    /// The operations, `value` and `argv` only valid during `run()`
+    private var ops: [Rbg_batch_op] = []
+    /// The receiver of each op
+    private var receivers: [RbObjectAccess] = []
+    /// Offset of each op's args in `argValues`
+    private var argOffsets: [Int] = []
+    /// All args for all ops, only valid during `run()`
+    private var argValues: [VALUE] = []
+    /// The objects for `argValues`
+    private var argObjects: [RbObject] = []
+    /// Call sites to keep alive
+    private var retained: [AnyObject] = []
+    /// Ruby array holding all result `VALUE`s from the last run
+    private var results: RbObject?
+
+    /// The number of operations that completed successfully in the last run.
+    public private(set) var completedCount = 0
+
+    /// The index of the operation that failed in the last run, or `nil` if
+    /// they all succeeded.
+    public private(set) var failedIndex: Int?
+
+    /// Create an empty batch.
+    public init() {
+    }
+
+    /// The number of operations in the batch.
+    public var count: Int {
+        return ops.count
+    }
+
+    private func add<T>(job: Rbg_batch_job, receiver: RbObjectAccess, id: ID = 0, args: [RbObject] = [], kwArgs: Bool = false) -> RbBatchItem<T> {
+        var op = Rbg_batch_op()
+        op.job = job
+        op.id = id
+        op.argc = Int32(args.count)
+        op.kwArgs = kwArgs ? 1 : 0
+        ops.append(op)
+        receivers.append(receiver)
+        argOffsets.append(argValues.count)
+        argValues.append(contentsOf: repeatElement(Qnil, count: args.count))
+        argObjects.append(contentsOf: args)
+        return RbBatchItem(index: ops.count - 1)
+    }
+
+    // MARK: - Operations
+
+    /// Queue a method call.
+    ///
+    /// - parameter receiver: The object to call the method on.
+    /// - parameter methodName: The name of the method to call.
+    /// - parameter args: The positional arguments to the method.  None by default.
+    /// - parameter kwArgs: The keyword arguments to the method.  None by default.
+    /// - returns: A handle to retrieve the result of the call after `run()`.
+    /// - throws: `RbError.rubyException(_:)` if Ruby has a problem with the method name.
+    ///           `RbError.duplicateKwArg(_:)` if there are duplicate keywords in `kwArgs`.
+    @discardableResult
+    public func call(_ receiver: RbObjectAccess,
+                     _ methodName: String,
+                     args: [RbObjectConvertible?] = [],
+                     kwArgs: KeyValuePairs<String, RbObjectConvertible?> = [:]) throws -> RbBatchItem<RbObject> {
+        try Ruby.setup()
+        let methodId = try Ruby.getID(for: methodName)
+        let argObjects = try RbObjectAccess.flattenArgs(args: args, kwArgs: kwArgs)
+        return add(job: RBG_BATCH_FUNCALLV, receiver: receiver, id: methodId,
+                   args: argObjects, kwArgs: kwArgs.count > 0)
+    }
+
+    /// Queue a call through a call site.
+    ///
+    /// - parameter callSite: The call site to use.
+    /// - parameter args: The arguments to pass.  There must be `callSite.arity` of them.
+    /// - returns: A handle to retrieve the result of the call after `run()`.
+    /// - throws: `RbError.badParameter(_:)` if the wrong number of arguments is passed.
+    @discardableResult
+    public func call(_ callSite: RbCallSite, args: [RbObjectConvertible?] = []) throws -> RbBatchItem<RbObject> {
+        guard args.count == callSite.arity else {
+            try RbError.raise(error: .badParameter("Call site \(callSite.methodName) has arity \(callSite.arity), passed \(args.count) args."))
+        }
+        retained.append(callSite)
+        return add(job: RBG_BATCH_FUNCALLV, receiver: callSite.receiver, id: callSite.methodId,
+                   args: args.map { $0.rubyObject })
+    }
+
+    private func add<T>(job: Rbg_batch_job, object: RbObject) -> RbBatchItem<T> {
+        return add(job: job, receiver: object)
+    }
+
+    /// Queue a conversion to `Int`, as `Int.init?(_:)`.
+    /// - returns: A handle to retrieve the result after `run()`.
+    @discardableResult
+    public func convert(_ object: RbObject, to type: Int.Type) -> RbBatchItem<Int> {
+        return add(job: RBG_BATCH_TO_LONG, object: object)
+    }
+
+    /// Queue a conversion to `Double`, as `Double.init?(_:)`.
+    /// - returns: A handle to retrieve the result after `run()`.
+    @discardableResult
+    public func convert(_ object: RbObject, to type: Double.Type) -> RbBatchItem<Double> {
+        return add(job: RBG_BATCH_TO_DOUBLE, object: object)
+    }
+
+    /// Queue a conversion to `String`, as `String.init?(_:)`.
+    /// - returns: A handle to retrieve the result after `run()`.
+    @discardableResult
+    public func convert(_ object: RbObject, to type: String.Type) -> RbBatchItem<String> {
+        return add(job: RBG_BATCH_STRING, object: object)
+    }
+
+    /// Queue a call to `inspect`, as `RbObject.debugDescription`.
+    /// - returns: A handle to retrieve the result after `run()`.
+    @discardableResult
+    public func inspect(_ object: RbObject) -> RbBatchItem<String> {
+        return add(job: RBG_BATCH_INSPECT, object: object)
+    }
+
+    // MARK: - Running
+
+    /// Run all the operations in the batch.
+    ///
+    /// - throws: `RbError.rubyException(_:)` if an operation raises an exception.
+    ///           The batch stops at that point, see `failedIndex`.
+    public func run() throws {
+        try Ruby.setup()
+        let resultsValue = rb_ary_new_capa(ops.count)
+        results = RbObject(rubyValue: resultsValue)
+        completedCount = 0
+        failedIndex = nil
+
+        var completed = 0
+        defer {
+            completedCount = completed
+            if completed < ops.count {
+                failedIndex = completed
+            }
+        }
+
+        // Objects are held by `RbObject`s so `GC.compact` can move them
+        // between runs: fetch the current `VALUE`s and keep them still
+        // while the batch runs.
+        for i in 0..<ops.count {
+            ops[i].value = receivers[i].getValue()
+        }
+        for i in 0..<argObjects.count {
+            argValues[i] = argObjects[i].withRubyValue { $0 }
+        }
+        let pinned = receivers.compactMap { $0 as? RbObject } + argObjects
+        pinned.forEach { $0.pin() }
+        defer { pinned.forEach { $0.unpin() } }
+
+        try argValues.withUnsafeBufferPointer { argsBuffer in
+            for i in 0..<ops.count where ops[i].argc > 0 {
+                ops[i].argv = argsBuffer.baseAddress! + argOffsets[i]
+            }
+            try ops.withUnsafeMutableBufferPointer { opsBuffer in
+                try RbVM.doProtectBatch(ops: opsBuffer, keep: resultsValue, completed: &completed)
+            }
+        }
+    }
+
+    // MARK: - Results
+
+    private func result(_ index: Int) -> Rbg_batch_op {
+        precondition(index < completedCount, "RbBatch result \(index) not available, completed \(completedCount)")
+        return ops[index]
+    }
+
+    /// Result `VALUE`s are read from `results` because `GC.compact` can move them.
+    private func valueResult(_ index: Int) -> VALUE {
+        precondition(index < completedCount, "RbBatch result \(index) not available, completed \(completedCount)")
+        return results!.withRubyValue { rb_ary_entry($0, index) }
+    }
+
+    /// The result of a method call.
+    public subscript(item: RbBatchItem<RbObject>) -> RbObject {
+        return RbObject(rubyValue: valueResult(item.index))
+    }
+
+    /// The result of an `Int` conversion.
+    public subscript(item: RbBatchItem<Int>) -> Int {
+        return result(item.index).longResult
+    }
+
+    /// The result of a `Double` conversion.
+    public subscript(item: RbBatchItem<Double>) -> Double {
+        return result(item.index).doubleResult
+    }
+
+    /// The result of a `String` conversion or `inspect`, or `nil` if the
+    /// Ruby string is not valid UTF-8.
+    public subscript(item: RbBatchItem<String>) -> String? {
+        let stringValue = valueResult(item.index)
+        return String(utf8Bytes: UnsafeRawBufferPointer(start: rbg_RSTRING_PTR(stringValue),
+                                                        count: rbg_RSTRING_LEN(stringValue)))
+    }
+}
@@ -36,6 +36,17 @@
 //      `CALL_FCALL` like `rb_funcallv`.  So yuck, we have to do this
 //      proxy thing to provide similar level of function.
 //
+// 3) Call Ruby method passing a borrowed-args Swift closure as block.
+//    * RbBlock.doBorrowedBlockCall(...) puts an RbBorrowedBlockContext
+//      on the stack to hold the closure -- no heap context, no retention
+//      options because the closure can't outlive the call.
+//    * Call rb_block_call() with a pointer to that struct which ends up
+//      in rbproc_borrowed_block_callback() whenever Ruby invokes the
+//      block.
+//    * Pass the yielded VALUEs straight to the closure, no RbObjects.
+//    * Swift errors that aren't about Ruby are stashed in the context
+//      and thrown again once rb_block_call() returns.
+//
 
 /// The type of a block implemented in Swift.
 ///
@@ -119,6 +130,8 @@ private func rbproc_pvoid_block_callback(rawContext: UnsafeMutableRawPointer,
                                          argc: Int32, argv: UnsafePointer<VALUE>,
                                          blockArg: VALUE,
                                          returnValue: UnsafeMutablePointer<Rbg_return_value>) {
+    let span = RbMetrics.begin(.swiftBlock)
+    defer { RbMetrics.end(span) }
     returnValue.setFrom {
         let context = RbBlockContext.from(raw: rawContext)
         var args: [RbObject] = []
@@ -130,6 +143,42 @@ private func rbproc_pvoid_block_callback(rawContext: UnsafeMutableRawPointer,
     }
 }
 
+/// Context passed to borrowed-args block callbacks, lives on the caller's stack.
+private struct RbBorrowedBlockContext {
+    let callback: (UnsafeBufferPointer<VALUE>) throws -> VALUE
+    /// Swift error thrown by the block, to throw again after the method returns
+    var swiftError: Error?
+
+    /// Call the block, turning Swift errors into `break`
+    mutating func invoke(args: UnsafeBufferPointer<VALUE>) throws -> VALUE {
+        do {
+            return try callback(args)
+        } catch let error as RbError {
+            if case .rubyException = error { throw error }
+            if case .rubyJump = error { throw error }
+            swiftError = error
+        } catch let error where error is RbException || error is RbBreak {
+            throw error
+        } catch {
+            swiftError = error
+        }
+        throw RbBreak()
+    }
+}
+
+/// The callback from Ruby for blocks implemented by borrowed-args Swift closures.
+private func rbproc_borrowed_block_callback(rawContext: UnsafeMutableRawPointer,
+                                            argc: Int32, argv: UnsafePointer<VALUE>,
+                                            blockArg: VALUE,
+                                            returnValue: UnsafeMutablePointer<Rbg_return_value>) {
+    let span = RbMetrics.begin(.swiftBlock)
+    defer { RbMetrics.end(span) }
+    let context = rawContext.assumingMemoryBound(to: RbBorrowedBlockContext.self)
+    returnValue.setFrom {
+        try context.pointee.invoke(args: UnsafeBufferPointer(start: argv, count: Int(argc)))
+    }
+}
+
 /// The callback from Ruby for blocks implemented by Ruby block objects.
 ///
 /// Forward on the call.
@@ -152,6 +201,7 @@ internal enum RbBlock {
     private static var initOnce: Void = {
         rbg_register_pvoid_block_proc_callback(rbproc_pvoid_block_callback)
         rbg_register_value_block_proc_callback(rbproc_value_block_callback)
+        rbg_register_borrowed_block_proc_callback(rbproc_borrowed_block_callback)
     }()
 
     /// Call a method on an object passing a Swift closure as its block
@@ -172,6 +222,31 @@ internal enum RbBlock {
         })
     }
 
+    /// Call a method on an object passing a borrowed-args Swift closure as its block.
+    /// The closure is passed the yielded `VALUE`s and returns the block's value.
+    internal static func doBorrowedBlockCall(value: VALUE,
+                                             methodId: ID,
+                                             argValues: [VALUE],
+                                             hasKwArgs: Bool,
+                                             blockCall: (UnsafeBufferPointer<VALUE>) throws -> VALUE) throws -> VALUE {
+        let _ = initOnce
+        return try withoutActuallyEscaping(blockCall) { blockCall in
+            var context = RbBorrowedBlockContext(callback: blockCall)
+            let result = try withUnsafeMutablePointer(to: &context) { contextPtr in
+                try RbVM.doProtect { tag in
+                    rbg_block_call_borrowed_protect(value, methodId,
+                                                    Int32(argValues.count), argValues,
+                                                    hasKwArgs ? 1 : 0,
+                                                    contextPtr, &tag)
+                }
+            }
+            if let swiftError = context.swiftError {
+                throw swiftError
+            }
+            return result
+        }
+    }
+
     /// Call a method on an object passing a Ruby object as its block
     internal static func doBlockCall(value: VALUE,
                                      methodId: ID,
@@ -0,0 +1,227 @@
+//
+//  RbBorrowedArgs.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+@_implementationOnly import CRuby
+@_implementationOnly import RubyGatewayHelpers
+import Foundation
+
+/// A Ruby object passed into a Swift method implementation that is only valid
+/// for the duration of the method call.
+///
+/// Ruby keeps method arguments safe from garbage collection while the method
+/// runs so RubyGateway does not need to create an `RbObject` for each one.
+/// Use `retained` to get an `RbObject` if you need to keep the value after
+/// the method returns.
+///
+/// Do not let a `RbBorrowedObject` escape the method callback.
+public struct RbBorrowedObject {
+    /// The borrowed `VALUE` -- not retained
+    private let value: VALUE
+
+    init(value: VALUE) {
+        self.value = value
+    }
+
+    /// An `RbObject` for the value that can be stored beyond the method call.
+    public var retained: RbObject {
+        return RbObject(rubyValue: value)
+    }
+
+    /// Safely access the `VALUE` object handle for use with the Ruby C API.
+    @discardableResult
+    public func withRubyValue<T>(call: (RbObject.VALUE) throws -> T) rethrows -> T {
+        return try call(value)
+    }
+
+    /// The Ruby type of this object.  This is fairly unfriendly enum but might
+    /// be useful for debugging.
+    public var rubyType: RbType {
+        return TYPE(value)
+    }
+
+    /// Is the Ruby object truthy?
+    public var isTruthy: Bool {
+        return rbg_RB_TEST(value) != 0
+    }
+
+    /// Is the Ruby object `nil`?
+    public var isNil: Bool {
+        return rbg_RB_NIL_P(value) != 0
+    }
+
+    /// The error for a failed conversion.
+    private func badType<T>(_ type: T.Type) -> RbError {
+        return RbError.badType("Cannot convert \(retained) to Swift type \(T.self)")
+    }
+
+    /// Convert the object to some Swift type.
+    ///
+    /// This creates a temporary `RbObject` unless `T` is one of the types
+    /// with its own overload.
+    ///
+    /// - throws: `RbError.badType(...)` if the conversion fails.  There may be a more
+    ///            detailed exception inside `RbError.history`.
+    public func convert<T: RbObjectConvertible>(to type: T.Type = T.self) throws -> T {
+        if T.self == Int.self {
+            return unsafeBitCast(try convert(to: Int.self), to: T.self)
+        }
+        if T.self == Double.self {
+            return unsafeBitCast(try convert(to: Double.self), to: T.self)
+        }
+        if T.self == Bool.self {
+            return unsafeBitCast(try convert(to: Bool.self), to: T.self)
+        }
+        if T.self == String.self {
+            return unsafeBitCast(try convert(to: String.self), to: T.self)
+        }
+        return try retained.convert(to: type)
+    }
+
+    /// Convert the object to an `Int` without creating an `RbObject`.
+    ///
+    /// See `Int.init?(_:)` for the conversion rules.
+    ///
+    /// - throws: `RbError.badType(...)` if the conversion fails.  There may be a more
+    ///            detailed exception inside `RbError.history`.
+    public func convert(to type: Int.Type = Int.self) throws -> Int {
+        if let fast = Int(immediate: value) {
+            return fast
+        }
+        do {
+            return try RbVM.doProtect { tag in
+                rbg_obj2long_protect(value, &tag)
+            }
+        } catch {
+            throw badType(type)
+        }
+    }
+
+    /// Convert the object to a `Double` without creating an `RbObject`.
+    ///
+    /// See `Double.init?(_:)` for the conversion rules.
+    ///
+    /// - throws: `RbError.badType(...)` if the conversion fails.  There may be a more
+    ///            detailed exception inside `RbError.history`.
+    public func convert(to type: Double.Type = Double.self) throws -> Double {
+        if let fast = Double(immediate: value) {
+            return fast
+        }
+        do {
+            return try RbVM.doProtect { tag in
+                rbg_obj2double_protect(value, &tag)
+            }
+        } catch {
+            throw badType(type)
+        }
+    }
+
+    /// Convert the object to a `Bool`, reflecting its truthiness.
+    public func convert(to type: Bool.Type = Bool.self) throws -> Bool {
+        return isTruthy
+    }
+
+    /// Convert the object to a `String` without creating an `RbObject`.
+    ///
+    /// See `String.init?(_:)` for the conversion rules.
+    ///
+    /// - throws: `RbError.badType(...)` if the conversion fails.  There may be a more
+    ///            detailed exception inside `RbError.history`.
+    public func convert(to type: String.Type = String.self) throws -> String {
+        do {
+            let stringValue = try RbVM.doProtect { tag in
+                rbg_String_protect(value, &tag)
+            }
+            let rubyData = Data(bytes: rbg_RSTRING_PTR(stringValue),
+                                count: rbg_RSTRING_LEN(stringValue))
+            if let string = String(data: rubyData, encoding: .utf8) {
+                return string
+            }
+        } catch {
+            // fall through, Ruby exception is in history
+        }
+        throw badType(type)
+    }
+}
+
+/// The arguments passed to a Swift method implementation, only valid for
+/// the duration of the method call.
+///
+/// This is a collection of `RbBorrowedObject`s in the order they were passed,
+/// including any trailing keyword-arguments hash.
+public struct RbBorrowedArgs: RandomAccessCollection {
+    /// The `VALUE`s passed by Ruby, owned by the caller's stack frame
+    private let values: UnsafeBufferPointer<VALUE>
+
+    init(values: UnsafeBufferPointer<VALUE>) {
+        self.values = values
+    }
+
+    /// :nodoc:
+    public var startIndex: Int {
+        return values.startIndex
+    }
+
+    /// :nodoc:
+    public var endIndex: Int {
+        return values.endIndex
+    }
+
+    /// The argument at some position.
+    public subscript(index: Int) -> RbBorrowedObject {
+        return RbBorrowedObject(value: values[index])
+    }
+
+    /// `RbObject`s for all the arguments that can be stored beyond the method call.
+    public var retained: [RbObject] {
+        return values.map { RbObject(rubyValue: $0) }
+    }
+
+    /// Safely access the arguments' `VALUE`s for use with the Ruby C API.
+    @discardableResult
+    public func withRubyValues<T>(call: (UnsafeBufferPointer<RbObject.VALUE>) throws -> T) rethrows -> T {
+        return try call(values)
+    }
+}
+
+/// Services for Swift implementations of Ruby methods that use borrowed arguments.
+///
+/// This is a lighter-weight alternative to `RbMethod` for methods that are called
+/// very frequently.  It does not do any argument decoding beyond count checking.
+///
+/// You do not create instances of this type: instead, RubyGateway creates
+/// instances and passes them to method callbacks defined using
+/// `RbObject.defineMethod(_:argCount:borrowedBody:)`.
+public struct RbBorrowedMethod {
+    /// The object against which the method has been invoked.
+    public let rubySelf: RbBorrowedObject
+    /// The arguments passed to the method.
+    public let args: RbBorrowedArgs
+
+    init(rubySelf: VALUE, args: UnsafeBufferPointer<VALUE>) {
+        self.rubySelf = RbBorrowedObject(value: rubySelf)
+        self.args = RbBorrowedArgs(values: args)
+    }
+
+    /// Has the method been passed a block?
+    public var isBlockGiven: Bool {
+        return rb_block_given_p() != 0
+    }
+
+    /// Invoke the method's block and get the result.
+    ///
+    /// See `RbMethod.yieldBlock(args:kwArgs:)`.
+    @discardableResult
+    public func yieldBlock(args: [RbObjectConvertible?] = [],
+                           kwArgs: KeyValuePairs<String, RbObjectConvertible?> = [:]) throws -> RbObject {
+        return try RbMethod.doYieldBlock(args: args, kwArgs: kwArgs)
+    }
+}
+
+/// The function signature for a Ruby method implemented as a Swift free function
+/// or closure that uses borrowed arguments.
+///
+/// See `RbMethodCallback` for the regular version.
+public typealias RbBorrowedMethodCallback = (RbBorrowedMethod) throws -> RbObject
@@ -0,0 +1,197 @@
+//
+//  RbCallSite.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+@_implementationOnly import CRuby
+@_implementationOnly import RubyGatewayHelpers
+
+/// A pre-resolved method call against a particular Ruby object.
+///
+/// Use this when you make the same call many times, for example from a
+/// request loop.  The method name is resolved once when the call site is
+/// created, and the fixed-arity `call(...)` methods pass their arguments
+/// to Ruby without building any intermediate arrays or `RbObject`s.
+///
+/// ```swift
+/// let process = try handler.callSite("process", arity: 2)
+/// for request in requests {
+///     let result = try process.call(request.headers, request.body)
+/// }
+/// ```
+///
+/// Ruby itself caches the method lookup for the receiver's class, so
+/// redefining the method or changing the receiver's class hierarchy is
+/// picked up as normal.
+///
+/// The call site holds a strong reference to the receiver.
+///
+/// Create call sites using `RbObjectAccess.callSite(_:arity:)`.
+public final class RbCallSite {
+    /// The object that the method is called on.
+    let receiver: RbObjectAccess
+    /// The method's `ID`.
+    let methodId: ID
+
+    /// The name of the method called.
+    public let methodName: String
+
+    /// The number of positional arguments passed on each call.
+    public let arity: Int
+
+    init(receiver: RbObjectAccess, methodName: String, methodId: ID, arity: Int) {
+        self.receiver = receiver
+        self.methodName = methodName
+        self.methodId = methodId
+        self.arity = arity
+    }
+
+    /// Check the number of arguments offered matches the call site.
+    private func checkArity(_ count: Int) throws {
+        guard count == arity else {
+            try RbError.raise(error: .badParameter("Call site \(methodName) has arity \(arity), passed \(count) args."))
+        }
+    }
+
+    /// Backend: make the call with arguments that are all known to be alive.
+    private func invoke(argc: Int, argv: UnsafePointer<VALUE>) throws -> RbObject {
+        try checkArity(argc)
+        let span = RbMetrics.begin(.methodCall, name: methodName)
+        defer { RbMetrics.end(span) }
+        let value = receiver.getValue()
+        return RbObject(rubyValue: try RbVM.doProtect { tag in
+            rbg_funcallv_protect(value, methodId, Int32(argc), argv, 0, &tag)
+        })
+    }
+
+    /// Call the method with some fixed arguments, all of the same type.
+    private func invoke<Args>(_ args: Args, count: Int, keepAlive: Any) throws -> RbObject {
+        var args = args
+        return try withExtendedLifetime(keepAlive) {
+            try withUnsafePointer(to: &args) { tuplePtr in
+                try tuplePtr.withMemoryRebound(to: VALUE.self, capacity: count) { argv in
+                    try invoke(argc: count, argv: argv)
+                }
+            }
+        }
+    }
+
+    // MARK: - Fixed-arity calls
+
+    /// Call the method without any arguments.
+    ///
+    /// - returns: The result of calling the method.
+    /// - throws: `RbError.badParameter(_:)` if the call site's arity is not 0.
+    ///           `RbError.rubyException(_:)` if there is a Ruby exception.
+    @discardableResult
+    public func call() throws -> RbObject {
+        try invoke(argc: 0, argv: [])
+    }
+
+    /// Call the method with one argument.
+    ///
+    /// - returns: The result of calling the method.
+    /// - throws: `RbError.badParameter(_:)` if the call site's arity is not 1.
+    ///           `RbError.rubyException(_:)` if there is a Ruby exception.
+    @discardableResult
+    public func call(_ arg0: RbObject) throws -> RbObject {
+        try invoke(arg0.withRubyValue { $0 }, count: 1, keepAlive: arg0)
+    }
+
+    /// Call the method with two arguments.
+    ///
+    /// - returns: The result of calling the method.
+    /// - throws: `RbError.badParameter(_:)` if the call site's arity is not 2.
+    ///           `RbError.rubyException(_:)` if there is a Ruby exception.
+    @discardableResult
+    public func call(_ arg0: RbObject, _ arg1: RbObject) throws -> RbObject {
+        try invoke((arg0.withRubyValue { $0 },
+                    arg1.withRubyValue { $0 }),
+                   count: 2, keepAlive: (arg0, arg1))
+    }
+
+    /// Call the method with three arguments.
+    ///
+    /// - returns: The result of calling the method.
+    /// - throws: `RbError.badParameter(_:)` if the call site's arity is not 3.
+    ///           `RbError.rubyException(_:)` if there is a Ruby exception.
+    @discardableResult
+    public func call(_ arg0: RbObject, _ arg1: RbObject, _ arg2: RbObject) throws -> RbObject {
+        try invoke((arg0.withRubyValue { $0 },
+                    arg1.withRubyValue { $0 },
+                    arg2.withRubyValue { $0 }),
+                   count: 3, keepAlive: (arg0, arg1, arg2))
+    }
+
+    /// Call the method with four arguments.
+    ///
+    /// - returns: The result of calling the method.
+    /// - throws: `RbError.badParameter(_:)` if the call site's arity is not 4.
+    ///           `RbError.rubyException(_:)` if there is a Ruby exception.
+    @discardableResult
+    public func call(_ arg0: RbObject, _ arg1: RbObject, _ arg2: RbObject, _ arg3: RbObject) throws -> RbObject {
+        try invoke((arg0.withRubyValue { $0 },
+                    arg1.withRubyValue { $0 },
+                    arg2.withRubyValue { $0 },
+                    arg3.withRubyValue { $0 }),
+                   count: 4, keepAlive: (arg0, arg1, arg2, arg3))
+    }
+
+    // MARK: - Any-arity calls
+
+    /// Call the method with any number of arguments.
+    ///
+    /// - parameter args: The arguments to pass.  There must be `arity` of them.
+    /// - returns: The result of calling the method.
+    /// - throws: `RbError.badParameter(_:)` if the wrong number of arguments is passed.
+    ///           `RbError.rubyException(_:)` if there is a Ruby exception.
+    @discardableResult
+    public func call(args: [RbObject]) throws -> RbObject {
+        try args.withRubyValues { argValues in
+            try invoke(argc: argValues.count, argv: argValues)
+        }
+    }
+
+    /// Call the method with raw `VALUE` arguments.
+    ///
+    /// This is for interop with `CRuby`.  The caller must keep the `VALUE`s
+    /// safe from garbage collection during the call.
+    ///
+    /// - parameter rubyValues: The arguments to pass.  There must be `arity` of them.
+    /// - returns: The result of calling the method.
+    /// - throws: `RbError.badParameter(_:)` if the wrong number of arguments is passed.
+    ///           `RbError.rubyException(_:)` if there is a Ruby exception.
+    @discardableResult
+    public func call(rubyValues: UnsafeBufferPointer<RbObject.VALUE>) throws -> RbObject {
+        guard let argv = rubyValues.baseAddress else {
+            return try call()
+        }
+        return try invoke(argc: rubyValues.count, argv: argv)
+    }
+}
+
+// MARK: - Creating call sites
+
+extension RbObjectAccess {
+    /// Create a reusable, pre-resolved call site for a method of this object.
+    ///
+    /// See `RbCallSite`.
+    ///
+    /// - parameter methodName: The name of the method to call.
+    /// - parameter arity: The number of positional arguments that will be passed
+    ///             on each call.  Keyword arguments and blocks are not supported.
+    /// - returns: A call site that can be used repeatedly.
+    /// - throws: `RbError.badIdentifier(type:id:)` if `methodName` looks wrong.
+    ///           `RbError.badParameter(_:)` if `arity` is negative.
+    ///           `RbError.rubyException(_:)` if Ruby has a problem.
+    public func callSite(_ methodName: String, arity: Int = 0) throws -> RbCallSite {
+        try Ruby.setup()
+        try methodName.checkRubyMethodName()
+        guard arity >= 0 else {
+            try RbError.raise(error: .badParameter("Call site arity must not be negative: \(arity)."))
+        }
+        let methodId = try Ruby.getID(for: methodName)
+        return RbCallSite(receiver: self, methodName: methodName, methodId: methodId, arity: arity)
+    }
+}
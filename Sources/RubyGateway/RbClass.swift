@@ -10,39 +10,60 @@
 //
 // Support for binding Swift objects to Ruby objects.
 //
-// Usual lack-of-context problem from Ruby, we indirect in a couple of
-// places and use the fully qualified Ruby class name as a key in a hash
-// on the Swift side to identify the Swift type and initializer.
+// Each bound Ruby class has an `RbBoundClassBinding` that the C code
+// finds from the class VALUE at alloc time and stores next to the Swift
+// instance for free time.
 //
-private protocol RbBoundClassProtocol {
-    func createInstance() -> UnsafeMutableRawPointer
-    func deleteInstance(_ instance: UnsafeMutableRawPointer)
+class RbBoundClassBinding {
+    func createInstance() -> UnsafeMutableRawPointer {
+        fatalError("Abstract")
+    }
+
+    func deleteInstance(_ instance: UnsafeMutableRawPointer) {
+        fatalError("Abstract")
+    }
 }
 
-private struct RbBoundClass<T: AnyObject> : RbBoundClassProtocol {
-    var initializer: () -> T
+private final class RbBoundClass<T: AnyObject>: RbBoundClassBinding {
+    let initializer: () -> T
+    /// Most Swift objects to keep for reuse
+    let poolSize: Int
+    /// Swift objects from freed instances, still retained
+    private var pool: [UnsafeMutableRawPointer] = []
+
+    init(initializer: @escaping () -> T, poolSize: Int) {
+        self.initializer = initializer
+        self.poolSize = poolSize
+        super.init()
+        pool.reserveCapacity(poolSize)
+    }
 
-    func createInstance() -> UnsafeMutableRawPointer {
+    override func createInstance() -> UnsafeMutableRawPointer {
+        if let pooled = pool.popLast() {
+            return pooled
+        }
         let instance = initializer()
         return Unmanaged<T>.passRetained(instance).toOpaque()
     }
 
-    func deleteInstance(_ instance: UnsafeMutableRawPointer) {
+    override func deleteInstance(_ instance: UnsafeMutableRawPointer) {
+        if pool.count < poolSize {
+            pool.append(instance)
+            return
+        }
         let instance = Unmanaged<T>.fromOpaque(instance)
         instance.release()
     }
 }
 
 // Called from rbg_protect.m / rbg_bound_alloc_instance
-private func rbbinding_alloc(className: UnsafePointer<Int8>) -> UnsafeMutableRawPointer? {
-    let name = String(cString: className)
-    return RbClassBinding.alloc(name: name)
+private func rbbinding_alloc(binding: UnsafeMutableRawPointer) -> UnsafeMutableRawPointer? {
+    return RbClassBinding.binding(from: binding).createInstance()
 }
 
 // Called from rbg_protect.m / rbg_bound_free_data
-private func rbbinding_free(className: UnsafePointer<Int8>, instance: UnsafeMutableRawPointer) {
-    let name = String(cString: className)
-    RbClassBinding.free(name: name, instance: instance)
+private func rbbinding_free(binding: UnsafeMutableRawPointer, instance: UnsafeMutableRawPointer) {
+    RbClassBinding.binding(from: binding).deleteInstance(instance)
 }
 
 // namespace
@@ -53,23 +74,30 @@ internal enum RbClassBinding {
         rbg_register_object_binding_callbacks(rbbinding_alloc, rbbinding_free)
     }()
 
-    private static var bindings = [String : RbBoundClassProtocol]()
-
-    fileprivate static func register<T: AnyObject>(name: String, initializer: @escaping () -> T) {
+    /// Bind a Ruby class to a Swift type.  The binding lives forever because
+    /// instances of a previous binding may still be around.
+    fileprivate static func register<T: AnyObject>(classValue: VALUE, poolSize: Int, initializer: @escaping () -> T) {
         let _ = initOnce
-        bindings[name] = RbBoundClass(initializer: initializer)
+        let binding = RbBoundClass(initializer: initializer, poolSize: poolSize)
+        rbg_bind_class(classValue, Unmanaged.passRetained(binding).toOpaque())
+    }
+
+    fileprivate static func binding(from raw: UnsafeMutableRawPointer) -> RbBoundClassBinding {
+        return Unmanaged<RbBoundClassBinding>.fromOpaque(raw).takeUnretainedValue()
     }
 
-    static func alloc(name: String) -> UnsafeMutableRawPointer? {
-        guard let binding = bindings[name] else {
+    /// Create a Swift instance for some class, `nil` if not bound
+    static func alloc(classValue: VALUE) -> UnsafeMutableRawPointer? {
+        guard let raw = rbg_bound_class_binding(classValue) else {
             return nil
         }
-        return binding.createInstance()
+        return binding(from: raw).createInstance()
     }
 
-    static func free(name: String, instance: UnsafeMutableRawPointer) {
-        if let binding = bindings[name] {
-            binding.deleteInstance(instance)
+    /// Delete a Swift instance from `alloc(classValue:)`
+    static func free(classValue: VALUE, instance: UnsafeMutableRawPointer) {
+        if let raw = rbg_bound_class_binding(classValue) {
+            binding(from: raw).deleteInstance(instance)
         }
     }
 }
@@ -153,29 +181,43 @@ extension RbGateway {
     /// Ruby methods defined with `RbObject.defineMethod(_:argsSpec:method:)` can be bound
     /// directly to methods of the `SwiftPeer` class.
     ///
+    /// If your program creates and discards many instances of the class then set
+    /// `peerPoolSize` to reuse Swift objects: when a Ruby object is
+    /// garbage-collected its Swift object is kept, up to `peerPoolSize` of them,
+    /// and given to the next new Ruby object instead of calling `initializer`.
+    /// Your Ruby `initialize` method must then reset every property of the
+    /// Swift object.
+    ///
     /// - Parameter name: Name of the class.
     /// - Parameter under: The class or module under which to nest this new class.  The
     ///                    default is `nil` which means the class is at the top level.
+    /// - Parameter peerPoolSize: The number of Swift objects to keep for reuse.  Default 0.
     /// - Parameter initializer: Closure to return an instance of `SwiftPeer`, typically a new
     ///                          instance.
     /// - Returns: The class object for the new class.
     /// - Throws: `RbError.badIdentifier(type:id:)` if `name` is bad.  `RbError.badType(...)` if
     ///           `parent` is provided but is not a class, or if `under` is neither class nor
-    ///           module. `RbError.rubyException(...)` if Ruby is unhappy with the definition,
+    ///           module. `RbError.badParameter(...)` if `peerPoolSize` is negative.
+    ///           `RbError.rubyException(...)` if Ruby is unhappy with the definition,
     ///           for example when the class already exists with a different parent.
     @discardableResult
     public func defineClass<SwiftPeer: AnyObject>(
                     _ name: String,
                     under: RbObject? = nil,
+                    peerPoolSize: Int = 0,
                     initializer: @escaping () -> SwiftPeer) throws -> RbObject {
         try setup()
+        guard peerPoolSize >= 0 else {
+            try RbError.raise(error: .badParameter("Peer pool size must not be negative: \(peerPoolSize)."))
+        }
         // Ruby 3 deprecates rb_cData in favour of rb_cObject - appears to be OK to
         // use that in Ruby 2.x also: we always set a custom init in `rbg_bind_class`.
         let classObj = try defineClass(name, parent: RbObject(rubyValue: rb_cObject), under: under)
         try classObj.markBoundClass()
 
-        RbClassBinding.register(name: String(classObj)!, initializer: initializer)
-        classObj.withRubyValue { rbg_bind_class($0) }
+        classObj.withRubyValue {
+            RbClassBinding.register(classValue: $0, poolSize: peerPoolSize, initializer: initializer)
+        }
 
         return classObj
     }
@@ -0,0 +1,957 @@
+//
+//  RbCodable.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+@_implementationOnly import CRuby
+@_implementationOnly import RubyGatewayHelpers
+
+// MARK: - Coding keys
+
+/// How `RbEncoder` and `RbDecoder` represent `CodingKey`s as Ruby hash keys.
+public enum RbCodingKeyStyle {
+    /// Keys are Ruby symbols, for example `{ name: "Fred" }`.
+    case symbols
+    /// Keys are frozen Ruby strings, for example `{ "name" => "Fred" }`.
+    case strings
+}
+
+/// The Ruby hash keys for `CodingKey`s, made once and reused.
+///
+/// The number of keys remembered is limited so that dictionaries with
+/// keys taken from data do not grow the cache forever.  Keys that don't fit
+/// are made afresh each time: strings are copied and symbols are made as
+/// dynamic symbols that Ruby can garbage collect.
+private final class RbCodingKeyCache {
+    static let maxCount = 1024
+
+    let style: RbCodingKeyStyle
+    private var keys: [String: RbObject] = [:]
+
+    init(style: RbCodingKeyStyle) {
+        self.style = style
+    }
+
+    func rubyKey(for key: CodingKey) throws -> RbObject {
+        let name = key.stringValue
+        if let keyObject = keys[name] {
+            return keyObject
+        }
+        guard keys.count < RbCodingKeyCache.maxCount else {
+            let stringValue = name.rubyValue
+            return RbObject(rubyValue: style == .symbols ? rb_str_intern(stringValue) : stringValue)
+        }
+        let keyObject: RbObject
+        switch style {
+        case .symbols:
+            keyObject = RbObject(rubyValue: rb_id2sym(try Ruby.getID(for: name)))
+        case .strings:
+            keyObject = RbObject(rubyValue: rb_obj_freeze(name.rubyValue))
+        }
+        keys[name] = keyObject
+        return keyObject
+    }
+}
+
+/// Coding path entries for array elements and `super`
+private struct RbCodingPathKey: CodingKey {
+    let stringValue: String
+    let intValue: Int?
+
+    init(stringValue: String) {
+        self.stringValue = stringValue
+        self.intValue = nil
+    }
+
+    init(intValue: Int) {
+        self.stringValue = "Index \(intValue)"
+        self.intValue = intValue
+    }
+
+    static let superKey = RbCodingPathKey(stringValue: "super")
+}
+
+// MARK: - Primitive values
+
+/// Swift types that turn directly into Ruby values.
+///
+/// None of these conversions can raise a Ruby exception except for running
+/// out of memory, which Ruby treats as fatal anyway, so they are done without
+/// setting up a protected region per value.
+private protocol RbEncodablePrimitive {
+    var rubyValue: VALUE { get }
+}
+
+extension Bool: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { self ? Qtrue : Qfalse }
+}
+
+extension String: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE {
+        var string = self
+        return string.withUTF8 { utf8 in
+            utf8.withMemoryRebound(to: CChar.self) {
+                rb_utf8_str_new($0.baseAddress, $0.count)
+            }
+        }
+    }
+}
+
+extension Double: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { DBL2NUM(self) }
+}
+
+extension Float: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { DBL2NUM(Double(self)) }
+}
+
+extension Int: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { RB_LONG2NUM(self) }
+}
+
+extension Int8: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { RB_LONG2NUM(Int(self)) }
+}
+
+extension Int16: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { RB_LONG2NUM(Int(self)) }
+}
+
+extension Int32: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { RB_LONG2NUM(Int(self)) }
+}
+
+extension Int64: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { RB_LONG2NUM(Int(self)) }
+}
+
+extension UInt: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { RB_ULONG2NUM(self) }
+}
+
+extension UInt8: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { RB_ULONG2NUM(UInt(self)) }
+}
+
+extension UInt16: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { RB_ULONG2NUM(UInt(self)) }
+}
+
+extension UInt32: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { RB_ULONG2NUM(UInt(self)) }
+}
+
+extension UInt64: RbEncodablePrimitive {
+    fileprivate var rubyValue: VALUE { RB_ULONG2NUM(UInt(self)) }
+}
+
+/// Swift types read directly from Ruby values.
+///
+/// Conversions are strict: a string is not accepted as a number, nor a
+/// number as a string.
+private protocol RbDecodablePrimitive {
+    init(rubyValue: VALUE, codingPath: [CodingKey]) throws
+}
+
+private func typeMismatch<T>(_ type: T.Type, _ value: VALUE, _ codingPath: [CodingKey]) -> DecodingError {
+    DecodingError.typeMismatch(type, .init(codingPath: codingPath,
+                                           debugDescription: "Expected \(type), found Ruby \(TYPE(value))."))
+}
+
+private func dataCorrupted(_ message: String, _ codingPath: [CodingKey]) -> DecodingError {
+    DecodingError.dataCorrupted(.init(codingPath: codingPath, debugDescription: message))
+}
+
+extension Bool: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        switch rubyValue {
+        case Qtrue: self = true
+        case Qfalse: self = false
+        default: throw typeMismatch(Bool.self, rubyValue, codingPath)
+        }
+    }
+}
+
+extension String: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        let stringValue: VALUE
+        switch TYPE(rubyValue) {
+        case .T_STRING: stringValue = rubyValue
+        case .T_SYMBOL: stringValue = rb_sym2str(rubyValue)
+        default: throw typeMismatch(String.self, rubyValue, codingPath)
+        }
+        let rubyBytes = UnsafeRawBufferPointer(start: rbg_RSTRING_PTR(stringValue),
+                                               count: rbg_RSTRING_LEN(stringValue))
+        guard let string = String(utf8Bytes: rubyBytes) else {
+            throw dataCorrupted("Ruby string is not valid UTF-8.", codingPath)
+        }
+        self = string
+    }
+}
+
+extension Double: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        if let double = Double(immediate: rubyValue) {
+            self = double
+            return
+        }
+        switch TYPE(rubyValue) {
+        case .T_FLOAT, .T_BIGNUM:
+            guard let double = Double(RbObject(rubyValue: rubyValue)) else {
+                throw dataCorrupted("Can't convert Ruby number to Double.", codingPath)
+            }
+            self = double
+        default:
+            throw typeMismatch(Double.self, rubyValue, codingPath)
+        }
+    }
+}
+
+extension Float: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        self = Float(try Double(rubyValue: rubyValue, codingPath: codingPath))
+    }
+}
+
+extension FixedWidthInteger {
+    /// Integers and whole-number floats, if they fit
+    fileprivate init(integerValue: VALUE, codingPath: [CodingKey]) throws {
+        let result: Self?
+        if RB_FIXNUM_P(integerValue) {
+            result = Self(exactly: RB_FIX2LONG(integerValue))
+        } else {
+            switch TYPE(integerValue) {
+            case .T_BIGNUM:
+                let object = RbObject(rubyValue: integerValue)
+                if Self.isSigned {
+                    result = Int(object).flatMap { Self(exactly: $0) }
+                } else if rb_big_sign(integerValue) == 0 {
+                    // negative: don't let the conversion wrap it
+                    result = nil
+                } else {
+                    result = UInt(object).flatMap { Self(exactly: $0) }
+                }
+            case .T_FLOAT:
+                let double = Double(immediate: integerValue) ?? Double(RbObject(rubyValue: integerValue))
+                result = double.flatMap { Self(exactly: $0) }
+            default:
+                throw typeMismatch(Self.self, integerValue, codingPath)
+            }
+        }
+        guard let value = result else {
+            throw dataCorrupted("Ruby number \(RbObject(rubyValue: integerValue)) does not fit in \(Self.self).", codingPath)
+        }
+        self = value
+    }
+}
+
+extension Int: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        try self.init(integerValue: rubyValue, codingPath: codingPath)
+    }
+}
+
+extension Int8: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        try self.init(integerValue: rubyValue, codingPath: codingPath)
+    }
+}
+
+extension Int16: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        try self.init(integerValue: rubyValue, codingPath: codingPath)
+    }
+}
+
+extension Int32: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        try self.init(integerValue: rubyValue, codingPath: codingPath)
+    }
+}
+
+extension Int64: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        try self.init(integerValue: rubyValue, codingPath: codingPath)
+    }
+}
+
+extension UInt: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        try self.init(integerValue: rubyValue, codingPath: codingPath)
+    }
+}
+
+extension UInt8: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        try self.init(integerValue: rubyValue, codingPath: codingPath)
+    }
+}
+
+extension UInt16: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        try self.init(integerValue: rubyValue, codingPath: codingPath)
+    }
+}
+
+extension UInt32: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        try self.init(integerValue: rubyValue, codingPath: codingPath)
+    }
+}
+
+extension UInt64: RbDecodablePrimitive {
+    fileprivate init(rubyValue: VALUE, codingPath: [CodingKey]) throws {
+        try self.init(integerValue: rubyValue, codingPath: codingPath)
+    }
+}
+
+// MARK: - Encoder
+
+/// Turns `Encodable` Swift values into Ruby objects.
+///
+/// Keyed containers become Ruby hashes, unkeyed containers become arrays,
+/// and numbers, strings, and booleans become their Ruby equivalents.
+/// Optionals that are `nil` are left out of hashes, as usual for `Codable`.
+/// ```swift
+/// struct Person: Codable {
+///     let name: String
+///     let age: Int
+/// }
+///
+/// let person = try RbEncoder().encode(Person(name: "Fred", age: 32))
+/// // person is Ruby { name: "Fred", age: 32 }
+/// ```
+///
+/// The Ruby objects are built directly as the value is encoded, without
+/// making Swift collections along the way.  The hash key for
+/// each `CodingKey` is made once per encoder: reuse an encoder to save work.
+///
+/// Use an encoder from one Ruby thread at a time.
+public final class RbEncoder {
+    /// How to represent `CodingKey`s in Ruby hashes.
+    public let keyStyle: RbCodingKeyStyle
+
+    /// Information for the values being encoded, see `Encoder.userInfo`.
+    public var userInfo: [CodingUserInfoKey: Any] = [:]
+
+    /// Cache of Ruby hash keys
+    private let keyCache: RbCodingKeyCache
+
+    /// Create a new encoder.
+    ///
+    /// - parameter keyStyle: How to represent `CodingKey`s.  Default `.symbols`.
+    public init(keyStyle: RbCodingKeyStyle = .symbols) {
+        self.keyStyle = keyStyle
+        self.keyCache = RbCodingKeyCache(style: keyStyle)
+    }
+
+    /// Encode a value as a Ruby object.
+    ///
+    /// - parameter value: The value to encode.
+    /// - returns: The Ruby object.  Ruby `{}` if the value encodes nothing.
+    /// - throws: `EncodingError` or whatever `value` throws while encoding.
+    ///           `RbError.rubyException(_:)` if Ruby can't make a hash key.
+    public func encode<T: Encodable>(_ value: T) throws -> RbObject {
+        try Ruby.setup()
+        if let primitive = value as? RbEncodablePrimitive {
+            return RbObject(rubyValue: primitive.rubyValue)
+        }
+        let root = RbEncoding.Root()
+        let encoding = RbEncoding(encoder: self, codingPath: [], destination: .root(root))
+        try encoding.encodeNested(value)
+        return root.object ?? .nilObject
+    }
+
+    fileprivate func rubyKey(for key: CodingKey) throws -> RbObject {
+        try keyCache.rubyKey(for: key)
+    }
+}
+
+/// The `Encoder` for one value.
+///
+/// Each value's Ruby object is attached to its parent as soon as it is made,
+/// which keeps it safe from garbage collection while the encode carries on.
+/// Hashes and arrays being filled in are held as `RbObject`s because
+/// `GC.compact` can move them.
+private final class RbEncoding: Encoder {
+    /// Holds the top-level object
+    final class Root {
+        var object: RbObject?
+    }
+
+    /// Where the value's Ruby object goes
+    enum Destination {
+        case root(Root)
+        case hash(RbObject, key: RbObject)
+        case array(RbObject, index: Int)
+    }
+
+    let encoder: RbEncoder
+    let codingPath: [CodingKey]
+    let destination: Destination
+    /// Has the value's Ruby object been made
+    private var isStored = false
+    /// The hash or array made for a container, to reuse for another container
+    private var madeContainer: RbObject?
+
+    var userInfo: [CodingUserInfoKey: Any] {
+        encoder.userInfo
+    }
+
+    init(encoder: RbEncoder, codingPath: [CodingKey], destination: Destination) {
+        self.encoder = encoder
+        self.codingPath = codingPath
+        self.destination = destination
+    }
+
+    func store(_ value: VALUE) {
+        isStored = true
+        switch destination {
+        case .root(let root):
+            root.object = RbObject(rubyValue: value)
+        case .hash(let hash, let key):
+            hash.withRubyValue { hashValue in
+                key.withRubyValue { rb_hash_aset(hashValue, $0, value) }
+            }
+        case .array(let array, let index):
+            array.withRubyValue { rb_ary_store($0, index, value) }
+        }
+    }
+
+    /// Encode a nested value, insisting on a Ruby object for it
+    func encodeNested<T: Encodable>(_ value: T) throws {
+        try value.encode(to: self)
+        if !isStored {
+            store(rb_hash_new())
+        }
+    }
+
+    /// Encode a nested value's Ruby object
+    func rubyValue<T: Encodable>(_ value: T, codingPath: [CodingKey], destination: Destination) throws -> VALUE? {
+        if let primitive = value as? RbEncodablePrimitive {
+            return primitive.rubyValue
+        }
+        try RbEncoding(encoder: encoder, codingPath: codingPath, destination: destination).encodeNested(value)
+        return nil
+    }
+
+    /// Get the hash or array for a container, making it the first time
+    private func makeContainer(type: RbType, make: () -> VALUE) -> RbObject {
+        if let madeContainer = madeContainer, madeContainer.rubyType == type {
+            return madeContainer
+        }
+        let value = make()
+        store(value)
+        let object = RbObject(rubyValue: value)
+        madeContainer = object
+        return object
+    }
+
+    func container<Key: CodingKey>(keyedBy type: Key.Type) -> KeyedEncodingContainer<Key> {
+        let hash = makeContainer(type: .T_HASH) { rb_hash_new() }
+        return KeyedEncodingContainer(RbKeyedEncodingContainer<Key>(encoding: self, hash: hash, codingPath: codingPath))
+    }
+
+    func unkeyedContainer() -> UnkeyedEncodingContainer {
+        let array = makeContainer(type: .T_ARRAY) { rb_ary_new() }
+        return RbUnkeyedEncodingContainer(encoding: self, array: array, codingPath: codingPath)
+    }
+
+    func singleValueContainer() -> SingleValueEncodingContainer {
+        self
+    }
+}
+
+extension RbEncoding: SingleValueEncodingContainer {
+    func encodeNil() throws { store(Qnil) }
+    func encode(_ value: Bool) throws { store(value.rubyValue) }
+    func encode(_ value: String) throws { store(value.rubyValue) }
+    func encode(_ value: Double) throws { store(value.rubyValue) }
+    func encode(_ value: Float) throws { store(value.rubyValue) }
+    func encode(_ value: Int) throws { store(value.rubyValue) }
+    func encode(_ value: Int8) throws { store(value.rubyValue) }
+    func encode(_ value: Int16) throws { store(value.rubyValue) }
+    func encode(_ value: Int32) throws { store(value.rubyValue) }
+    func encode(_ value: Int64) throws { store(value.rubyValue) }
+    func encode(_ value: UInt) throws { store(value.rubyValue) }
+    func encode(_ value: UInt8) throws { store(value.rubyValue) }
+    func encode(_ value: UInt16) throws { store(value.rubyValue) }
+    func encode(_ value: UInt32) throws { store(value.rubyValue) }
+    func encode(_ value: UInt64) throws { store(value.rubyValue) }
+
+    func encode<T: Encodable>(_ value: T) throws {
+        if let primitive = value as? RbEncodablePrimitive {
+            store(primitive.rubyValue)
+        } else {
+            try value.encode(to: self)
+        }
+    }
+}
+
+private struct RbKeyedEncodingContainer<Key: CodingKey>: KeyedEncodingContainerProtocol {
+    let encoding: RbEncoding
+    let hash: RbObject
+    let codingPath: [CodingKey]
+
+    init(encoding: RbEncoding, hash: RbObject, codingPath: [CodingKey]) {
+        self.encoding = encoding
+        self.hash = hash
+        self.codingPath = codingPath
+    }
+
+    private func set(_ value: VALUE, forKey key: CodingKey) throws {
+        set(value, forKey: try encoding.encoder.rubyKey(for: key))
+    }
+
+    private func set(_ value: VALUE, forKey key: RbObject) {
+        hash.withRubyValue { hashValue in
+            key.withRubyValue { rb_hash_aset(hashValue, $0, value) }
+        }
+    }
+
+    mutating func encodeNil(forKey key: Key) throws { try set(Qnil, forKey: key) }
+    mutating func encode(_ value: Bool, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: String, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: Double, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: Float, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: Int, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: Int8, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: Int16, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: Int32, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: Int64, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: UInt, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: UInt8, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: UInt16, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: UInt32, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+    mutating func encode(_ value: UInt64, forKey key: Key) throws { try set(value.rubyValue, forKey: key) }
+
+    mutating func encode<T: Encodable>(_ value: T, forKey key: Key) throws {
+        let keyObject = try encoding.encoder.rubyKey(for: key)
+        if let rubyValue = try encoding.rubyValue(value, codingPath: codingPath + [key],
+                                                  destination: .hash(hash, key: keyObject)) {
+            set(rubyValue, forKey: keyObject)
+        }
+    }
+
+    mutating func nestedContainer<NestedKey: CodingKey>(keyedBy keyType: NestedKey.Type,
+                                                        forKey key: Key) -> KeyedEncodingContainer<NestedKey> {
+        let nestedHash = rb_hash_new()
+        try! set(nestedHash, forKey: key)
+        return KeyedEncodingContainer(RbKeyedEncodingContainer<NestedKey>(encoding: encoding,
+                                                                          hash: RbObject(rubyValue: nestedHash),
+                                                                          codingPath: codingPath + [key]))
+    }
+
+    mutating func nestedUnkeyedContainer(forKey key: Key) -> UnkeyedEncodingContainer {
+        let nestedArray = rb_ary_new()
+        try! set(nestedArray, forKey: key)
+        return RbUnkeyedEncodingContainer(encoding: encoding, array: RbObject(rubyValue: nestedArray),
+                                          codingPath: codingPath + [key])
+    }
+
+    private func superEncoder(key: CodingKey) -> Encoder {
+        let keyObject = try! encoding.encoder.rubyKey(for: key)
+        return RbEncoding(encoder: encoding.encoder, codingPath: codingPath + [key],
+                          destination: .hash(hash, key: keyObject))
+    }
+
+    mutating func superEncoder() -> Encoder {
+        superEncoder(key: RbCodingPathKey.superKey)
+    }
+
+    mutating func superEncoder(forKey key: Key) -> Encoder {
+        superEncoder(key: key)
+    }
+}
+
+private struct RbUnkeyedEncodingContainer: UnkeyedEncodingContainer {
+    let encoding: RbEncoding
+    let array: RbObject
+    let codingPath: [CodingKey]
+
+    var count: Int {
+        array.withRubyValue { rb_array_len($0) }
+    }
+
+    private func append(_ value: VALUE) {
+        array.withRubyValue { _ = rb_ary_push($0, value) }
+    }
+
+    /// Make a slot for a value that will be encoded into it
+    private func reserve() -> (RbEncoding.Destination, [CodingKey]) {
+        let index = count
+        append(Qnil)
+        return (.array(array, index: index), codingPath + [RbCodingPathKey(intValue: index)])
+    }
+
+    mutating func encodeNil() throws { append(Qnil) }
+    mutating func encode(_ value: Bool) throws { append(value.rubyValue) }
+    mutating func encode(_ value: String) throws { append(value.rubyValue) }
+    mutating func encode(_ value: Double) throws { append(value.rubyValue) }
+    mutating func encode(_ value: Float) throws { append(value.rubyValue) }
+    mutating func encode(_ value: Int) throws { append(value.rubyValue) }
+    mutating func encode(_ value: Int8) throws { append(value.rubyValue) }
+    mutating func encode(_ value: Int16) throws { append(value.rubyValue) }
+    mutating func encode(_ value: Int32) throws { append(value.rubyValue) }
+    mutating func encode(_ value: Int64) throws { append(value.rubyValue) }
+    mutating func encode(_ value: UInt) throws { append(value.rubyValue) }
+    mutating func encode(_ value: UInt8) throws { append(value.rubyValue) }
+    mutating func encode(_ value: UInt16) throws { append(value.rubyValue) }
+    mutating func encode(_ value: UInt32) throws { append(value.rubyValue) }
+    mutating func encode(_ value: UInt64) throws { append(value.rubyValue) }
+
+    mutating func encode<T: Encodable>(_ value: T) throws {
+        if let primitive = value as? RbEncodablePrimitive {
+            append(primitive.rubyValue)
+        } else {
+            let (destination, path) = reserve()
+            try RbEncoding(encoder: encoding.encoder, codingPath: path, destination: destination).encodeNested(value)
+        }
+    }
+
+    mutating func nestedContainer<NestedKey: CodingKey>(keyedBy keyType: NestedKey.Type) -> KeyedEncodingContainer<NestedKey> {
+        let nestedHash = rb_hash_new()
+        let path = codingPath + [RbCodingPathKey(intValue: count)]
+        append(nestedHash)
+        return KeyedEncodingContainer(RbKeyedEncodingContainer<NestedKey>(encoding: encoding,
+                                                                          hash: RbObject(rubyValue: nestedHash),
+                                                                          codingPath: path))
+    }
+
+    mutating func nestedUnkeyedContainer() -> UnkeyedEncodingContainer {
+        let nestedArray = rb_ary_new()
+        let path = codingPath + [RbCodingPathKey(intValue: count)]
+        append(nestedArray)
+        return RbUnkeyedEncodingContainer(encoding: encoding, array: RbObject(rubyValue: nestedArray), codingPath: path)
+    }
+
+    mutating func superEncoder() -> Encoder {
+        let (destination, path) = reserve()
+        return RbEncoding(encoder: encoding.encoder, codingPath: path, destination: destination)
+    }
+}
+
+// MARK: - Decoder
+
+/// Makes `Decodable` Swift values from Ruby objects.
+///
+/// The opposite of `RbEncoder`: keyed containers read Ruby hashes, unkeyed
+/// containers read arrays.  Ruby strings and symbols decode as `String`,
+/// integers and floats as numbers if they fit, and `true` and `false` as
+/// `Bool`.  There are no other conversions: for example a Ruby string for an
+/// `Int` property is a `DecodingError.typeMismatch(_:_:)`.
+/// ```swift
+/// let person = try RbDecoder().decode(Person.self,
+///                                     from: Ruby.eval(ruby: "{ name: 'Barney', age: 31 }"))
+/// ```
+///
+/// Values are read straight from the Ruby objects: each property is looked up
+/// in its hash by key, without converting the whole hash to a Swift
+/// dictionary.  The hash key for each `CodingKey` is made once per decoder:
+/// reuse a decoder to save work.
+///
+/// Use a decoder from one Ruby thread at a time.
+public final class RbDecoder {
+    /// How `CodingKey`s are represented in the Ruby hashes.
+    public let keyStyle: RbCodingKeyStyle
+
+    /// Information for the values being decoded, see `Decoder.userInfo`.
+    public var userInfo: [CodingUserInfoKey: Any] = [:]
+
+    /// Cache of Ruby hash keys
+    private let keyCache: RbCodingKeyCache
+
+    /// Create a new decoder.
+    ///
+    /// - parameter keyStyle: How `CodingKey`s are represented.  Default `.symbols`.
+    public init(keyStyle: RbCodingKeyStyle = .symbols) {
+        self.keyStyle = keyStyle
+        self.keyCache = RbCodingKeyCache(style: keyStyle)
+    }
+
+    /// Decode a value from a Ruby object.
+    ///
+    /// - parameter type: The type of value to decode.
+    /// - parameter object: The Ruby object to decode from.
+    /// - returns: The decoded value.
+    /// - throws: `DecodingError` if `object` doesn't match `type`, or whatever
+    ///           `type` throws while decoding.
+    ///           `RbError.rubyException(_:)` if Ruby can't make a hash key.
+    public func decode<T: Decodable>(_ type: T.Type, from object: RbObject) throws -> T {
+        try Ruby.setup()
+        return try object.withRubyValue { value in
+            try decode(type, from: value, codingPath: [])
+        }
+    }
+
+    fileprivate func decode<T: Decodable>(_ type: T.Type, from value: VALUE, codingPath: [CodingKey]) throws -> T {
+        if let primitiveType = type as? RbDecodablePrimitive.Type {
+            return try primitiveType.init(rubyValue: value, codingPath: codingPath) as! T
+        }
+        return try T(from: RbDecoding(decoder: self, value: value, codingPath: codingPath))
+    }
+
+    fileprivate func rubyKey(for key: CodingKey) throws -> RbObject {
+        try keyCache.rubyKey(for: key)
+    }
+}
+
+/// The `Decoder` for one value.
+///
+/// The value is reachable from the object passed to `RbDecoder` so is
+/// safe from garbage collection while the decode runs, but is held as an
+/// `RbObject` because `GC.compact` can move it.
+private struct RbDecoding: Decoder {
+    let decoder: RbDecoder
+    let object: RbObject
+    let codingPath: [CodingKey]
+
+    init(decoder: RbDecoder, value: VALUE, codingPath: [CodingKey]) {
+        self.decoder = decoder
+        self.object = RbObject(rubyValue: value)
+        self.codingPath = codingPath
+    }
+
+    var value: VALUE {
+        object.withRubyValue { $0 }
+    }
+
+    var userInfo: [CodingUserInfoKey: Any] {
+        decoder.userInfo
+    }
+
+    func container<Key: CodingKey>(keyedBy type: Key.Type) throws -> KeyedDecodingContainer<Key> {
+        guard TYPE(value) == .T_HASH else {
+            throw typeMismatch([String: Any].self, value, codingPath)
+        }
+        return KeyedDecodingContainer(RbKeyedDecodingContainer<Key>(decoder: decoder, hash: object, codingPath: codingPath))
+    }
+
+    func unkeyedContainer() throws -> UnkeyedDecodingContainer {
+        guard TYPE(value) == .T_ARRAY else {
+            throw typeMismatch([Any].self, value, codingPath)
+        }
+        return RbUnkeyedDecodingContainer(decoder: decoder, array: object, codingPath: codingPath)
+    }
+
+    func singleValueContainer() throws -> SingleValueDecodingContainer {
+        self
+    }
+}
+
+extension RbDecoding: SingleValueDecodingContainer {
+    func decodeNil() -> Bool { value == Qnil }
+    func decode(_ type: Bool.Type) throws -> Bool { try decodePrimitive(type) }
+    func decode(_ type: String.Type) throws -> String { try decodePrimitive(type) }
+    func decode(_ type: Double.Type) throws -> Double { try decodePrimitive(type) }
+    func decode(_ type: Float.Type) throws -> Float { try decodePrimitive(type) }
+    func decode(_ type: Int.Type) throws -> Int { try decodePrimitive(type) }
+    func decode(_ type: Int8.Type) throws -> Int8 { try decodePrimitive(type) }
+    func decode(_ type: Int16.Type) throws -> Int16 { try decodePrimitive(type) }
+    func decode(_ type: Int32.Type) throws -> Int32 { try decodePrimitive(type) }
+    func decode(_ type: Int64.Type) throws -> Int64 { try decodePrimitive(type) }
+    func decode(_ type: UInt.Type) throws -> UInt { try decodePrimitive(type) }
+    func decode(_ type: UInt8.Type) throws -> UInt8 { try decodePrimitive(type) }
+    func decode(_ type: UInt16.Type) throws -> UInt16 { try decodePrimitive(type) }
+    func decode(_ type: UInt32.Type) throws -> UInt32 { try decodePrimitive(type) }
+    func decode(_ type: UInt64.Type) throws -> UInt64 { try decodePrimitive(type) }
+
+    func decode<T: Decodable>(_ type: T.Type) throws -> T {
+        try decoder.decode(type, from: value, codingPath: codingPath)
+    }
+
+    private func decodePrimitive<T: RbDecodablePrimitive>(_ type: T.Type) throws -> T {
+        try T(rubyValue: value, codingPath: codingPath)
+    }
+}
+
+private struct RbKeyedDecodingContainer<Key: CodingKey>: KeyedDecodingContainerProtocol {
+    let decoder: RbDecoder
+    let hashObject: RbObject
+    let codingPath: [CodingKey]
+
+    init(decoder: RbDecoder, hash: RbObject, codingPath: [CodingKey]) {
+        self.decoder = decoder
+        self.hashObject = hash
+        self.codingPath = codingPath
+    }
+
+    private var hash: VALUE {
+        hashObject.withRubyValue { $0 }
+    }
+
+    var allKeys: [Key] {
+        var keys: [Key] = []
+        try? RbVM.doProtectHashForEach(hashValue: hash) { keyValue, _ in
+            let name: String?
+            switch TYPE(keyValue) {
+            case .T_SYMBOL, .T_STRING: name = try? String(rubyValue: keyValue, codingPath: codingPath)
+            default: name = nil
+            }
+            if let key = name.flatMap({ Key(stringValue: $0) }) {
+                keys.append(key)
+            }
+            return true
+        }
+        return keys
+    }
+
+    private func lookup(_ key: CodingKey) throws -> VALUE? {
+        let keyObject = try decoder.rubyKey(for: key)
+        let value = keyObject.withRubyValue { rb_hash_lookup2(hash, $0, Qundef) }
+        return value == Qundef ? nil : value
+    }
+
+    private func value(forKey key: CodingKey) throws -> VALUE {
+        guard let value = try lookup(key) else {
+            throw DecodingError.keyNotFound(key, .init(codingPath: codingPath,
+                                                      debugDescription: "No value for key '\(key.stringValue)'."))
+        }
+        return value
+    }
+
+    private func decodePrimitive<T: RbDecodablePrimitive>(_ type: T.Type, forKey key: Key) throws -> T {
+        try T(rubyValue: value(forKey: key), codingPath: codingPath + [key])
+    }
+
+    func contains(_ key: Key) -> Bool {
+        (try? lookup(key)) != nil
+    }
+
+    func decodeNil(forKey key: Key) throws -> Bool { try value(forKey: key) == Qnil }
+    func decode(_ type: Bool.Type, forKey key: Key) throws -> Bool { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: String.Type, forKey key: Key) throws -> String { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: Double.Type, forKey key: Key) throws -> Double { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: Float.Type, forKey key: Key) throws -> Float { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: Int.Type, forKey key: Key) throws -> Int { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: Int8.Type, forKey key: Key) throws -> Int8 { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: Int16.Type, forKey key: Key) throws -> Int16 { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: Int32.Type, forKey key: Key) throws -> Int32 { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: Int64.Type, forKey key: Key) throws -> Int64 { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: UInt.Type, forKey key: Key) throws -> UInt { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: UInt8.Type, forKey key: Key) throws -> UInt8 { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: UInt16.Type, forKey key: Key) throws -> UInt16 { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: UInt32.Type, forKey key: Key) throws -> UInt32 { try decodePrimitive(type, forKey: key) }
+    func decode(_ type: UInt64.Type, forKey key: Key) throws -> UInt64 { try decodePrimitive(type, forKey: key) }
+
+    func decode<T: Decodable>(_ type: T.Type, forKey key: Key) throws -> T {
+        try decoder.decode(type, from: value(forKey: key), codingPath: codingPath + [key])
+    }
+
+    func nestedContainer<NestedKey: CodingKey>(keyedBy type: NestedKey.Type,
+                                               forKey key: Key) throws -> KeyedDecodingContainer<NestedKey> {
+        try RbDecoding(decoder: decoder, value: value(forKey: key), codingPath: codingPath + [key])
+            .container(keyedBy: type)
+    }
+
+    func nestedUnkeyedContainer(forKey key: Key) throws -> UnkeyedDecodingContainer {
+        try RbDecoding(decoder: decoder, value: value(forKey: key), codingPath: codingPath + [key])
+            .unkeyedContainer()
+    }
+
+    private func superDecoder(key: CodingKey) throws -> Decoder {
+        RbDecoding(decoder: decoder, value: try lookup(key) ?? Qnil, codingPath: codingPath + [key])
+    }
+
+    func superDecoder() throws -> Decoder {
+        try superDecoder(key: RbCodingPathKey.superKey)
+    }
+
+    func superDecoder(forKey key: Key) throws -> Decoder {
+        try superDecoder(key: key)
+    }
+}
+
+private struct RbUnkeyedDecodingContainer: UnkeyedDecodingContainer {
+    let decoder: RbDecoder
+    let arrayObject: RbObject
+    let codingPath: [CodingKey]
+    private(set) var currentIndex = 0
+
+    init(decoder: RbDecoder, array: RbObject, codingPath: [CodingKey]) {
+        self.decoder = decoder
+        self.arrayObject = array
+        self.codingPath = codingPath
+    }
+
+    private var array: VALUE {
+        arrayObject.withRubyValue { $0 }
+    }
+
+    var count: Int? {
+        rb_array_len(array)
+    }
+
+    var isAtEnd: Bool {
+        currentIndex >= rb_array_len(array)
+    }
+
+    private var currentPath: [CodingKey] {
+        codingPath + [RbCodingPathKey(intValue: currentIndex)]
+    }
+
+    /// The next element, without moving on
+    private func peek<T>(_ type: T.Type) throws -> VALUE {
+        guard !isAtEnd else {
+            throw DecodingError.valueNotFound(type, .init(codingPath: currentPath,
+                                                          debugDescription: "Unkeyed container is at end."))
+        }
+        return rb_ary_entry(array, currentIndex)
+    }
+
+    private mutating func decodePrimitive<T: RbDecodablePrimitive>(_ type: T.Type) throws -> T {
+        let result = try T(rubyValue: peek(type), codingPath: currentPath)
+        currentIndex += 1
+        return result
+    }
+
+    mutating func decodeNil() throws -> Bool {
+        guard try peek(Any?.self) == Qnil else {
+            return false
+        }
+        currentIndex += 1
+        return true
+    }
+
+    mutating func decode(_ type: Bool.Type) throws -> Bool { try decodePrimitive(type) }
+    mutating func decode(_ type: String.Type) throws -> String { try decodePrimitive(type) }
+    mutating func decode(_ type: Double.Type) throws -> Double { try decodePrimitive(type) }
+    mutating func decode(_ type: Float.Type) throws -> Float { try decodePrimitive(type) }
+    mutating func decode(_ type: Int.Type) throws -> Int { try decodePrimitive(type) }
+    mutating func decode(_ type: Int8.Type) throws -> Int8 { try decodePrimitive(type) }
+    mutating func decode(_ type: Int16.Type) throws -> Int16 { try decodePrimitive(type) }
+    mutating func decode(_ type: Int32.Type) throws -> Int32 { try decodePrimitive(type) }
+    mutating func decode(_ type: Int64.Type) throws -> Int64 { try decodePrimitive(type) }
+    mutating func decode(_ type: UInt.Type) throws -> UInt { try decodePrimitive(type) }
+    mutating func decode(_ type: UInt8.Type) throws -> UInt8 { try decodePrimitive(type) }
+    mutating func decode(_ type: UInt16.Type) throws -> UInt16 { try decodePrimitive(type) }
+    mutating func decode(_ type: UInt32.Type) throws -> UInt32 { try decodePrimitive(type) }
+    mutating func decode(_ type: UInt64.Type) throws -> UInt64 { try decodePrimitive(type) }
+
+    mutating func decode<T: Decodable>(_ type: T.Type) throws -> T {
+        let result = try decoder.decode(type, from: peek(type), codingPath: currentPath)
+        currentIndex += 1
+        return result
+    }
+
+    mutating func nestedContainer<NestedKey: CodingKey>(keyedBy type: NestedKey.Type) throws -> KeyedDecodingContainer<NestedKey> {
+        let container = try RbDecoding(decoder: decoder, value: peek(type), codingPath: currentPath)
+            .container(keyedBy: type)
+        currentIndex += 1
+        return container
+    }
+
+    mutating func nestedUnkeyedContainer() throws -> UnkeyedDecodingContainer {
+        let container = try RbDecoding(decoder: decoder, value: peek([Any].self), codingPath: currentPath)
+            .unkeyedContainer()
+        currentIndex += 1
+        return container
+    }
+
+    mutating func superDecoder() throws -> Decoder {
+        let decoding = RbDecoding(decoder: decoder, value: try peek(Any.self), codingPath: currentPath)
+        currentIndex += 1
+        return decoding
+    }
+}
@@ -101,22 +101,86 @@ extension String: RbObjectConvertible {
                 }
             }
 
-            let rubyLength = rbg_RSTRING_LEN(stringVal)
-            let rubyPtr = rbg_RSTRING_PTR(stringVal)
-            let rubyData = Data(bytes: rubyPtr, count: rubyLength)
-
-            self.init(data: rubyData, encoding: .utf8)
+            let rubyBytes = UnsafeRawBufferPointer(start: rbg_RSTRING_PTR(stringVal),
+                                                   count: rbg_RSTRING_LEN(stringVal))
+            self.init(utf8Bytes: rubyBytes)
         } catch {
             return nil
         }
     }
 
+    /// Copy some bytes into a new `String`, failing if they are not valid UTF-8.
+    init?(utf8Bytes bytes: UnsafeRawBufferPointer) {
+        guard bytes.count > 0 else {
+            self = ""
+            return
+        }
+        guard #available(macOS 11.0, iOS 14.0, tvOS 14.0, watchOS 7.0, *) else {
+            self.init(data: Data(bytes), encoding: .utf8)
+            return
+        }
+
+        var string = String(unsafeUninitializedCapacity: bytes.count) { buffer in
+            UnsafeMutableRawBufferPointer(buffer).copyMemory(from: bytes)
+            return bytes.count
+        }
+        // Invalid UTF-8 has been repaired so won't match the original bytes
+        let valid = string.withUTF8 { utf8 in
+            utf8.count == bytes.count && memcmp(utf8.baseAddress!, bytes.baseAddress!, bytes.count) == 0
+        }
+        guard valid else {
+            return nil
+        }
+        self = string
+    }
+
     /// A Ruby object for the string.
     public var rubyObject: RbObject {
         guard Ruby.softSetup() else {
             return .nilObject
         }
-        return RbObject(rubyValue: withCString { rb_utf8_str_new($0, utf8.count) })
+        var string = self
+        return RbObject(rubyValue: string.withUTF8 { utf8 in
+            utf8.withMemoryRebound(to: CChar.self) {
+                rb_utf8_str_new($0.baseAddress, $0.count)
+            }
+        })
+    }
+}
+
+extension RbObject {
+    /// Access the bytes of a Ruby string without copying them.
+    ///
+    /// The object is first converted to a string as for `String.init?(_:)`.
+    /// The string is protected from garbage collection and locked against
+    /// modification while `body` runs: Ruby code that tries to change it
+    /// raises an exception.
+    ///
+    /// The buffer is not valid outside of `body`.
+    ///
+    /// - parameter body: The closure to pass the string's bytes on to.
+    /// - returns: The value returned by `body`.
+    /// - throws: `RbError.rubyException(_:)` if the object cannot be converted
+    ///           to a string, or whatever `body` throws.
+    public func withUnsafeStringBytes<T>(_ body: (UnsafeRawBufferPointer) throws -> T) throws -> T {
+        let stringObj = RbObject(rubyValue: try withRubyValue { objValue in
+            try RbVM.doProtect { tag in
+                rbg_String_protect(objValue, &tag)
+            }
+        })
+        // Pin so `GC.compact` in `body` can't move the string, and its buffer if embedded
+        stringObj.pin()
+        defer { stringObj.unpin() }
+        return try stringObj.withRubyValue { stringValue in
+            let locked = rbg_str_lock(stringValue) != 0
+            defer {
+                if locked {
+                    rbg_str_unlock(stringValue)
+                }
+            }
+            return try body(UnsafeRawBufferPointer(start: rbg_RSTRING_PTR(stringValue),
+                                                   count: rbg_RSTRING_LEN(stringValue)))
+        }
     }
 }
 
@@ -174,7 +238,13 @@ extension UInt: RbObjectConvertible {
     public init?(_ object: RbObject) {
         do {
             self = try object.withRubyValue { objValue in
-                try RbVM.doProtect { tag in
+                if RB_FIXNUM_P(objValue) {
+                    let fixnum = RB_FIX2LONG(objValue)
+                    if fixnum >= 0 {
+                        return UInt(fixnum)
+                    }
+                }
+                return try RbVM.doProtect { tag in
                     rbg_obj2ulong_protect(objValue, &tag)
                 }
             }
@@ -207,7 +277,10 @@ extension Int: RbObjectConvertible {
     public init?(_ object: RbObject) {
         do {
             self = try object.withRubyValue { objValue in
-                try RbVM.doProtect { tag in
+                if let fast = Int(immediate: objValue) {
+                    return fast
+                }
+                return try RbVM.doProtect { tag in
                     rbg_obj2long_protect(objValue, &tag)
                 }
             }
@@ -223,6 +296,19 @@ extension Int: RbObjectConvertible {
         }
         return RbObject(rubyValue: RB_LONG2NUM(self))
     }
+
+    /// Convert a fixnum, or a flonum that needs no rounding beyond truncation,
+    /// without calling Ruby.  `nil` if Ruby needs to do it.
+    init?(immediate value: VALUE) {
+        if RB_FIXNUM_P(value) {
+            self = RB_FIX2LONG(value)
+        } else if RB_FLONUM_P(value),
+            let truncated = Int(exactly: RB_FLONUM2DBL(value).rounded(.towardZero)) {
+            self = truncated
+        } else {
+            return nil
+        }
+    }
 }
 
 // MARK: - IntegerLiteral
@@ -249,7 +335,10 @@ extension Double: RbObjectConvertible {
     public init?(_ object: RbObject) {
         do {
             self = try object.withRubyValue { objValue in
-                try RbVM.doProtect { tag in
+                if let fast = Double(immediate: objValue) {
+                    return fast
+                }
+                return try RbVM.doProtect { tag in
                     rbg_obj2double_protect(objValue, &tag)
                 }
             }
@@ -265,6 +354,17 @@ extension Double: RbObjectConvertible {
         }
         return RbObject(rubyValue: DBL2NUM(self))
     }
+
+    /// Convert a flonum or fixnum without calling Ruby.  `nil` if Ruby needs to do it.
+    init?(immediate value: VALUE) {
+        if RB_FLONUM_P(value) {
+            self = RB_FLONUM2DBL(value)
+        } else if RB_FIXNUM_P(value) {
+            self = Double(RB_FIX2LONG(value))
+        } else {
+            return nil
+        }
+    }
 }
 
 // MARK: - FloatLiteral
@@ -288,17 +388,28 @@ extension Array: RbObjectConvertible where Element: RbObjectConvertible {
     /// the Ruby array elements do not support conversion to the array `Element`
     /// type.
     ///
+    /// Arrays of `Int`, `Double`, and `Bool` are converted in bulk without
+    /// creating an `RbObject` for each element.
+    ///
     /// See `RbError.history` to find out why a conversion failed.
     public init?(_ object: RbObject) {
         self.init()
 
         do {
-            let aryValue = try object.withRubyValue { objValue in
-                try RbVM.doProtect { tag in
+            let aryValue = try object.withRubyValue { objValue -> VALUE in
+                guard TYPE(objValue) != .T_ARRAY else {
+                    return objValue
+                }
+                return try RbVM.doProtect { tag in
                     rbg_Array_protect(objValue, &tag)
                 }
             }
-            for i in 0..<rb_array_len(aryValue) {
+            let count = rb_array_len(aryValue)
+            if count > 0, let fast = try Array.bulkConvert(aryValue: aryValue, count: count) {
+                self = fast
+                return
+            }
+            for i in 0..<count {
                 let eleValue = rb_ary_entry(aryValue, i)
                 guard let element = Element(RbObject(rubyValue: eleValue)) else {
                     return nil
@@ -310,15 +421,69 @@ extension Array: RbObjectConvertible where Element: RbObjectConvertible {
         }
     }
 
+    /// Convert all elements of a Ruby array in one go, for some simple `Element`s.
+    /// Returns `nil` if `Element` is not a simple type.
+    private static func bulkConvert(aryValue: VALUE, count: Int) throws -> [Element]? {
+        if Element.self == Int.self {
+            let ints = try [Int](unsafeUninitializedCapacity: count) { buffer, initializedCount in
+                try RbVM.doProtect { tag in
+                    rbg_ary_to_longs_protect(aryValue, buffer.baseAddress!, count, &tag)
+                }
+                initializedCount = count
+            }
+            return unsafeBitCast(ints, to: [Element].self)
+        }
+        if Element.self == Double.self {
+            let doubles = try [Double](unsafeUninitializedCapacity: count) { buffer, initializedCount in
+                try RbVM.doProtect { tag in
+                    rbg_ary_to_doubles_protect(aryValue, buffer.baseAddress!, count, &tag)
+                }
+                initializedCount = count
+            }
+            return unsafeBitCast(doubles, to: [Element].self)
+        }
+        if Element.self == Bool.self {
+            let bools = [Bool](unsafeUninitializedCapacity: count) { buffer, initializedCount in
+                rbg_ary_to_bools(aryValue, buffer.baseAddress!, count)
+                initializedCount = count
+            }
+            return unsafeBitCast(bools, to: [Element].self)
+        }
+        return nil
+    }
+
     /// Create a Ruby array object for this `Array`.
     public var rubyObject: RbObject {
         guard Ruby.softSetup() else {
             return .nilObject
         }
+        if let fast = bulkRubyValue {
+            return RbObject(rubyValue: fast)
+        }
         return RbObject(rubyValue: map { $0.rubyObject }.withRubyValues { elementValues in
             rb_ary_new_from_values(count, elementValues)
         })
     }
+
+    /// Create a Ruby array without intermediate `RbObject`s, for some simple `Element`s.
+    private var bulkRubyValue: VALUE? {
+        if Element.self == Int.self {
+            return unsafeBitCast(self, to: [Int].self).withUnsafeBufferPointer {
+                rbg_ary_new_from_longs($0.baseAddress, $0.count)
+            }
+        }
+        if Element.self == Double.self {
+            return unsafeBitCast(self, to: [Double].self).withUnsafeBufferPointer {
+                rbg_ary_new_from_doubles($0.baseAddress, $0.count)
+            }
+        }
+        if Element.self == Bool.self {
+            return unsafeBitCast(self, to: [Bool].self).withUnsafeBufferPointer {
+                rbg_ary_new_from_bools($0.baseAddress, $0.count)
+            }
+        }
+        return nil
+    }
 }
 
 // MARK: - ArraySlice
@@ -375,6 +540,9 @@ extension Dictionary: RbObjectConvertible where Key: RbObjectConvertible, Value:
     ///
     /// Fails if more than one of the Ruby hash keys convert to the same Swift value.
     ///
+    /// Keys and values of type `Int`, `Double`, `Bool`, and `String` are converted
+    /// without creating an `RbObject` for each one.
+    ///
     /// See `RbError.history` to find out why a conversion failed.
     public init?(_ object: RbObject) {
         do {
@@ -383,24 +551,29 @@ extension Dictionary: RbObjectConvertible where Key: RbObjectConvertible, Value:
                     rbg_Hash_protect(objValue, &tag)
                 }
             })
-            // oh boy
-            var dict: [Key: Value] = [:] // closure cannot capture mutable self
-            try hashObj.call("each") { args in
-                // Hash#each has way too much magic: undocumentedly it tries to peek at the block
-                // arity in the block_given case.  Can't make this work in C so it gets '-1'.
-                // Then, undocumentedly it parcels K + V up into an array and passes that to us.
-                let kvArrayObj = args[0]
-                guard let key = Key(kvArrayObj[0]) else {
-                    throw RbException(message: "Cannot convert Ruby hash: unconvertible key \(kvArrayObj[0])")
+            var dict: [Key: Value] = [:]
+            var failure: String? = nil
+            try hashObj.withRubyValue { hashValue in
+                dict.reserveCapacity(rbg_RHASH_SIZE(hashValue))
+                try RbVM.doProtectHashForEach(hashValue: hashValue) { keyValue, valueValue in
+                    guard let key = try? RbBorrowedObject(value: keyValue).convert(to: Key.self) else {
+                        failure = "unconvertible key \(RbObject(rubyValue: keyValue))"
+                        return false
+                    }
+                    guard dict[key] == nil else {
+                        failure = "duplicate key \(key)"
+                        return false
+                    }
+                    guard let value = try? RbBorrowedObject(value: valueValue).convert(to: Value.self) else {
+                        failure = "unconvertible value \(RbObject(rubyValue: valueValue))"
+                        return false
+                    }
+                    dict[key] = value
+                    return true
                 }
-                guard dict[key] == nil else {
-                    throw RbException(message: "Cannot convert Ruby hash: duplicate key \(key)")
-                }
-                guard let value = Value(kvArrayObj[1]) else {
-                    throw RbException(message: "Cannot convert Ruby hash: unconvertible value \(kvArrayObj[1])")
-                }
-                dict[key] = value
-                return .nilObject
+            }
+            if let failure = failure {
+                throw RbException(message: "Cannot convert Ruby hash: \(failure)")
             }
             self = dict
         } catch {
@@ -418,20 +591,25 @@ extension Dictionary: RbObjectConvertible where Key: RbObjectConvertible, Value:
         guard Ruby.softSetup() else {
             return .nilObject
         }
-        let hashObj = RbObject(rubyValue: rb_hash_new())
+        var pairs: [RbObject] = []
+        pairs.reserveCapacity(count * 2)
+        forEach { arg in
+            pairs.append(arg.key.rubyObject)
+            pairs.append(arg.value.rubyObject)
+        }
         do {
-            try forEach { arg in
-                let newRbKey = arg.key.rubyObject
-                guard !(try hashObj.call("key?", args: [newRbKey]).isTruthy) else {
-                    throw RbException(message: "Cannot convert Swift dictionary, duplicate key \(newRbKey)")
+            let hashObj = RbObject(rubyValue: try pairs.withRubyValues { pairValues in
+                try RbVM.doProtect { tag in
+                    rbg_hash_new_from_pairs_protect(pairValues, count, &tag)
                 }
-                try hashObj.call("store", args: [newRbKey, arg.value])
+            })
+            guard hashObj.withRubyValue({ rbg_RHASH_SIZE($0) }) == count else {
+                throw RbException(message: "Cannot convert Swift dictionary, duplicate keys")
             }
+            return hashObj
         } catch {
             return .nilObject
         }
-
-        return hashObj
     }
 }
 
@@ -560,6 +738,7 @@ extension Set: RbObjectConvertible where Element: RbObjectConvertible {
     public init?(_ value: RbObject) {
         self.init()
         do {
+            try Ruby.requireSet()
             let setObj = try value.call("to_set")
             var newSet = Set<Element>() // closure cannot capture mutable self
             try setObj.call("each") { args in
@@ -586,6 +765,7 @@ extension Set: RbObjectConvertible where Element: RbObjectConvertible {
     /// `RbObjectConvertible` conformances.
     public var rubyObject: RbObject {
         guard Ruby.softSetup(),
+            let _ = try? Ruby.requireSet(),
             let set = RbObject(ofClass: "Set") else {
             return .nilObject
         }
@@ -64,6 +64,10 @@ public enum RbError: Error {
     /// `String.init(_:)`, and when using the `RbObjectAccess.failable`
     /// adapter that suppresses throwing.
     ///
+    /// Code that expects failures, for example trying several conversions to
+    /// find one that works, can turn off recording with `isEnabled` or
+    /// `withoutRecording(_:)`, or use `RbFailableAccess.withoutHistory`.
+    ///
     /// Methods are thread-safe.
     public struct History {
         /// The error history.
@@ -73,38 +77,134 @@ public enum RbError: Error {
         ///
         /// The list is automatically pruned, there is no need to worry about
         /// this consuming all your memory.
-        public private(set) var errors: [RbError] = []
-        private var lock: Lock = Lock()
+        public var errors: [RbError] {
+            return ring.errors
+        }
 
         /// The most recent error encountered by RubyGateway.
         public var mostRecent: RbError? {
-            return lock.locked { errors.last } // I guess...
+            return ring.mostRecent
         }
 
         /// Clear the error history.
         public mutating func clear() {
-            lock.locked {
-                errors = []
+            ring.clear()
+        }
+
+        /// Record errors?  Default `true`.
+        ///
+        /// Set to `false` to stop all threads recording errors.  Errors are
+        /// still thrown as usual.
+        public var isEnabled: Bool {
+            get {
+                return ring.isEnabled
             }
+            nonmutating set {
+                ring.isEnabled = newValue
+            }
+        }
+
+        /// Would an error recorded now on this thread be kept?
+        var isRecording: Bool {
+            ring.isEnabled && ring.suppressed.value == 0
+        }
+
+        /// Run some code without recording errors it causes on the current thread.
+        ///
+        /// Errors are still thrown as usual.  Calls can be nested.
+        ///
+        /// - parameter body: The code to run.
+        /// - returns: Whatever `body` returns.
+        /// - throws: Whatever `body` throws.
+        public func withoutRecording<T>(_ body: () throws -> T) rethrows -> T {
+            ring.suppressed.value += 1
+            defer { ring.suppressed.value -= 1 }
+            return try body()
         }
 
         /// Loads more than useful...
-        private let MAX_RECENT_ERRORS = 12
+        private static let MAX_RECENT_ERRORS = 12
+
+        private let ring = Ring(capacity: History.MAX_RECENT_ERRORS)
 
         /// Record an `RbError`
-        mutating func record(error: RbError) {
-            lock.locked {
-                errors.append(error)
-                if errors.count > MAX_RECENT_ERRORS {
-                    errors = Array(errors.dropFirst())
-                }
-            }
+        mutating func record(error: @autoclosure () -> RbError) {
+            ring.record(error: error)
         }
 
         /// Record an `RbException`
         mutating func record(exception: RbException) {
             record(error: .rubyException(exception))
         }
+
+        /// Fixed-size buffer of errors, recording overwrites the oldest
+        /// without moving the rest.
+        ///
+        /// The `rbg_atomic_*` helpers could publish slots without the lock,
+        /// but each slot holds a reference-counted error: a reader could load
+        /// it just as a writer overwrites and releases it.  Making that safe
+        /// needs deferred reclamation, which costs more than an uncontended
+        /// lock on a path that runs only when an error is recorded.
+        private final class Ring {
+            private let lock = Lock()
+            private var slots: [RbError?]
+            /// Slot for the next error
+            private var next = 0
+            /// Number of slots used
+            private var count = 0
+            /// Global on/off, only written under `lock`
+            private var enabled = true
+            /// Per-thread `withoutRecording(_:)` depth
+            let suppressed = ThreadLocalCount()
+
+            init(capacity: Int) {
+                slots = Array(repeating: nil, count: capacity)
+            }
+
+            var isEnabled: Bool {
+                get {
+                    return lock.locked { enabled }
+                }
+                set {
+                    lock.locked { enabled = newValue }
+                }
+            }
+
+            func record(error: () -> RbError) {
+                guard suppressed.value == 0 else {
+                    return
+                }
+                lock.locked {
+                    guard enabled else {
+                        return
+                    }
+                    slots[next] = error()
+                    next = (next + 1) % slots.count
+                    count = min(count + 1, slots.count)
+                }
+            }
+
+            var errors: [RbError] {
+                return lock.locked {
+                    let first = (next - count + slots.count) % slots.count
+                    return (0..<count).map { slots[(first + $0) % slots.count]! }
+                }
+            }
+
+            var mostRecent: RbError? {
+                return lock.locked {
+                    count == 0 ? nil : slots[(next - 1 + slots.count) % slots.count]
+                }
+            }
+
+            func clear() {
+                lock.locked {
+                    slots = Array(repeating: nil, count: slots.count)
+                    next = 0
+                    count = 0
+                }
+            }
+        }
     }
 
     /// Record an `RbError` and then throw it.
@@ -178,29 +278,136 @@ public struct RbBreak: Error {
 /// Create and throw one of these to raise a Ruby exception from
 /// a block implemented in Swift by an `RbBlockCallback`.
 public struct RbException: CustomStringConvertible, Error {
+    /// An exception raised by Swift that Ruby code may never look at.
+    /// Ruby creates it when raising it; Swift only if it asks for `exception`.
+    private final class Pending {
+        enum Kind {
+            case runtimeError
+            case argumentError
+            case custom(RbObject)
+        }
+        let kind: Kind
+        let message: String
+        private(set) var object: RbObject?
+
+        init(kind: Kind, message: String) {
+            self.kind = kind
+            self.message = message
+        }
+
+        func withExceptionClass<T>(_ call: (VALUE) throws -> T) rethrows -> T {
+            switch kind {
+            case .runtimeError: return try call(rb_eRuntimeError)
+            case .argumentError: return try call(rb_eArgError)
+            case .custom(let exceptionClass): return try exceptionClass.withRubyValue(call: call)
+            }
+        }
+
+        var className: String {
+            withExceptionClass { String(cString: rb_class2name($0)) }
+        }
+
+        var exception: RbObject {
+            if let object = object {
+                return object
+            }
+            let newObject = withExceptionClass { exceptionClass in
+                message.withCString { cstr in
+                    RbObject(rubyValue: rb_exc_new(exceptionClass, cstr, message.utf8.count))
+                }
+            }
+            object = newObject
+            return newObject
+        }
+    }
+
+    private let object: RbObject?
+    private let pending: Pending?
+
     /// The underlying Ruby exception object
-    public let exception: RbObject
+    public var exception: RbObject {
+        object ?? pending!.exception
+    }
 
     init(exception: RbObject) {
-        self.exception = exception
+        self.object = exception
+        self.pending = nil
     }
 
     /// Construct a new Ruby `RuntimeError` exception with the given message.
     ///
-    /// Use `Kernel#raise` directly to raise a different type of exception.
-    public init(message: String) {
-        exception = message.withCString { cstr in
-            RbObject(rubyValue: rb_exc_new(rb_eRuntimeError, cstr, message.utf8.count))
+    /// If the exception is recorded in `RbError.history` then the Ruby exception
+    /// object is created straight away, and is the one Ruby raises and rescues.
+    /// With `recordHistory: false` it is not created until Ruby raises it, so
+    /// throwing one of these from a Swift method or block is cheap.  Asking for
+    /// `exception` before then creates a separate object that Ruby never raises.
+    ///
+    /// Use `init(class:message:recordHistory:)` for a different type of exception.
+    ///
+    /// - parameter message: The exception's message.
+    /// - parameter recordHistory: Whether to record the exception in
+    ///   `RbError.history`.  Default `true`.  Pass `false` for exceptions
+    ///   that are part of normal flow control.
+    public init(message: String, recordHistory: Bool = true) {
+        self.init(kind: .runtimeError, message: message, recordHistory: recordHistory)
+    }
+
+    /// Construct a new Ruby exception of some class with the given message.
+    ///
+    /// The Ruby exception object is created as for `init(message:recordHistory:)`.
+    /// Look up the class once and reuse it, for example to end an enumeration:
+    /// ```swift
+    /// let stopIteration = try Ruby.get("StopIteration")
+    /// ...
+    /// throw try RbException(class: stopIteration, message: "done", recordHistory: false)
+    /// ```
+    ///
+    /// - parameter class: The exception's class, `Exception` or a subclass.
+    /// - parameter message: The exception's message.
+    /// - parameter recordHistory: Whether to record the exception in
+    ///   `RbError.history`.  Default `true`.
+    /// - throws: `RbError.badType(_:)` if `class` is not a subclass of `Exception`.
+    public init(class exceptionClass: RbObject, message: String, recordHistory: Bool = true) throws {
+        let isExceptionClass = exceptionClass.withRubyValue { classValue in
+            rb_obj_is_kind_of(classValue, rb_cClass) == Qtrue &&
+                rb_class_inherited_p(classValue, rb_eException) == Qtrue
+        }
+        guard isExceptionClass else {
+            try RbError.raise(error: .badType("Not an exception class: \(exceptionClass)"))
         }
-        RbError.history.record(exception: self)
+        self.init(kind: .custom(exceptionClass), message: message, recordHistory: recordHistory)
     }
 
     /// Internal version for ArgumentError
-    init(argMessage: String) {
-        exception = argMessage.withCString { cstr in
-            RbObject(rubyValue: rb_exc_new(rb_eArgError, cstr, argMessage.utf8.count))
+    init(argMessage: String, recordHistory: Bool = true) {
+        self.init(kind: .argumentError, message: argMessage, recordHistory: recordHistory)
+    }
+
+    private init(kind: Pending.Kind, message: String, recordHistory: Bool) {
+        let pending = Pending(kind: kind, message: message)
+        // History keeps the object Ruby raises, so it has the backtrace
+        if recordHistory && RbError.history.isRecording {
+            object = pending.exception
+            self.pending = nil
+            RbError.history.record(exception: self)
+        } else {
+            object = nil
+            self.pending = pending
+        }
+    }
+
+    /// Tell Ruby to raise the exception, creating it first if it is pending.
+    func setRaise(returnValue: UnsafeMutablePointer<Rbg_return_value>) {
+        if let pending = pending, pending.object == nil {
+            pending.withExceptionClass { exceptionClass in
+                pending.message.withCString { cstr in
+                    rbg_return_value_set_new_exception(returnValue, exceptionClass,
+                                                       cstr, pending.message.utf8.count)
+                }
+            }
+        } else {
+            returnValue.set(type: RBG_RT_RAISE, value: exception.withRubyValue { $0 })
         }
-        RbError.history.record(exception: self)
     }
 
     /// The backtrace from the Ruby exception
@@ -215,7 +422,10 @@ public struct RbException: CustomStringConvertible, Error {
 
     /// The exception's message
     public var description: String {
-        let exceptionClass = try! exception.get("class")
+        if let pending = pending {
+            return "\(pending.className): \(pending.message)"
+        }
+        let exceptionClass = exception.withRubyValue { String(cString: rb_obj_classname($0)) }
         return "\(exceptionClass): \(exception)"
     }
 }
@@ -234,12 +444,12 @@ extension UnsafeMutablePointer where Pointee == Rbg_return_value {
             set(type: RBG_RT_VALUE, value: retVal)
         } catch RbError.rubyException(let exn) {
             // RubyGateway/Ruby code threw exception
-            set(type: RBG_RT_RAISE, value: exn.exception.withRubyValue { $0 })
+            exn.setRaise(returnValue: self)
         } catch RbError.rubyJump(let tag) {
             set(type: RBG_RT_JUMP, value: VALUE(tag))
         } catch let exn as RbException {
             // User Swift code generated Ruby exception
-            set(type: RBG_RT_RAISE, value: exn.exception.withRubyValue { $0 })
+            exn.setRaise(returnValue: self)
         } catch let brk as RbBreak {
             // 'break' from iterator
             if let brkObject = brk.object {
@@ -251,7 +461,7 @@ extension UnsafeMutablePointer where Pointee == Rbg_return_value {
             // User Swift code or RubyGateway threw Swift error.  Oh for typed throws.
             // Wrap it up in a Ruby exception and raise that instead!
             let rbExn = RbException(message: "Unexpected Swift error thrown: \(error)")
-            set(type: RBG_RT_RAISE, value: rbExn.exception.withRubyValue { $0 })
+            rbExn.setRaise(returnValue: self)
         }
     }
 }
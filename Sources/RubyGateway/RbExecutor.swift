@@ -0,0 +1,216 @@
+//
+//  RbExecutor.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+/// A queue of work to run on a Ruby thread, that can be fed from any thread.
+///
+/// Ruby code can only run on Ruby threads, see `RbThread`.  An `RbExecutor`
+/// takes over one Ruby thread and runs closures submitted to it from other
+/// threads or Swift tasks, in the order they arrive:
+/// ```swift
+/// let executor = RbExecutor()
+///
+/// // On the main thread, or one from `RbThread.create(callback:)`
+/// try executor.run()
+///
+/// // Anywhere else
+/// executor.submit {
+///     try? Ruby.call("puts", args: ["Hello from Ruby"])
+/// }
+/// let total = try await executor.call {
+///     try Int(Ruby.eval(ruby: "[1, 2, 3].sum"))
+/// }
+/// ```
+///
+/// The executor holds the GVL only while it is running work.  If there is no
+/// work to do it waits without the GVL so that other Ruby threads keep running.
+/// Work submitted while the executor is busy is run in one go, without giving
+/// up the GVL between items.  Use `submit(batch:)` to queue several items
+/// together.
+///
+/// Swift `async` code using `call(_:)` does not hold the GVL while it is
+/// suspended: only the closure passed to `call(_:)` runs under the GVL.
+///
+/// Do not let `RbObject`s escape the closures: return Swift values instead.
+/// `RbObject`s must only be created and released on Ruby threads.
+public final class RbExecutor {
+    /// Protects everything below
+    private let condition = Condition()
+    /// A queued closure, plus how to tell a waiting `call(_:)` it won't run
+    private struct Work {
+        let run: () -> Void
+        let cancel: (() -> Void)?
+    }
+    /// Work waiting to run
+    private var queue: [Work] = []
+    /// Has `stop()` been called
+    private var stopping = false
+    /// Has Ruby asked the `run()` thread to stop waiting
+    private var interrupted = false
+
+    /// Create a new executor.  Use `run()` to start running work.
+    public init() {
+    }
+
+    /// Queue a closure to run on the executor's Ruby thread.
+    ///
+    /// This can be called from any thread.
+    public func submit(_ work: @escaping () -> Void) {
+        submit(batch: [work])
+    }
+
+    /// Queue some closures to run, one after the other, on the executor's
+    /// Ruby thread.
+    ///
+    /// This can be called from any thread.
+    public func submit(batch: [() -> Void]) {
+        submit(work: batch.map { Work(run: $0, cancel: nil) })
+    }
+
+    private func submit(work: [Work]) {
+        condition.locked {
+            queue.append(contentsOf: work)
+            condition.broadcast()
+        }
+    }
+
+    /// Make `run()` return once it has finished all the work queued so far.
+    ///
+    /// This can be called from any thread.
+    public func stop() {
+        condition.locked {
+            stopping = true
+            condition.broadcast()
+        }
+    }
+
+    /// Run queued work on the current thread until `stop()` is called.
+    ///
+    /// The current thread must be a Ruby thread.
+    ///
+    /// - throws: `RbError.badParameter(_:)` if the current thread is not
+    ///           a Ruby thread.
+    ///           `RbError.rubyException(_:)` or `RbError.rubyJump(_:)` if
+    ///           Ruby interrupts the thread, for example `Thread#raise`
+    ///           or `Thread#kill`.  Work queued by `submit(_:)` stays queued
+    ///           for the next `run()`; tasks waiting in `call(_:)` are resumed
+    ///           with `CancellationError`.
+    public func run() throws {
+        try Ruby.setup()
+        guard RbThread.isRubyThread() else {
+            try RbError.raise(error: .badParameter("RbExecutor.run() called on a non-Ruby thread."))
+        }
+        defer {
+            condition.locked { stopping = false }
+        }
+        do {
+            while let batch = try nextBatch() {
+                batch.forEach { $0.run() }
+            }
+        } catch {
+            cancelCalls()
+            throw error
+        }
+    }
+
+    /// Take work from `call(_:)`s off the queue and tell them it won't run
+    private func cancelCalls() {
+        let cancelled: [Work] = condition.locked {
+            let calls = queue.filter { $0.cancel != nil }
+            queue.removeAll { $0.cancel != nil }
+            return calls
+        }
+        cancelled.forEach { $0.cancel?() }
+    }
+
+    /// Wait for work to do, without the GVL unless there's some ready.
+    /// Returns `nil` when it's time to stop.
+    private func nextBatch() throws -> [Work]? {
+        var batch: [Work] = []
+
+        func takeWork() -> Bool {
+            swap(&batch, &queue)
+            let wasInterrupted = interrupted
+            interrupted = false
+            return !batch.isEmpty || stopping || wasInterrupted
+        }
+
+        let ready = condition.locked { takeWork() }
+        if !ready {
+            do {
+                // Throws whatever Ruby woke us up for
+                try RbThread.callWithoutGvlCheckingInterrupts(unblocking: .custom(interrupt)) {
+                    condition.locked {
+                        while !takeWork() {
+                            condition.wait()
+                        }
+                    }
+                }
+            } catch {
+                // Don't lose work taken just before Ruby got its way
+                condition.locked { queue.insert(contentsOf: batch, at: 0) }
+                throw error
+            }
+        }
+
+        if batch.isEmpty {
+            let isStopping = condition.locked { stopping }
+            return isStopping ? nil : []
+        }
+        return batch
+    }
+
+    /// Unblocking function for the wait in `nextBatch()`, called by Ruby
+    /// when it wants the thread back.
+    private func interrupt() {
+        condition.locked {
+            interrupted = true
+            condition.broadcast()
+        }
+    }
+}
+
+#if compiler(>=5.5) && canImport(_Concurrency)
+@available(macOS 10.15, iOS 13.0, tvOS 13.0, watchOS 6.0, *)
+extension RbExecutor {
+    /// Run a closure on the executor's Ruby thread and return its result.
+    ///
+    /// The calling task suspends until the closure has run.
+    ///
+    /// - parameter body: The code to run on the Ruby thread.
+    /// - returns: The result of `body`.
+    /// - throws: Whatever `body` throws.  `CancellationError` if `run()` exits
+    ///           because Ruby interrupts it before `body` runs.
+    public func call<T>(_ body: @escaping () throws -> T) async throws -> T {
+        try await withCheckedThrowingContinuation { continuation in
+            submit(work: [Work(run: { continuation.resume(with: Result { try body() }) },
+                               cancel: { continuation.resume(throwing: CancellationError()) })])
+        }
+    }
+
+    /// Run several closures one after the other on the executor's Ruby thread
+    /// and return their results.
+    ///
+    /// The closures are queued together and run without giving up the GVL
+    /// between them.  A closure throwing does not stop the rest running.
+    ///
+    /// - parameter bodies: The code to run on the Ruby thread.
+    /// - returns: The result of each closure, in order.  Each is a
+    ///            `CancellationError` if `run()` exits because Ruby interrupts
+    ///            it before they run.
+    public func call<T>(batch bodies: [() throws -> T]) async -> [Result<T, Error>] {
+        await withCheckedContinuation { continuation in
+            let run = {
+                continuation.resume(returning: bodies.map { body in Result { try body() } })
+            }
+            let cancel = {
+                continuation.resume(returning: bodies.map { _ -> Result<T, Error> in .failure(CancellationError()) })
+            }
+            submit(work: [Work(run: run, cancel: cancel)])
+        }
+    }
+}
+#endif
@@ -22,14 +22,36 @@
 ///
 /// If any methods in this interface do return `nil` then an `RbError` has been raised
 /// and suppressed.  You can access the most recent `RbError`s whether suppressed or not
-/// via `RbError.history`.
+/// via `RbError.history`.  Use `withoutHistory` to skip recording them when
+/// you don't need to know why something failed.
 public struct RbFailableAccess {
     /// The underlying throwing accessor
     private var access: RbObjectAccess
+    /// Record errors in `RbError.history`?
+    private let recordsErrors: Bool
 
     /// Create a new failable access interface to an object.
-    init(access: RbObjectAccess) {
+    init(access: RbObjectAccess, recordsErrors: Bool = true) {
         self.access = access
+        self.recordsErrors = recordsErrors
+    }
+
+    /// A version of this interface that does not record errors in `RbError.history`.
+    ///
+    /// This is cheaper when failures are expected:
+    /// ```swift
+    /// let name = obj.failable.withoutHistory.get("name")
+    /// ```
+    public var withoutHistory: RbFailableAccess {
+        return RbFailableAccess(access: access, recordsErrors: false)
+    }
+
+    /// Run a throwing accessor, suppressing history if required.
+    private func attempt<T>(_ body: () throws -> T) -> T? {
+        guard recordsErrors else {
+            return RbError.history.withoutRecording { try? body() }
+        }
+        return try? body()
     }
 }
 
@@ -58,7 +80,7 @@ extension RbFailableAccess {
     public func call(_ method: String,
                      args: [RbObjectConvertible?] = [],
                      kwArgs: KeyValuePairs<String, RbObjectConvertible?> = [:]) -> RbObject? {
-        return try? access.call(method, args: args, kwArgs: kwArgs)
+        return attempt { try access.call(method, args: args, kwArgs: kwArgs) }
     }
 
     /// Call a method of a Ruby object passing Swift code as a block.
@@ -78,7 +100,7 @@ extension RbFailableAccess {
                      kwArgs: KeyValuePairs<String, RbObjectConvertible?> = [:],
                      blockRetention: RbBlockRetention = .none,
                      blockCall: @escaping RbBlockCallback) -> RbObject? {
-        return try? access.call(method, args: args, kwArgs: kwArgs, blockRetention: blockRetention, blockCall: blockCall)
+        return attempt { try access.call(method, args: args, kwArgs: kwArgs, blockRetention: blockRetention, blockCall: blockCall) }
     }
 
     /// Call a method of a Ruby object passing a Ruby Proc as a block.
@@ -95,7 +117,7 @@ extension RbFailableAccess {
                      args: [RbObjectConvertible?] = [],
                      kwArgs: KeyValuePairs<String, RbObjectConvertible?> = [:],
                      block: RbObjectConvertible) -> RbObject? {
-        return try? access.call(method, args: args, kwArgs: kwArgs, block: block)
+        return attempt { try access.call(method, args: args, kwArgs: kwArgs, block: block) }
     }
 
     /// Call a method of a Ruby object using a symbol.
@@ -111,7 +133,7 @@ extension RbFailableAccess {
     public func call(symbol: RbObjectConvertible,
                      args: [RbObjectConvertible?] = [],
                      kwArgs: KeyValuePairs<String, RbObjectConvertible?> = [:]) -> RbObject? {
-        return try? access.call(symbol: symbol, args: args, kwArgs: kwArgs)
+        return attempt { try access.call(symbol: symbol, args: args, kwArgs: kwArgs) }
     }
 
     /// Call a method of a Ruby object using a symbol passing Swift code as a block.
@@ -132,7 +154,7 @@ extension RbFailableAccess {
                      kwArgs: KeyValuePairs<String, RbObjectConvertible?> = [:],
                      blockRetention: RbBlockRetention = .none,
                      blockCall: @escaping RbBlockCallback) -> RbObject? {
-        return try? access.call(symbol: symbol, args: args, kwArgs: kwArgs, blockRetention: blockRetention, blockCall: blockCall)
+        return attempt { try access.call(symbol: symbol, args: args, kwArgs: kwArgs, blockRetention: blockRetention, blockCall: blockCall) }
     }
 
     /// Call a method of a Ruby object using a symbol passing a Ruby Proc as a block.
@@ -150,7 +172,7 @@ extension RbFailableAccess {
                      args: [RbObjectConvertible?] = [],
                      kwArgs: KeyValuePairs<String, RbObjectConvertible?> = [:],
                      block: RbObjectConvertible) -> RbObject? {
-        return try? access.call(symbol: symbol, args: args, kwArgs: kwArgs, block: block)
+        return attempt { try access.call(symbol: symbol, args: args, kwArgs: kwArgs, block: block) }
     }
 }
 
@@ -165,7 +187,7 @@ extension RbFailableAccess {
     /// - parameter name: The attribute to access.
     /// - returns: The value of the attribute, or `nil` if an error occurred.
     public func getAttribute(_ name: String) -> RbObject? {
-        return try? access.getAttribute(name)
+        return attempt { try access.getAttribute(name) }
     }
 
     /// Set an attribute of a Ruby object.
@@ -177,7 +199,7 @@ extension RbFailableAccess {
     /// - parameter newValue: The new value for the attribute.
     /// - returns: The value set to the attribute, or `nil` if an error occurred.
     public func setAttribute(_ name: String, newValue: RbObjectConvertible?) -> RbObject? {
-        return try? access.setAttribute(name, newValue: newValue)
+        return attempt { try access.setAttribute(name, newValue: newValue) }
     }
 }
 
@@ -192,7 +214,7 @@ extension RbFailableAccess {
     /// - parameter name: The name of the constant to look up.
     /// - returns: An `RbObject` for the constant or `nil` if an error occurred.
     public func getConstant(_ name: String) -> RbObject? {
-        return try? access.getConstant(name)
+        return attempt { try access.getConstant(name) }
     }
 
     /// Get an `RbObject` that represents a Ruby class.
@@ -203,7 +225,7 @@ extension RbFailableAccess {
     /// - parameter name: The name of the class to look up.
     /// - returns: An `RbObject` for the class or `nil` if an error occurred.
     public func getClass(_ name: String) -> RbObject? {
-        return try? access.getClass(name)
+        return attempt { try access.getClass(name) }
     }
 
     /// Bind an object to a constant name.
@@ -216,7 +238,7 @@ extension RbFailableAccess {
     /// - returns: The value set for the constant or `nil` if an error occurred.
     @discardableResult
     public func setConstant(_ name: String, newValue: RbObjectConvertible?) -> RbObject? {
-        return try? access.setConstant(name, newValue: newValue)
+        return attempt { try access.setConstant(name, newValue: newValue) }
     }
 }
 
@@ -231,7 +253,7 @@ extension RbFailableAccess {
     /// - parameter name: Name of the IVar.  Must begin with a single `@`.
     /// - returns: Value of the IVar, or `nil` if an error occurred.
     public func getInstanceVar(_ name: String) -> RbObject? {
-        return try? access.getInstanceVar(name)
+        return attempt { try access.getInstanceVar(name) }
     }
 
     /// Set a Ruby instance variable.
@@ -244,7 +266,7 @@ extension RbFailableAccess {
     /// - returns: The value that was set, or nil if an error occurred.
     @discardableResult
     public func setInstanceVar(_ name: String, newValue: RbObjectConvertible?) -> RbObject? {
-        return try? access.setInstanceVar(name, newValue: newValue)
+        return attempt { try access.setInstanceVar(name, newValue: newValue) }
     }
 }
 
@@ -261,7 +283,7 @@ extension RbFailableAccess {
     /// - parameter name: Name of the CVar.  Must begin with `@@`.
     /// - returns: Value of the CVar, or `nil` if an error occurred.
     public func getClassVar(_ name: String) -> RbObject? {
-        return try? access.getClassVar(name)
+        return attempt { try access.getClassVar(name) }
     }
 
     /// Set or create a Ruby class variable.
@@ -276,7 +298,7 @@ extension RbFailableAccess {
     /// - returns: The value that was set, or `nil` if an error occurred.
     @discardableResult
     public func setClassVar(_ name: String, newValue: RbObjectConvertible?) -> RbObject? {
-        return try? access.setClassVar(name, newValue: newValue)
+        return attempt { try access.setClassVar(name, newValue: newValue) }
     }
 }
 
@@ -291,7 +313,7 @@ extension RbFailableAccess {
     /// - parameter name: Name of the global variable.  Must begin with `$`.
     /// - returns: Value of the variable, or `nil` if an error occurred.
     public func getGlobalVar(_ name: String) -> RbObject? {
-        return try? access.getGlobalVar(name)
+        return attempt { try access.getGlobalVar(name) }
     }
 
     /// Set a Ruby global variable.
@@ -304,7 +326,7 @@ extension RbFailableAccess {
     /// - returns: The value that was set, or `nil` if an error occurred.
     @discardableResult
     public func setGlobalVar(_ name: String, newValue: RbObjectConvertible?) -> RbObject? {
-        return try? access.setGlobalVar(name, newValue: newValue)
+        return attempt { try access.setGlobalVar(name, newValue: newValue) }
     }
 }
 
@@ -320,6 +342,6 @@ extension RbFailableAccess {
     /// - returns: Retrieved object, or `nil` if an error occurred.
     @discardableResult
     public func get(_ name: String) -> RbObject? {
-        return try? access.get(name)
+        return attempt { try access.get(name) }
     }
 }
@@ -0,0 +1,207 @@
+//
+//  RbGC.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+@_implementationOnly import CRuby
+
+/// Control of the Ruby garbage collector, available as `RbGateway.gc`.
+///
+/// Ruby collects garbage when it needs memory, which can be in the middle of
+/// some latency-sensitive piece of work.  Use this to move that work somewhere
+/// better, for example between requests:
+/// ```swift
+/// for request in requests {
+///     try Ruby.gc.withDisabled {
+///         try handle(request)
+///     }
+///     try Ruby.gc.step()
+/// }
+/// ```
+///
+/// Objects held by `RbObject`s do not stop `compact()` moving them, so
+/// a long-running program can compact its heap from time to time.
+///
+/// Use from a Ruby thread.
+public struct RbGC {
+    init() {
+    }
+
+    /// The Ruby `GC` module
+    private func module() throws -> RbObject {
+        try Ruby.get("GC")
+    }
+
+    // MARK: - Enabling
+
+    /// Stop garbage collection, as `GC.disable`.
+    ///
+    /// Ruby grows its heap as needed until `enable()` is called.
+    ///
+    /// - returns: `true` if garbage collection was already disabled.
+    /// - throws: `RbError.setup(_:)` if Ruby is not working.
+    @discardableResult
+    public func disable() throws -> Bool {
+        try Ruby.setup()
+        return rb_gc_disable() == Qtrue
+    }
+
+    /// Start garbage collection again, as `GC.enable`.
+    ///
+    /// Garbage that built up while it was disabled is collected the next
+    /// time Ruby needs memory.  Call `start(fullMark:immediateSweep:)` to do
+    /// that now instead.
+    ///
+    /// - returns: `true` if garbage collection was disabled.
+    /// - throws: `RbError.setup(_:)` if Ruby is not working.
+    @discardableResult
+    public func enable() throws -> Bool {
+        try Ruby.setup()
+        return rb_gc_enable() == Qtrue
+    }
+
+    /// Run some code with garbage collection disabled.
+    ///
+    /// Garbage collection is enabled again afterwards unless it was already
+    /// disabled.
+    ///
+    /// - parameter body: The code to run.
+    /// - returns: Whatever `body` returns.
+    /// - throws: `RbError.setup(_:)` if Ruby is not working.  Whatever `body` throws.
+    public func withDisabled<T>(_ body: () throws -> T) throws -> T {
+        let wasDisabled = try disable()
+        defer {
+            if !wasDisabled {
+                rb_gc_enable()
+            }
+        }
+        return try body()
+    }
+
+    // MARK: - Collecting
+
+    /// Collect garbage now, as `GC.start`.
+    ///
+    /// This works even if garbage collection is disabled.
+    ///
+    /// - parameter fullMark: Look at all objects rather than just the young
+    ///             ones.  Default `true`.
+    /// - parameter immediateSweep: Free all the garbage before returning
+    ///             rather than a bit at a time as Ruby allocates.  Default `true`.
+    /// - throws: `RbError.rubyException(_:)` if Ruby raises an exception.
+    public func start(fullMark: Bool = true, immediateSweep: Bool = true) throws {
+        try module().call("start", kwArgs: ["full_mark": fullMark, "immediate_sweep": immediateSweep])
+    }
+
+    /// Do a quick collection of just the young objects, leaving the garbage to
+    /// be freed a bit at a time as Ruby allocates.
+    ///
+    /// Ruby does not let a program drive its incremental collector directly;
+    /// this is the cheapest way to let the collector catch up at a convenient
+    /// time.
+    ///
+    /// - throws: `RbError.rubyException(_:)` if Ruby raises an exception.
+    public func step() throws {
+        try start(fullMark: false, immediateSweep: false)
+    }
+
+    /// Collect garbage and move the remaining objects closer together, as
+    /// `GC.compact`.
+    ///
+    /// Compaction needs Ruby 2.7 or later, and some platforms don't support it.
+    ///
+    /// - throws: `RbError.badParameter(_:)` if Ruby is earlier than 2.7.
+    ///           `RbError.rubyException(_:)` if Ruby raises an exception, for
+    ///           example `NotImplementedError` if the platform can't compact.
+    public func compact() throws {
+        try Ruby.setup()
+        let version = Ruby.apiVersion
+        guard version.0 > 2 || (version.0 == 2 && version.1 >= 7) else {
+            try RbError.raise(error: .badParameter("GC.compact needs Ruby 2.7 or later, have \(Ruby.version)."))
+        }
+        try module().call("compact")
+    }
+
+    /// Tell Ruby about memory that Ruby objects hold outside of its heap.
+    ///
+    /// Ruby decides when to collect garbage partly on how much memory it has
+    /// allocated.  If Ruby objects keep alive large Swift allocations then say
+    /// so here -- with a negative value when they are freed -- so that Ruby
+    /// collects those objects in good time.
+    ///
+    /// - parameter bytes: The change in memory usage.
+    /// - throws: `RbError.setup(_:)` if Ruby is not working.
+    public func adjustMemoryUsage(by bytes: Int) throws {
+        try Ruby.setup()
+        rb_gc_adjust_memory_usage(bytes)
+    }
+
+    // MARK: - Statistics
+
+    /// The number of times garbage has been collected, as `GC.count`.
+    ///
+    /// This is cheaper than `stats()`.  It is 0 if Ruby is not working.
+    public var count: Int {
+        guard Ruby.softSetup() else {
+            return 0
+        }
+        return Int(rb_gc_count())
+    }
+
+    /// Statistics about garbage collection, from `GC.stat`.
+    public struct Stats {
+        /// All the statistics, named as in `GC.stat`.  Which are present
+        /// depends on the Ruby version.
+        public let values: [String: Int]
+
+        private func value(_ name: String) -> Int {
+            values[name, default: 0]
+        }
+
+        /// The number of times garbage has been collected.
+        public var count: Int { value("count") }
+        /// The number of collections of just young objects.
+        public var minorCount: Int { value("minor_gc_count") }
+        /// The number of collections of all objects.
+        public var majorCount: Int { value("major_gc_count") }
+        /// The number of compactions.  0 before Ruby 3.0.
+        public var compactCount: Int { value("compact_count") }
+        /// The total time spent collecting garbage, in milliseconds.  0 before Ruby 3.1.
+        public var totalMilliseconds: Int { value("time") }
+        /// The number of pages in the heap.
+        public var heapAllocatedPages: Int { value("heap_allocated_pages") }
+        /// The number of heap slots holding objects.
+        public var heapLiveSlots: Int { value("heap_live_slots") }
+        /// The number of empty heap slots.
+        public var heapFreeSlots: Int { value("heap_free_slots") }
+        /// The number of objects that have survived enough collections to be old.
+        public var oldObjects: Int { value("old_objects") }
+        /// The number of objects ever allocated.
+        public var totalAllocatedObjects: Int { value("total_allocated_objects") }
+        /// The number of objects ever freed.
+        public var totalFreedObjects: Int { value("total_freed_objects") }
+        /// The number of bytes allocated outside the heap since the last collection.
+        public var mallocIncreaseBytes: Int { value("malloc_increase_bytes") }
+    }
+
+    /// Get statistics about garbage collection, as `GC.stat`.
+    ///
+    /// - returns: The current statistics.
+    /// - throws: `RbError.rubyException(_:)` if Ruby raises an exception.
+    ///           `RbError.badType(_:)` if Ruby's statistics are not all integers.
+    public func stats() throws -> Stats {
+        let statObject = try module().call("stat")
+        guard let values = [String: Int](statObject) else {
+            try RbError.raise(error: .badType("Can't convert GC.stat \(statObject) to [String: Int]."))
+        }
+        return Stats(values: values)
+    }
+}
+
+extension RbGateway {
+    /// Control of the Ruby garbage collector.  See `RbGC`.
+    public var gc: RbGC {
+        RbGC()
+    }
+}
@@ -64,19 +64,35 @@ public final class RbGateway: RbObjectAccess {
     static let vm = RbVM()
 
     init() {
-        super.init(getValue: { rb_cObject })
+        super.init()
+    }
+
+    /// For `RbObjectAccess`: the top self is `Object`
+    override func getValue() -> VALUE {
+        return rb_cObject
     }
 
     /// Initialize Ruby.  Throw an error if Ruby is not working.
     /// Called by anything that might by the first op.
     func setup() throws {
         if try RbGateway.vm.setup() {
-            try! require(filename: "set")
             // Work around Swift not calling static deinit...
             atexit { RbGateway.vm.cleanup() }
         }
     }
 
+    /// Has `set` been required yet
+    private static var setLoaded = false
+
+    /// Make sure Ruby's `Set` is available.  Required on first use rather
+    /// than at startup so programs that don't convert sets don't pay for it.
+    func requireSet() throws {
+        if !RbGateway.setLoaded {
+            try require(filename: "set")
+            RbGateway.setLoaded = true
+        }
+    }
+
     /// Explicitly shut down Ruby and release resources.
     /// This includes calling `END{}` code and procs registered by `Kernel.#at_exit`.
     ///
@@ -104,6 +120,21 @@ public final class RbGateway: RbObjectAccess {
         return try RbGateway.vm.getID(for: name)
     }
 
+    /// Get `ID`s for a list of names in one go.
+    ///
+    /// Subsequent lookups of these names, including those made implicitly by
+    /// `RbObjectAccess.call(_:args:kwArgs:)` and friends, are faster and take no
+    /// locks.  Use this at startup with the method and constant names that your
+    /// program uses most.
+    ///
+    /// - parameter names: Names to look up, typically constant or method names.
+    /// - throws: `RbError.rubyException(_:)` if Ruby raises an exception.  This
+    ///   probably means the `ID` space is full, which is fairly unlikely.
+    public func preloadIDs(for names: [String]) throws {
+        try setup()
+        try RbGateway.vm.preloadIDs(for: names)
+    }
+
     /// Attempt to initialize Ruby but swallow any error.
     ///
     /// This is for use from places that could be the first use of Ruby but it
@@ -283,6 +314,10 @@ extension RbGateway {
 extension RbGateway {
     /// Evaluate some Ruby and return the result.
     ///
+    /// The code is parsed and compiled on every call.  Use `compile(ruby:localNames:)`
+    /// for code you run many times, or set `evalCacheCapacity` to keep repeated
+    /// code compiled.
+    ///
     /// - parameter ruby: Ruby code to execute at the top level.
     /// - returns: The result of executing the code.
     /// - throws: `RbError` if something goes wrong.
@@ -292,6 +327,9 @@ extension RbGateway {
     @discardableResult
     public func eval(ruby: String) throws -> RbObject {
         try setup()
+        if let script = try RbGateway.scriptCache.script(for: ruby) {
+            return try script.run()
+        }
         return RbObject(rubyValue: try RbVM.doProtect { tag in
             rb_eval_string_protect(ruby, &tag)
         })
@@ -307,9 +345,28 @@ extension RbGateway {
     ///           couldn't find the file.
     @discardableResult
     public func require(filename: String) throws -> Bool {
-        // Have to use eval so that gems work - rubygems/kernel_require.rb replaces
+        // Have to call the method so that gems work - rubygems/kernel_require.rb replaces
         // `Kernel#require` so it can do the gem thing, so `rb_require` is no good.
-        return try eval(ruby: "require '\(filename)'").isTruthy
+        return try call("require", args: [filename]).isTruthy
+    }
+
+    /// Load several Ruby files once-only, in order.  See `require(filename:)`.
+    ///
+    /// Use this at startup to load many files without looking up `require`
+    /// for each one.  To avoid compiling the files every time the program
+    /// runs, see `enableLoadCache(directory:)`.
+    ///
+    /// - parameter filenames: The names of the files to load.
+    /// - returns: For each file, `true` if it was loaded OK, `false` if it
+    ///            was already loaded.
+    /// - throws: `RbError` if something goes wrong.  Files after the one that
+    ///           failed are not loaded.
+    @discardableResult
+    public func require(filenames: [String]) throws -> [Bool] {
+        let requireSite = try callSite("require", arity: 1)
+        return try filenames.map { filename in
+            try requireSite.call(RbObject(filename)).isTruthy
+        }
     }
 
     /// See Ruby `Kernel#load`. Load a file, reloads if already loaded.
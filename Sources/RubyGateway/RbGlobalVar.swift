@@ -10,21 +10,22 @@
 // Some simple thunking code to wrap up rb_gvar_* code.
 //
 // We support only 'virtual' gvars which are the most general kind - the 'bound'
-// style doesn't work so well with our immutable `RbObject` pattern.
+// style doesn't work so well with our immutable `RbObject` pattern.  Plus a
+// 'cached' variation where Ruby reads a `VALUE` that Swift updates.
 
-// MARK: Callbacks from C code (rbg_value.m)
+// MARK: Callbacks from C code (rbg_protect.m)
 
-private func rbobject_gvar_get_callback(id: ID) -> VALUE {
-    return RbGlobalVar.get(id: id)
+private func rbobject_gvar_get_callback(context: UnsafeMutableRawPointer) -> VALUE {
+    return RbGlobalVar.Context.from(context).get()
 }
 
-private func rbobject_gvar_set_callback(id: ID,
+private func rbobject_gvar_set_callback(context: UnsafeMutableRawPointer,
                                         newValue: VALUE,
                                         returnValue: UnsafeMutablePointer<Rbg_return_value>) {
-    RbGlobalVar.set(id: id, newValue: newValue, returnValue: returnValue)
+    RbGlobalVar.Context.from(context).set(newValue: newValue, returnValue: returnValue)
 }
 
-private enum RbGlobalVar {
+internal enum RbGlobalVar {
 
     /// One-time init to register the callbacks
     private static var initOnce: Void = {
@@ -32,51 +33,142 @@ private enum RbGlobalVar {
                                     rbobject_gvar_set_callback)
     }()
 
-    /// Callbacks + store - type-erased at this point
-    private struct Context {
-        let get: () -> RbObject
-        let set: ((RbObject) throws -> Void)?
+    /// Callbacks + store - type-erased at this point.  Ruby has a pointer
+    /// to this in the gvar's data.
+    final class Context {
+        private let getter: (() -> RbObject)?
+        /// Returns the converted value to cache
+        private let setter: ((RbObject) throws -> RbObjectConvertible)?
+        private var gvar: UnsafeMutablePointer<Rbg_gvar>!
+        /// Swift version of the cached value
+        private(set) var cachedValue: RbObjectConvertible?
+
+        init(name: String,
+             get: (() -> RbObject)?,
+             set: ((RbObject) throws -> RbObjectConvertible)?,
+             cachedValue: RbObjectConvertible?) {
+            getter = get
+            setter = set
+            self.cachedValue = cachedValue
+            let initialValue = cachedValue?.rubyObject ?? .nilObject
+            gvar = initialValue.withRubyValue { value in
+                rbg_create_virtual_gvar(name,
+                                        set == nil ? 1 : 0,
+                                        cachedValue == nil ? 0 : 1,
+                                        value,
+                                        Unmanaged.passUnretained(self).toOpaque())
+            }
+        }
+
+        deinit {
+            rbg_gvar_free(gvar)
+        }
+
+        static func from(_ raw: UnsafeMutableRawPointer) -> Context {
+            Unmanaged<Context>.fromOpaque(raw).takeUnretainedValue()
+        }
+
+        /// Update the value Ruby reads.  Ruby marks the `VALUE` in the gvar so
+        /// it's safe to let go of the `RbObject`.
+        func cache(_ value: RbObjectConvertible) {
+            cachedValue = value
+            gvar.pointee.value = value.rubyObject.withRubyValue { $0 }
+        }
+
+        fileprivate func get() -> VALUE {
+            guard let getter = getter else {
+                return Qnil // unreachable, Ruby reads the cache
+            }
+            return getter().withRubyValue { $0 }
+        }
+
+        fileprivate func set(newValue: VALUE, returnValue: UnsafeMutablePointer<Rbg_return_value>) {
+            guard let setter = setter else {
+                return // unreachable, Ruby raises
+            }
+            returnValue.setFrom {
+                let converted = try setter(RbObject(rubyValue: newValue))
+                if cachedValue != nil {
+                    cache(converted)
+                }
+                return Qnil
+            }
+        }
     }
 
-    private static var contexts: [ID: Context] = [:]
+    /// Keep contexts alive while Ruby may use them.  Redefining a gvar
+    /// points Ruby at the new one, freeing the old.
+    private static var contexts: [String: Context] = [:]
+
+    // Type-erase `set`
+    private static func makeSetter<T: RbObjectConvertible>(_ set: ((T) throws -> Void)?) -> ((RbObject) throws -> RbObjectConvertible)? {
+        set.map { set in
+            { (newRbObject: RbObject) throws -> RbObjectConvertible in
+                guard let typed = T(newRbObject) else {
+                    throw RbException(message: "Bad type of \(newRbObject) expected \(T.self)")
+                }
+                try set(typed)
+                return typed
+            }
+        }
+    }
 
-    /// Create thunks to 
+    /// Create thunks to call `get` and `set`.
     static func create<T: RbObjectConvertible>(name: String,
                        get: @escaping () -> T,
                        set: ((T) throws -> Void)?) {
         let _ = initOnce
-        let id = rbg_create_virtual_gvar(name, set == nil ? 1 : 0)
-        let getter = { get().rubyObject }
-        if let set = set {
-            contexts[id] = Context(get: getter,
-                                   set: { newRbObject in
-                                          guard let typed = T(newRbObject) else {
-                                              throw RbException(message: "Bad type of \(newRbObject) expected \(T.self)")
-                                          }
-                                          try set(typed)
-                                        }
-                                  )
-        }
-        else {
-            contexts[id] = Context(get: getter, set: nil)
-        }
+        contexts[name] = Context(name: name,
+                                 get: { get().rubyObject },
+                                 set: makeSetter(set),
+                                 cachedValue: nil)
     }
 
-    fileprivate static func get(id: ID) -> VALUE {
-        if let context = contexts[id] {
-            let object = context.get()
-            return object.withRubyValue { $0 }
-        }
-        return Qnil // practically unreachable
+    /// Create a gvar that Ruby reads directly.
+    static func create<T: RbObjectConvertible>(name: String,
+                       cachedValue: T,
+                       set: ((T) throws -> Void)?) -> Context {
+        let _ = initOnce
+        let context = Context(name: name,
+                              get: nil,
+                              set: makeSetter(set),
+                              cachedValue: cachedValue)
+        contexts[name] = context
+        return context
     }
+}
 
-    fileprivate static func set(id: ID, newValue: VALUE, returnValue: UnsafeMutablePointer<Rbg_return_value>) {
-        if let context = contexts[id],
-            let setter = context.set {
-            returnValue.setFrom {
-                try setter(RbObject(rubyValue: newValue))
-                return Qnil
-            }
+// MARK: Cached Global Variables
+
+/// A Ruby global variable whose value Swift stores in Ruby.
+///
+/// Create one with `RbGateway.defineGlobalVar(_:cachedValue:)`.  Ruby reads the
+/// stored value directly without calling Swift, which makes this cheaper than
+/// a computed global variable when Ruby reads it much more often than it
+/// changes.  Set `value` to change what Ruby reads.
+///
+/// Use from a Ruby thread.
+public final class RbCachedGlobalVar<T: RbObjectConvertible> {
+    private let context: RbGlobalVar.Context
+
+    init(context: RbGlobalVar.Context) {
+        self.context = context
+    }
+
+    /// The value of the global variable.
+    ///
+    /// If Ruby code assigns to the global variable then this is the
+    /// new value converted to `T`.
+    ///
+    /// Setting this after the global variable has been defined again by
+    /// a different `RbGateway.defineGlobalVar(...)` call has no effect.
+    public var value: T {
+        get {
+            // Only ever set from `T`s
+            context.cachedValue as! T
+        }
+        set {
+            context.cache(newValue)
         }
     }
 }
@@ -125,4 +217,48 @@ extension RbGateway {
         try name.checkRubyGlobalVarName()
         RbGlobalVar.create(name: name, get: get, set: set)
     }
+
+    /// Create a readonly Ruby global variable whose value Swift stores in Ruby.
+    ///
+    /// Ruby reads the value without calling Swift.  Set `RbCachedGlobalVar.value`
+    /// to change it.
+    ///
+    /// - parameters:
+    ///   - name: The name of the global variable.  Must begin with `$`.  Any existing global
+    ///           variable with this name is overwritten.
+    ///   - cachedValue: The initial value of the global variable.
+    /// - returns: The global variable, for updating its value.
+    /// - throws: `RbError.badIdentifier(type:id:)` if `name` is bad; some other kind of error if Ruby is
+    ///           not working.
+    @discardableResult
+    public func defineGlobalVar<T: RbObjectConvertible>(_ name: String,
+                                                        cachedValue: T) throws -> RbCachedGlobalVar<T> {
+        try setup()
+        try name.checkRubyGlobalVarName()
+        return RbCachedGlobalVar(context: RbGlobalVar.create(name: name, cachedValue: cachedValue, set: nil))
+    }
+
+    /// Create a read-write Ruby global variable whose value Swift stores in Ruby.
+    ///
+    /// Ruby reads the value without calling Swift.  When Ruby code writes the global
+    /// variable, `set` is called with the new value and then Ruby reads that value.
+    /// Errors thrown from `set` propagate into Ruby as exceptions and leave the
+    /// value unchanged.
+    ///
+    /// - parameters:
+    ///   - name: The name of the global variable.  Must begin with `$`.  Any existing global
+    ///           variable with this name is overwritten.
+    ///   - cachedValue: The initial value of the global variable.
+    ///   - set: Function called whenever Ruby code writes the global variable.
+    /// - returns: The global variable, for updating its value.
+    /// - throws: `RbError.badIdentifier(type:id:)` if `name` is bad; some other kind of error if Ruby is
+    ///           not working.
+    @discardableResult
+    public func defineGlobalVar<T: RbObjectConvertible>(_ name: String,
+                                                        cachedValue: T,
+                                                        set: @escaping (T) throws -> Void) throws -> RbCachedGlobalVar<T> {
+        try setup()
+        try name.checkRubyGlobalVarName()
+        return RbCachedGlobalVar(context: RbGlobalVar.create(name: name, cachedValue: cachedValue, set: set))
+    }
 }
@@ -0,0 +1,136 @@
+//
+//  RbIOBuffer.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+@_implementationOnly import CRuby
+@_implementationOnly import RubyGatewayHelpers
+
+/// Keeps Swift memory shared with Ruby alive until Ruby is done with it.
+private final class RbIOBufferOwner {
+    let owner: AnyObject?
+    let deallocate: (() -> Void)?
+
+    init(owner: AnyObject?, deallocate: (() -> Void)? = nil) {
+        self.owner = owner
+        self.deallocate = deallocate
+    }
+
+    deinit {
+        deallocate?()
+    }
+
+    /// One-time init to register the callback
+    static var initOnce: Void = {
+        rbg_register_buffer_release_callback(rbbuffer_release)
+    }()
+}
+
+// Called from rbg_protect.m / rbg_buffer_owner_free
+private func rbbuffer_release(owner: UnsafeMutableRawPointer) {
+    Unmanaged<RbIOBufferOwner>.fromOpaque(owner).release()
+}
+
+// MARK: - IO::Buffer
+
+extension RbObject {
+    /// Share some memory with Ruby as a read-only `IO::Buffer`, without copying it.
+    ///
+    /// Ruby can read the memory through the buffer and slices of it.  The
+    /// memory must stay valid until Ruby has garbage-collected them all: Ruby
+    /// keeps a reference to `owner` until then.  For example, to share a
+    /// memory-mapped file:
+    /// ```swift
+    /// final class MappedFile {
+    ///     let bytes: UnsafeRawBufferPointer
+    ///     ...
+    ///     deinit { munmap(...) }
+    /// }
+    ///
+    /// let file = try MappedFile(path: path)
+    /// let buffer = try RbObject(ioBufferFor: file.bytes, owner: file)
+    /// ```
+    ///
+    /// The buffer is locked so Ruby code cannot `free` or `transfer` it.
+    /// `IO::Buffer` needs Ruby 3.1 or later.
+    ///
+    /// - parameter bytes: The memory to share.
+    /// - parameter owner: Something that keeps `bytes` valid for as long as it
+    ///             exists, or `nil` if `bytes` are valid forever.
+    /// - throws: `RbError.badParameter(_:)` if Ruby is earlier than 3.1.
+    ///           `RbError.rubyException(_:)` if Ruby can't create the buffer.
+    public convenience init(ioBufferFor bytes: UnsafeRawBufferPointer, owner: AnyObject?) throws {
+        self.init(rubyValue: try RbObject.makeIOBuffer(base: UnsafeMutableRawPointer(mutating: bytes.baseAddress),
+                                                       count: bytes.count,
+                                                       readOnly: true,
+                                                       owner: RbIOBufferOwner(owner: owner)))
+    }
+
+    /// Share some memory with Ruby as a writable `IO::Buffer`, without copying it.
+    ///
+    /// Ruby can read and write the memory through the buffer and slices of it.
+    /// See `init(ioBufferFor:owner:)` for the rules about `owner`.
+    ///
+    /// - parameter bytes: The memory to share.
+    /// - parameter owner: Something that keeps `bytes` valid for as long as it
+    ///             exists, or `nil` if `bytes` are valid forever.
+    /// - throws: `RbError.badParameter(_:)` if Ruby is earlier than 3.1.
+    ///           `RbError.rubyException(_:)` if Ruby can't create the buffer.
+    public convenience init(ioBufferFor bytes: UnsafeMutableRawBufferPointer, owner: AnyObject?) throws {
+        self.init(rubyValue: try RbObject.makeIOBuffer(base: bytes.baseAddress,
+                                                       count: bytes.count,
+                                                       readOnly: false,
+                                                       owner: RbIOBufferOwner(owner: owner)))
+    }
+
+    /// Create an `IO::Buffer` from bytes written straight into its memory.
+    ///
+    /// This is how to pass Ruby data produced in Swift, such as a decoded
+    /// image, without copying it into a Ruby string.  The memory is
+    /// allocated by Swift and freed when Ruby has garbage-collected the
+    /// buffer and all its slices.
+    /// ```swift
+    /// let buffer = try RbObject(ioBufferCount: frame.size) { bytes in
+    ///     try frame.serialize(into: bytes)
+    /// }
+    /// ```
+    ///
+    /// - parameter count: The size of the buffer in bytes.
+    /// - parameter readOnly: Stop Ruby code changing the buffer?  Default `true`.
+    /// - parameter body: Writes the buffer's contents.
+    /// - throws: `RbError.badParameter(_:)` if Ruby is earlier than 3.1.
+    ///           `RbError.rubyException(_:)` if Ruby can't create the buffer.
+    ///           Whatever `body` throws.
+    public convenience init(ioBufferCount count: Int,
+                            readOnly: Bool = true,
+                            initializingWith body: (UnsafeMutableRawBufferPointer) throws -> Void) throws {
+        let bytes = UnsafeMutableRawBufferPointer.allocate(byteCount: count, alignment: 16)
+        let owner = RbIOBufferOwner(owner: nil) { bytes.deallocate() }
+        try body(bytes)
+        self.init(rubyValue: try RbObject.makeIOBuffer(base: bytes.baseAddress,
+                                                       count: count,
+                                                       readOnly: readOnly,
+                                                       owner: owner))
+    }
+
+    private static func makeIOBuffer(base: UnsafeMutableRawPointer?, count: Int,
+                                     readOnly: Bool, owner: RbIOBufferOwner) throws -> VALUE {
+        try Ruby.setup()
+        let version = Ruby.apiVersion
+        guard version.0 > 3 || (version.0 == 3 && version.1 >= 1) else {
+            try RbError.raise(error: .badParameter("IO::Buffer needs Ruby 3.1 or later, have \(Ruby.version)."))
+        }
+        let _ = RbIOBufferOwner.initOnce
+        let ownerPtr = Unmanaged.passRetained(owner).toOpaque()
+        do {
+            return try RbVM.doProtect { tag in
+                rbg_io_buffer_new_protect(base, count, readOnly ? 1 : 0, ownerPtr, &tag)
+            }
+        } catch {
+            // Ruby never took the owner
+            Unmanaged<RbIOBufferOwner>.fromOpaque(ownerPtr).release()
+            throw error
+        }
+    }
+}
@@ -0,0 +1,109 @@
+//
+//  RbInternedString.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+@_implementationOnly import CRuby
+@_implementationOnly import RubyGatewayHelpers
+
+/// Frozen Ruby strings for Swift strings, shared between uses.
+///
+/// The strings come from Ruby's own table of deduplicated strings, the one
+/// behind `String#-@` and frozen string literals, so are the same objects
+/// Ruby code gets for the same text.  The cache saves looking them up
+/// again and keeps them alive.  It holds `RbObject`s rather than `VALUE`s
+/// because `GC.compact` can move the strings.
+///
+/// Only used with the GVL held, which serializes access.
+final class RbInternedStringCache {
+    /// Maximum number of strings to keep
+    var capacity: Int {
+        didSet {
+            if objects.count > capacity {
+                clear()
+            }
+        }
+    }
+    /// Cached strings
+    private var objects: [String: RbObject] = [:]
+
+    init(capacity: Int) {
+        self.capacity = capacity
+    }
+
+    /// Get the frozen Ruby string for some text, caching it if there's room.
+    func object(for string: String) throws -> RbObject {
+        if let object = objects[string] {
+            return object
+        }
+        var string = string
+        let value = try string.withUTF8 { utf8 in
+            try RbVM.doProtect { tag in
+                utf8.withMemoryRebound(to: CChar.self) { chars in
+                    guard let base = chars.baseAddress else {
+                        return rbg_interned_str_protect("", 0, &tag)
+                    }
+                    return rbg_interned_str_protect(base, chars.count, &tag)
+                }
+            }
+        }
+        let object = RbObject(rubyValue: value)
+        if objects.count < capacity {
+            objects[string] = object
+        }
+        return object
+    }
+
+    /// Forget all the strings
+    func clear() {
+        objects = [:]
+    }
+
+    /// The number of cached strings
+    var count: Int {
+        objects.count
+    }
+}
+
+extension RbGateway {
+    /// The cache behind `RbObject.init(interned:)`
+    static let internedStringCache = RbInternedStringCache(capacity: 4096)
+
+    /// The number of distinct strings `RbObject.init(interned:)` remembers.
+    ///
+    /// Strings beyond this are still deduplicated by Ruby but are looked up
+    /// each time.  Set to 0 to look up every time.  Default 4096.
+    public var internedStringCacheCapacity: Int {
+        get {
+            RbGateway.internedStringCache.capacity
+        }
+        set {
+            RbGateway.internedStringCache.capacity = newValue
+        }
+    }
+}
+
+extension RbObject {
+    /// Create a frozen Ruby string that is shared with other uses of the same text.
+    ///
+    /// `String.rubyObject` makes a new Ruby string each time, which Ruby must
+    /// later garbage-collect.  For strings used over and over, such as hash
+    /// keys or status values, this initializer returns the same frozen
+    /// Ruby string every time.  It is the same object that Ruby's
+    /// `-"text"` gives.
+    ///
+    /// Ruby code that tries to modify the string raises `FrozenError`.
+    ///
+    /// See `RbGateway.internedStringCacheCapacity`.
+    ///
+    /// - parameter interned: The text for the string.
+    public convenience init(interned string: String) {
+        guard Ruby.softSetup(),
+            let object = try? RbGateway.internedStringCache.object(for: string) else {
+            self.init(rubyValue: Qnil)
+            return
+        }
+        self.init(object)
+    }
+}
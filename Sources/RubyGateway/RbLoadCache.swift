@@ -0,0 +1,119 @@
+//
+//  RbLoadCache.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+// MARK: - Compiled file cache
+
+extension RbGateway {
+    /// The module hooked into `RubyVM::InstructionSequence`, created on first use
+    private static var loadCacheModule: RbObject?
+
+    private static func loadCache() throws -> RbObject {
+        if let loadCacheModule = loadCacheModule {
+            return loadCacheModule
+        }
+        let newModule = try Ruby.eval(ruby: loadCacheSource)
+        try Ruby.get("RubyVM::InstructionSequence").call("singleton_class").call("prepend", args: [newModule])
+        loadCacheModule = newModule
+        return newModule
+    }
+
+    /// Cache compiled versions of Ruby files on disk.
+    ///
+    /// Loading a Ruby file, for example using `require(filename:)`, normally
+    /// means parsing and compiling it.  With the cache enabled, the compiled
+    /// code for each file is saved under `directory` and used next time the
+    /// file is loaded, even by a different process.  This makes programs that
+    /// load many files start up faster.
+    ///
+    /// A cache entry is used only if the file's path, modification time, and
+    /// size match, and the Ruby version is the same.  Otherwise the file is
+    /// compiled as normal and the entry replaced.  Errors reading or writing
+    /// the cache are ignored: the file is loaded without it.
+    ///
+    /// Call this before loading the files, typically straight after startup.
+    /// Code run by `eval(ruby:)` is not cached: see `compile(ruby:localNames:)`.
+    ///
+    /// - parameter directory: The directory for the cache.  Created if necessary.
+    /// - throws: `RbError.rubyException(_:)` if Ruby can't set up the cache.
+    public func enableLoadCache(directory: String) throws {
+        try setup()
+        try RbGateway.loadCache().setAttribute("directory", newValue: directory)
+    }
+
+    /// Stop using the cache set up by `enableLoadCache(directory:)`.
+    ///
+    /// The files in the cache directory are left alone.
+    public func disableLoadCache() {
+        if let loadCacheModule = RbGateway.loadCacheModule {
+            // Only fails if Ruby is shut down
+            let _ = try? loadCacheModule.setAttribute("directory", newValue: nil)
+        }
+    }
+
+    /// The directory being used by `enableLoadCache(directory:)`, or `nil` if
+    /// the cache is disabled.
+    public var loadCacheDirectory: String? {
+        guard let loadCacheModule = RbGateway.loadCacheModule,
+            let directory = try? loadCacheModule.getAttribute("directory"),
+            !directory.isNil else {
+            return nil
+        }
+        return String(directory)
+    }
+
+    /// Ruby calls `RubyVM::InstructionSequence.load_iseq(path)` when it loads a
+    /// file, using the iseq it returns or compiling the file if `nil`.
+    private static let loadCacheSource = """
+    Module.new do
+      class << self
+        attr_reader :directory
+
+        def directory=(dir)
+          @directory = dir && File.expand_path(dir)
+        end
+      end
+
+      cache = self
+      header = "RubyGateway #{RUBY_VERSION} #{RUBY_PLATFORM} #{RUBY_REVISION}"
+      make_dir = lambda do |dir|
+        unless File.directory?(dir)
+          make_dir.(File.dirname(dir))
+          begin
+            Dir.mkdir(dir)
+          rescue Errno::EEXIST
+          end
+        end
+      end
+
+      define_method(:load_iseq) do |path|
+        dir = cache.directory
+        unless dir
+          return defined?(super) ? super(path) : nil
+        end
+        begin
+          stat = File.stat(path)
+          key = "#{header} #{stat.mtime.to_i}.#{stat.mtime.nsec} #{stat.size}\\n"
+          cache_path = File.join(dir, "#{File.expand_path(path)}.iseq")
+          if File.file?(cache_path)
+            data = File.binread(cache_path)
+            if data.start_with?(key)
+              return RubyVM::InstructionSequence.load_from_binary(data.byteslice(key.bytesize..-1))
+            end
+          end
+          iseq = RubyVM::InstructionSequence.compile_file(path)
+          make_dir.(File.dirname(cache_path))
+          temp_path = "#{cache_path}.#{Process.pid}"
+          File.binwrite(temp_path, key + iseq.to_binary)
+          File.rename(temp_path, cache_path)
+          iseq
+        rescue StandardError, ScriptError
+          nil
+        end
+      end
+    end
+    """
+}
@@ -29,7 +29,10 @@
 //
 // Ruby does make `ancestors` available to give class and hierarchy, importantly in
 // dynamic dispatch order.  So we can search this property looking for a match.
-// OK - not THAT bad!
+// OK - not THAT bad!  And we cache the answer per class until ancestors change.
+//
+// Ruby keeps the argument `VALUE`s alive on its stack for the duration of the
+// call so we only turn them into `RbObject`s when the method asks for it.
 
 /// The function signature for a Ruby method implemented as a Swift free function
 /// or closure.
@@ -81,21 +84,18 @@ public typealias RbBoundMethodVoidCallback<SwiftPeer: AnyObject> =
 // MARK: - Dispatch gorpy implementation
 
 /// Callback from the C layer eg `rbg_method_varargs_callback` in `rbg_protect.m`.
-/// Swiften the arrays and wrap up the Ruby exception layer.
+/// Wrap up the Ruby exception layer.
 private func rbmethod_callback(symbol: VALUE,
-                               targetCount: Int,
-                               rawTargets: UnsafePointer<VALUE>,
+                               rubyClass: VALUE,
                                rubySelf: VALUE,
                                argc: Int32,
                                argv: UnsafePointer<VALUE>,
                                returnValue: UnsafeMutablePointer<Rbg_return_value>) {
 
-    let targets = Array(UnsafeBufferPointer(start: rawTargets, count: targetCount))
-    let args    = Array(UnsafeBufferPointer(start: argv, count: Int(argc)))
+    let args = UnsafeBufferPointer(start: argv, count: Int(argc))
     return returnValue.setFrom {
-        try RbMethodDispatch.exec(symbol: symbol, targets: targets,
-                                  rbSelf: RbObject(rubyValue: rubySelf),
-                                  argv: args.map(RbObject.init(rubyValue:)))
+        try RbMethodDispatch.exec(symbol: symbol, rubyClass: rubyClass,
+                                  rubySelf: rubySelf, argv: args)
     }
 }
 
@@ -119,21 +119,49 @@ private struct RbMethodId: Hashable {
 
 /// The context required to issue a callback.
 private struct RbMethodExec {
-    /// Specification for the arguments taken by the method.
-    let argsSpec: RbMethodArgsSpec
+    /// Validate the given args and if good, invoke the user function.
+    let exec: (VALUE, UnsafeBufferPointer<VALUE>) throws -> RbObject
+
+    /// A regular method: args decoded to `RbObject`s according to the spec.
+    init(argsSpec: RbMethodArgsSpec, callback: @escaping RbMethodCallback) {
+        // Look up keyword IDs now rather than on the first call.  Only fails if
+        // the ID table is full, in which case the call will report it.
+        let _ = try? argsSpec.keywordTable.compile()
+        exec = { rubySelf, argv in
+            let rbSelf = RbObject(rubyValue: rubySelf)
+            let args = try argsSpec.parseArgs(argv: argv.map(RbObject.init(rubyValue:)))
+            let method = RbMethod(rbSelf: rbSelf, args: args, argsSpec: argsSpec)
+            if argsSpec.requiresBlock {
+                try method.needsBlock()
+            }
+            return try callback(rbSelf, method)
+        }
+    }
 
-    /// The Swift implementation of the method.
-    var callback: RbMethodCallback
+    /// A borrowed-args method: just check the arg count.
+    init(argCount: Int?, callback: @escaping RbBorrowedMethodCallback) {
+        exec = { rubySelf, argv in
+            if let argCount = argCount, argv.count != argCount {
+                try RbMethodArgsSpec.reportArityError(argc: argv.count, min: argCount, max: argCount)
+            }
+            return try callback(RbBorrowedMethod(rubySelf: rubySelf, args: argv))
+        }
+    }
+}
 
-    /// Validate the given args against the spec and if good,
-    /// invoke the user function.
-    func exec(rbSelf: RbObject, argv: [RbObject]) throws -> RbObject {
-        let args = try argsSpec.parseArgs(argv: argv)
-        let method = RbMethod(rbSelf: rbSelf, args: args, argsSpec: argsSpec)
-        if argsSpec.requiresBlock {
-            try method.needsBlock()
+/// Build a regular method body from a pair of closures that split the work
+/// into a part that needs the GVL and a part that doesn't.
+private func rbMethodWithoutGvl<Input, Output: RbObjectConvertible>(
+    unblocking: RbThread.UnblockingFunc,
+    prepare: @escaping (RbObject, RbMethod) throws -> Input,
+    body: @escaping (Input) throws -> Output) -> RbMethodCallback {
+    return { rbSelf, method in
+        let input = try prepare(rbSelf, method)
+        var result: Result<Output, Error>?
+        try RbThread.callWithoutGvlCheckingInterrupts(unblocking: unblocking) {
+            result = Result { try body(input) }
         }
-        return try callback(rbSelf, method)
+        return try result!.get().rubyObject
     }
 }
 
@@ -143,27 +171,100 @@ private struct RbMethodDispatch {
         rbg_register_method_callback(rbmethod_callback)
     }()
 
+    /// A method callback plus its target, kept alive and pinned so the `VALUE`
+    /// it is keyed by cannot change or be reused.  Replacing the entry when
+    /// the method is redefined releases the old hold on the target.
+    private final class Callback {
+        let target: RbObject
+        let exec: RbMethodExec
+
+        init(target: VALUE, exec: RbMethodExec) {
+            self.target = RbObject(rubyValue: target)
+            self.exec = exec
+            self.target.pin()
+        }
+
+        deinit {
+            target.unpin()
+        }
+    }
+
     /// List of all method callbacks
-    private static var callbacks: [RbMethodId : RbMethodExec] = [:]
+    private static var callbacks: [RbMethodId : Callback] = [:] {
+        didSet {
+            resolved = [:]
+        }
+    }
+
+    /// A callback found for some class, plus the class to keep it alive
+    /// and pinned so its `VALUE` cannot change or be reused while cached.
+    private final class Resolved {
+        let rubyClass: RbObject
+        let exec: RbMethodExec
+
+        init(rubyClass: RbObject, exec: RbMethodExec) {
+            self.rubyClass = rubyClass
+            self.exec = exec
+            rubyClass.pin()
+        }
+
+        deinit {
+            rubyClass.unpin()
+        }
+    }
+
+    /// Cache of class/method-name pair to callback, saving an ancestors walk
+    /// on each call.  Valid only while `resolvedGeneration` matches the C
+    /// layer's count of ancestry changes.
+    private static var resolved: [RbMethodId : Resolved] = [:]
+    private static var resolvedGeneration: UInt = 0
+
+    /// Limit on `resolved` entries, bounding how many classes it keeps alive.
+    private static let maxResolved = 1024
 
     /// Try to find a callback matching the class/method-name pair.
-    static func findCallback(symbol: VALUE, target: VALUE, firstTarget: VALUE) -> RbMethodExec? {
+    static func findCallback(symbol: VALUE, target: VALUE) -> RbMethodExec? {
         let mid = RbMethodId(mid: Rbg_method_id(method: symbol, target: target))
         guard let callback = callbacks[mid] else {
             return nil
         }
-        return callback
+        return callback.exec
     }
 
-    static func exec(symbol: VALUE, targets: [VALUE], rbSelf: RbObject, argv: [RbObject]) throws -> VALUE {
-        let firstTarget = targets.first!
+    /// Find the callback for a method call on a class, walking up its
+    /// ancestors if we haven't seen it before.
+    static func resolveCallback(symbol: VALUE, rubyClass: VALUE) -> RbMethodExec? {
+        let generation = rbg_method_ancestry_generation()
+        if generation != resolvedGeneration || resolved.count >= maxResolved {
+            resolved = [:]
+            resolvedGeneration = generation
+        }
+
+        let mid = RbMethodId(mid: Rbg_method_id(method: symbol, target: rubyClass))
+        if let hit = resolved[mid] {
+            return hit.exec
+        }
+
+        let ancestors = RbObject(rubyValue: rb_mod_ancestors(rubyClass))
+        let targets = ancestors.withRubyValue { ancestorsValue in
+            (0..<rb_array_len(ancestorsValue)).map { rb_ary_entry(ancestorsValue, $0) }
+        }
         for target in targets {
-            guard let callback = findCallback(symbol: symbol, target: target, firstTarget: firstTarget) else {
-                continue
+            if let callback = findCallback(symbol: symbol, target: target) {
+                resolved[mid] = Resolved(rubyClass: RbObject(rubyValue: rubyClass), exec: callback)
+                return callback
             }
-            return try callback.exec(rbSelf: rbSelf, argv: argv).withRubyValue { $0 }
         }
-        throw RbException(message: "Can't match method ID to Swift callback")
+        return nil
+    }
+
+    static func exec(symbol: VALUE, rubyClass: VALUE, rubySelf: VALUE, argv: UnsafeBufferPointer<VALUE>) throws -> VALUE {
+        let span = RbMetrics.begin(.swiftMethod, name: RbMetrics.name(id: rb_sym2id(symbol)))
+        defer { RbMetrics.end(span) }
+        guard let callback = resolveCallback(symbol: symbol, rubyClass: rubyClass) else {
+            throw RbException(message: "Can't match method ID to Swift callback")
+        }
+        return try callback.exec(rubySelf, argv).withRubyValue { $0 }
     }
 
     // APIs
@@ -171,15 +272,16 @@ private struct RbMethodDispatch {
     static func defineGlobalFunction(name: String, argsSpec: RbMethodArgsSpec, body: @escaping RbMethodCallback) {
         let _ = initOnce
         let mid = RbMethodId(mid: rbg_define_global_function(name))
-        callbacks[mid] = RbMethodExec(argsSpec: argsSpec, callback: body)
+        callbacks[mid] = Callback(target: mid.mid.target,
+                                  exec: RbMethodExec(argsSpec: argsSpec, callback: body))
     }
 
-    static func defineMethod(value: VALUE, name: String, argsSpec: RbMethodArgsSpec, body: @escaping RbMethodCallback, singleton: Bool) {
+    static func defineMethod(value: VALUE, name: String, exec: RbMethodExec, singleton: Bool) {
         let _ = initOnce
         let cfn = singleton ? rbg_define_singleton_method : rbg_define_method
         let mid = RbMethodId(mid: cfn(value, name))
 
-        callbacks[mid] = RbMethodExec(argsSpec: argsSpec, callback: body)
+        callbacks[mid] = Callback(target: mid.mid.target, exec: exec)
     }
 }
 
@@ -229,6 +331,12 @@ public struct RbMethod {
     @discardableResult
     public func yieldBlock(args: [RbObjectConvertible?] = [],
                            kwArgs: KeyValuePairs<String, RbObjectConvertible?> = [:]) throws -> RbObject {
+        return try RbMethod.doYieldBlock(args: args, kwArgs: kwArgs)
+    }
+
+    /// Backend to `yieldBlock(args:kwArgs:)`, shared with `RbBorrowedMethod`.
+    static func doYieldBlock(args: [RbObjectConvertible?],
+                             kwArgs: KeyValuePairs<String, RbObjectConvertible?>) throws -> RbObject {
         let rubyArgs = try RbObjectAccess.flattenArgs(args: args, kwArgs: kwArgs)
         return RbObject(rubyValue: try rubyArgs.withRubyValues { argValues in
             try RbVM.doProtect { tag in
@@ -301,9 +409,111 @@ public struct RbMethodArgs {
     /// The splatted (variable length) arguments to the method.
     public let splatted: [RbObject]
 
+    /// The keyword arguments to the method, in the order of
+    /// `RbMethodArgsSpec.keywordNames`.  If caller omitted any keyword arguments
+    /// with default values then they are created from the `RbMethodArgsSpec`.
+    ///
+    /// Use `RbMethodArgsSpec.keywordIndex(of:)` to find a keyword's position.
+    public let keywordValues: [RbObject]
+
+    /// The names for `keywordValues`
+    let keywordTable: RbKeywordTable
+
     /// The keyword arguments to the method.  If caller omitted any keyword arguments
     /// with default values then they are created from the `RbMethodArgsSpec`.
-    public let keyword: [String : RbObject]
+    ///
+    /// This dictionary is built each time it is accessed: `keywordValues` is faster.
+    public var keyword: [String : RbObject] {
+        return Dictionary(uniqueKeysWithValues: zip(keywordTable.names, keywordValues))
+    }
+}
+
+/// Keyword argument names and defaults laid out in slots, with their `ID`s
+/// looked up once when the method is defined so that calls can match the
+/// passed keywords without converting them to strings.
+final class RbKeywordTable {
+    /// Mandatory keywords then optional keywords, each sorted
+    let names: [String]
+    /// Slots `0..<mandatoryCount` are for mandatory keywords
+    let mandatoryCount: Int
+    /// Default value generators for the optional keyword slots
+    let defaults: [() -> RbObject]
+    /// Slot for each keyword's `ID`, set up by `compile()`
+    private var slotsById: [ID: Int]?
+
+    init(mandatory: Set<String>, optional: [String : () -> RbObject]) {
+        let optionalNames = optional.keys.sorted()
+        names = mandatory.sorted() + optionalNames
+        mandatoryCount = mandatory.count
+        defaults = optionalNames.map { optional[$0]! }
+    }
+
+    /// Look up the keyword `ID`s
+    @discardableResult
+    func compile() throws -> [ID: Int] {
+        if let slotsById = slotsById {
+            return slotsById
+        }
+        var newSlotsById: [ID: Int] = [:]
+        for (slot, name) in names.enumerated() {
+            newSlotsById[try Ruby.getID(for: name)] = slot
+        }
+        slotsById = newSlotsById
+        return newSlotsById
+    }
+
+    /// Match a passed keyword-args hash, or `nil`, to the slots and fill in defaults.
+    func resolve(passed: RbObject) throws -> [RbObject] {
+        let slotsById = try compile()
+        // Held as `RbObject`s: converting keys and making defaults can
+        // allocate, and so compact, before we're done.
+        var values = [RbObject?](repeating: nil, count: names.count)
+        // Keys that aren't symbols naming one of our keywords, with their values
+        var others: [(RbObject, RbObject)] = []
+
+        try passed.withRubyValue { hashValue in
+            if passed.isNil {
+                return
+            }
+            guard passed.rubyType == .T_HASH else {
+                let exn = RbException(message: "Runtime confused, not a kw hash: \(passed)", recordHistory: false)
+                try RbError.raise(error: .rubyException(exn))
+            }
+            try RbVM.doProtectHashForEach(hashValue: hashValue) { key, value in
+                if TYPE(key) == .T_SYMBOL, let slot = slotsById[rb_sym2id(key)] {
+                    values[slot] = RbObject(rubyValue: value)
+                } else {
+                    others.append((RbObject(rubyValue: key), RbObject(rubyValue: value)))
+                }
+                return true
+            }
+        }
+
+        // Allow string keys for compatibility.
+        var unknown: [String] = []
+        for (keyObj, value) in others {
+            let name = String(keyObj) ?? keyObj.description
+            if let slot = names.firstIndex(of: name) {
+                values[slot] = value
+            } else {
+                unknown.append(name)
+            }
+        }
+
+        for slot in 0..<mandatoryCount where values[slot] == nil {
+            let exn = RbException(argMessage: "Missing keyword argument: \"\(names[slot])\"", recordHistory: false)
+            try RbError.raise(error: .rubyException(exn))
+        }
+
+        guard unknown.isEmpty else {
+            let exn = RbException(argMessage: "Unknown keyword arguments: \(unknown)", recordHistory: false)
+            try RbError.raise(error: .rubyException(exn))
+        }
+
+        return values.enumerated().map { slot, value in
+            value ?? defaults[slot - mandatoryCount]()
+        }
+    }
 }
 
 /// A description of how a Ruby method implemented in Swift is supposed to be called.
@@ -342,20 +552,40 @@ public struct RbMethodArgsSpec {
     public var supportsKeywords: Bool {
         return mandatoryKeywords.count > 0 || optionalKeywordValues.count > 0
     }
+    /// Names of all keyword arguments in the order of `RbMethodArgs.keywordValues`:
+    /// the mandatory keywords sorted, then the optional keywords sorted.
+    public var keywordNames: [String] {
+        return keywordTable.names
+    }
+    /// The position of a keyword argument in `RbMethodArgs.keywordValues`,
+    /// or `nil` if the method doesn't take it.
+    public func keywordIndex(of name: String) -> Int? {
+        return keywordTable.names.firstIndex(of: name)
+    }
+    /// Keyword layout
+    let keywordTable: RbKeywordTable
     /// Does the method require a block?
     public let requiresBlock: Bool
 
-    // Call the Ruby function to report a decent error message for args mistakes.
+    // Report a decent error message for args mistakes.
     private func reportArityError(argc: Int) throws -> Never {
-        try RbVM.doProtect { tag in
-            rbg_error_arity_protect(Int32(argc),
-                                    Int32(totalMandatoryCount),
-                                    supportsSplat ? UNLIMITED_ARGUMENTS
-                                                  : Int32(totalMandatoryCount + optionalCount),
-                                    &tag)
+        try RbMethodArgsSpec.reportArityError(argc: argc,
+                                              min: totalMandatoryCount,
+                                              max: supportsSplat ? nil : totalMandatoryCount + optionalCount)
+    }
+
+    /// Raise Ruby's `ArgumentError` for a bad argument count, worded as `rb_error_arity`.
+    /// `max` is `nil` for no limit.
+    fileprivate static func reportArityError(argc: Int, min: Int, max: Int?) throws -> Never {
+        let expected: String
+        switch max {
+        case min: expected = "\(min)"
+        case nil: expected = "\(min)+"
+        case let max?: expected = "\(min)..\(max)"
         }
-        // awkward
-        fatalError()
+        let exn = RbException(argMessage: "wrong number of arguments (given \(argc), expected \(expected))",
+                              recordHistory: false)
+        try RbError.raise(error: .rubyException(exn))
     }
 
     /// Create a new method arguments specification.
@@ -386,6 +616,7 @@ public struct RbMethodArgsSpec {
         self.mandatoryKeywords = mandatoryKeywords
         self.optionalKeywordValues = optionalKeywordValues.mapValues { val in { val.rubyObject } }
         self.requiresBlock = requiresBlock
+        self.keywordTable = RbKeywordTable(mandatory: mandatoryKeywords, optional: self.optionalKeywordValues)
     }
 
     /// Helper to quickly create a spec for a method with a fixed number of arguments.
@@ -451,7 +682,8 @@ public struct RbMethodArgsSpec {
         return RbMethodArgs(mandatory: Array(lMandatory) + Array(tMandatory),
                             optional: Array(optional),
                             splatted: Array(splatted),
-                            keyword: keywordArgs)
+                            keywordValues: keywordArgs,
+                            keywordTable: keywordTable)
     }
 
     /// Sort out keyword arguments and re-write argv as necessary.
@@ -516,49 +748,14 @@ public struct RbMethodArgsSpec {
     /// check for errors, and present the final keyword-arg values.
     ///
     /// - Parameters:
-    ///   - spec: The method arguments specification.
-    ///   - passed: The passed args hash.  The keys are all Ruby symbols; the
-    ///             values are all Ruby objects of some kind.
-    /// - Returns: The resolved keywords args for the method including defaults.
+    ///   - passed: The passed args hash, or `nil` if there isn't one.  The keys
+    ///             are all Ruby symbols; the values are all Ruby objects of some kind.
+    /// - Returns: The resolved keywords args for the method including defaults,
+    ///            in the order of `keywordNames`.
     /// - Throws: `RbError.rubyException(_:)` if an unknown keyword is supplied, or
     ///           if a mandatory keyword is omitted.
-    func resolveKeywords(passed: RbObject) throws -> [String : RbObject] {
-        guard var passedDict = Dictionary<String, RbObject>(passed) else {
-            let exn = RbException(message: "Runtime confused, not a kw hash: \(passed)")
-            try RbError.raise(error: .rubyException(exn))
-        }
-
-        // Start with no kw args
-        var resultDict: [String : RbObject] = [:]
-
-        // Add in the values provided by the user for mandatory keywords.
-        try mandatoryKeywords.forEach { keyword in
-            guard let passedObj = passedDict.removeValue(forKey: keyword) else {
-                // Missing mandatory keyword
-                let exn = RbException(argMessage: "Missing keyword argument: \"\(keyword)\"")
-                try RbError.raise(error: .rubyException(exn))
-            }
-            resultDict[keyword] = passedObj
-        }
-
-        // Add in the user's values for optional keywords, generating defaults
-        // for any that are omitted.
-        optionalKeywordValues.forEach { keyword, valueGen in
-            if let passedObj = passedDict.removeValue(forKey: keyword) {
-                resultDict[keyword] = passedObj
-            } else {
-                resultDict[keyword] = valueGen()
-            }
-        }
-
-        // Any keywords left are not supported by the method.
-        guard passedDict.isEmpty else {
-            let keys = Array(passedDict.keys)
-            let exn = RbException(argMessage: "Unknown keyword arguments: \(keys)")
-            try RbError.raise(error: .rubyException(exn))
-        }
-
-        return resultDict
+    func resolveKeywords(passed: RbObject) throws -> [RbObject] {
+        return try keywordTable.resolve(passed: passed)
     }
 }
 
@@ -590,6 +787,36 @@ extension RbGateway {
         try name.checkRubyMethodName()
         RbMethodDispatch.defineGlobalFunction(name: name, argsSpec: argsSpec, body: body)
     }
+
+    /// Define a global function whose work runs without the GVL.
+    ///
+    /// See `RbObject.defineMethod(_:argsSpec:unblocking:prepare:withoutGvlBody:)`.
+    ///
+    /// - parameter name: The function name.
+    /// - parameter argsSpec: A description of the arguments required by the function.
+    ///             The default for this parameter specifies a function that does not
+    ///             take any arguments.
+    /// - parameter unblocking: How Ruby can wake `withoutGvlBody`.  Default `.io`, which
+    ///             wakes only blocking system calls.
+    /// - parameter prepare: Swift code run with the GVL to turn the arguments into
+    ///             Swift values.
+    /// - parameter withoutGvlBody: Swift code run without the GVL given the result of
+    ///             `prepare`.  It must not use Ruby.
+    /// - throws: `RbError.badIdentifier(type:id:)` if `name` is bad.
+    ///
+    ///     Some other kind of `RbError` if Ruby is not working.
+    public func defineGlobalFunction<Input, Output: RbObjectConvertible>(
+        _ name: String,
+        argsSpec: RbMethodArgsSpec = RbMethodArgsSpec(),
+        unblocking: RbThread.UnblockingFunc = .io,
+        prepare: @escaping (RbObject, RbMethod) throws -> Input,
+        withoutGvlBody: @escaping (Input) throws -> Output) throws {
+        try defineGlobalFunction(name,
+                                 argsSpec: argsSpec,
+                                 body: rbMethodWithoutGvl(unblocking: unblocking,
+                                                          prepare: prepare,
+                                                          body: withoutGvlBody))
+    }
 }
 
 // MARK: - Defining Methods
@@ -729,13 +956,156 @@ extension RbObject {
                                 argsSpec: RbMethodArgsSpec,
                                 body: @escaping RbMethodCallback,
                                 singleton: Bool) throws {
+        try doDefineMethod(name: name,
+                           exec: RbMethodExec(argsSpec: argsSpec, callback: body),
+                           singleton: singleton)
+    }
+
+    private func doDefineMethod(name: String, exec: RbMethodExec, singleton: Bool) throws {
         try name.checkRubyMethodName()
         withRubyValue { rubyValue in
             RbMethodDispatch.defineMethod(value: rubyValue,
                                           name: name,
-                                          argsSpec: argsSpec,
-                                          body: body,
+                                          exec: exec,
                                           singleton: singleton)
         }
     }
+
+    // MARK: - Borrowed-args methods
+
+    /// Add or replace a method in all instances of the Ruby class, using borrowed arguments.
+    ///
+    /// This is a faster version of `defineMethod(_:argsSpec:body:)` for methods
+    /// that are called very frequently.  The method's arguments are passed as
+    /// `RbBorrowedObject`s that are valid only for the duration of the call: use
+    /// `RbBorrowedObject.retained` to get an `RbObject` that you can store.
+    ///
+    /// There is no support for optional or keyword arguments: a keyword-arguments
+    /// hash passed by the caller appears as the last positional argument.
+    ///
+    /// ```swift
+    /// try recordClass.defineMethod("weight", argCount: 1) { method in
+    ///     let factor = try method.args[0].convert(to: Double.self)
+    ///     return RbObject(factor * 2)
+    /// }
+    /// ```
+    ///
+    /// - Parameters:
+    ///   - name: The method name.
+    ///   - argCount: The number of arguments the method takes, or `nil` to
+    ///               accept any number.
+    ///   - borrowedBody: The Swift code to run when the method is called.
+    /// - Throws: `RbError.badIdentifier(type:id:)` if `name` is bad.
+    ///           `RbError.badType(...)` if the object is neither a class nor a module.
+    public func defineMethod(_ name: String,
+                             argCount: Int?,
+                             borrowedBody: @escaping RbBorrowedMethodCallback) throws {
+        try checkIsClassOrModule()
+        try doDefineMethod(name: name,
+                           exec: RbMethodExec(argCount: argCount, callback: borrowedBody),
+                           singleton: false)
+    }
+
+    /// Add or replace a method in the Ruby object's singleton class, using borrowed arguments.
+    ///
+    /// See `defineMethod(_:argCount:borrowedBody:)` and `defineSingletonMethod(_:argsSpec:body:)`.
+    ///
+    /// - Parameters:
+    ///   - name: The method name.
+    ///   - argCount: The number of arguments the method takes, or `nil` to
+    ///               accept any number.
+    ///   - borrowedBody: The Swift code to run when the method is called.
+    /// - Throws: `RbError.badIdentifier(type:id:)` if `name` is bad.
+    public func defineSingletonMethod(_ name: String,
+                                      argCount: Int?,
+                                      borrowedBody: @escaping RbBorrowedMethodCallback) throws {
+        try doDefineMethod(name: name,
+                           exec: RbMethodExec(argCount: argCount, callback: borrowedBody),
+                           singleton: true)
+    }
+
+    // MARK: - GVL-releasing methods
+
+    /// Add or replace a method in all instances of the Ruby class, doing
+    /// the work of the method without the GVL.
+    ///
+    /// Ruby holds the GVL while a Swift method runs, which stops other
+    /// Ruby threads running.  Use this version for methods that spend a long
+    /// time in Swift code, for example compressing data, so that other Ruby
+    /// threads can run meanwhile.
+    ///
+    /// The method is split into two closures.  `prepare` runs first, with the
+    /// GVL, and turns the Ruby arguments into Swift values.  Then
+    /// `withoutGvlBody` runs without the GVL and must not use Ruby at all.
+    /// RubyGateway converts its result back to Ruby with the GVL.
+    /// ```swift
+    /// try clazz.defineMethod("digest",
+    ///                        argsSpec: RbMethodArgsSpec(leadingMandatoryCount: 1),
+    ///                        prepare: { _, method in try String(method.args.mandatory[0]) },
+    ///                        withoutGvlBody: { text in sha256(text) })
+    /// ```
+    ///
+    /// Errors thrown by either closure are raised as Ruby exceptions as usual,
+    /// but `withoutGvlBody` must not create an `RbException`: throw some other
+    /// Swift error instead.
+    ///
+    /// If Ruby interrupts the thread, for example with `Thread#kill`, it calls
+    /// the `unblocking` function and then acts on the interrupt once
+    /// `withoutGvlBody` has returned.  The default `.io` only wakes a blocking
+    /// system call such as `read(2)` or `sleep(3)`: it cannot stop CPU-bound
+    /// Swift code.  Pass a `.custom` function that tells `withoutGvlBody` to
+    /// finish early if it needs to be interruptible.
+    ///
+    /// - Parameters:
+    ///   - name: The method name.
+    ///   - argsSpec: A description of the arguments required by the method.
+    ///               The default for this parameter specifies a function that
+    ///               does not take any arguments.
+    ///   - unblocking: How Ruby can wake `withoutGvlBody`, for example to kill
+    ///                 the thread.  Default `.io`, which wakes only blocking system calls.
+    ///                 See `RbThread.UnblockingFunc`.
+    ///   - prepare: Swift code run with the GVL to turn the arguments into Swift values.
+    ///   - withoutGvlBody: Swift code run without the GVL given the result of `prepare`.
+    /// - Throws: `RbError.badIdentifier(type:id:)` if `name` is bad.
+    ///           `RbError.badType(...)` if the object is neither a class nor a module.
+    public func defineMethod<Input, Output: RbObjectConvertible>(
+        _ name: String,
+        argsSpec: RbMethodArgsSpec = RbMethodArgsSpec(),
+        unblocking: RbThread.UnblockingFunc = .io,
+        prepare: @escaping (RbObject, RbMethod) throws -> Input,
+        withoutGvlBody: @escaping (Input) throws -> Output) throws {
+        try defineMethod(name,
+                         argsSpec: argsSpec,
+                         body: rbMethodWithoutGvl(unblocking: unblocking,
+                                                  prepare: prepare,
+                                                  body: withoutGvlBody))
+    }
+
+    /// Add or replace a method in the Ruby object's singleton class, doing
+    /// the work of the method without the GVL.
+    ///
+    /// See `defineMethod(_:argsSpec:unblocking:prepare:withoutGvlBody:)`.
+    ///
+    /// - Parameters:
+    ///   - name: The method name.
+    ///   - argsSpec: A description of the arguments required by the method.
+    ///               The default for this parameter specifies a function that
+    ///               does not take any arguments.
+    ///   - unblocking: How Ruby can wake `withoutGvlBody`.  Default `.io`, which wakes
+    ///                 only blocking system calls.
+    ///   - prepare: Swift code run with the GVL to turn the arguments into Swift values.
+    ///   - withoutGvlBody: Swift code run without the GVL given the result of `prepare`.
+    /// - Throws: `RbError.badIdentifier(type:id:)` if `name` is bad.
+    public func defineSingletonMethod<Input, Output: RbObjectConvertible>(
+        _ name: String,
+        argsSpec: RbMethodArgsSpec = RbMethodArgsSpec(),
+        unblocking: RbThread.UnblockingFunc = .io,
+        prepare: @escaping (RbObject, RbMethod) throws -> Input,
+        withoutGvlBody: @escaping (Input) throws -> Output) throws {
+        try defineSingletonMethod(name,
+                                  argsSpec: argsSpec,
+                                  body: rbMethodWithoutGvl(unblocking: unblocking,
+                                                           prepare: prepare,
+                                                           body: withoutGvlBody))
+    }
 }
@@ -0,0 +1,251 @@
+//
+//  RbMetrics.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+@_implementationOnly import CRuby
+import Foundation
+
+/// Counts and timings of the work RubyGateway does, with hooks for tracing.
+///
+/// Collection is off by default.  While it is off each instrumented point
+/// costs one test of `isEnabled`.  Turn it on to find out where time goes:
+/// ```swift
+/// RbMetrics.isEnabled = true
+/// ...
+/// for (event, stats) in RbMetrics.snapshot() {
+///     print("\(event): \(stats.count) times, p99 \(stats.percentile(99))ns")
+/// }
+/// ```
+///
+/// Set `tracer` to see each piece of work as it happens, for example to emit
+/// signposts or tracing spans.
+///
+/// Events nest: a `methodCall` contains a `protectedCall`, which may contain
+/// `swiftBlock`s and so on.  Each event's time includes everything inside it.
+///
+/// Methods are thread-safe.
+public enum RbMetrics {
+    /// The things RubyGateway measures.
+    public enum Event: Int, CaseIterable, CustomStringConvertible {
+        /// A call into Ruby under an exception handler.  Made for every
+        /// method call and for most conversions.
+        case protectedCall
+        /// A Ruby method called from Swift, for example by `RbObjectAccess.call(_:args:kwArgs:)`.
+        case methodCall
+        /// A Ruby call to a method implemented in Swift.
+        case swiftMethod
+        /// A Ruby call to a block implemented in Swift.
+        case swiftBlock
+        /// Creating an `RbObject`, which protects the Ruby object from GC.
+        /// Not counted for values like `nil` and small integers that need no protection.
+        case objectRetain
+        /// Destroying an `RbObject`, which releases the Ruby object.
+        /// Not counted for values like `nil` and small integers.
+        /// Happens on whichever thread drops the last reference.
+        case objectRelease
+        /// Waiting to get the GVL back at the end of `RbThread.callWithoutGvl(...)`.
+        case gvlWait
+
+        /// The name of the event.
+        public var description: String {
+            switch self {
+            case .protectedCall: return "protectedCall"
+            case .methodCall: return "methodCall"
+            case .swiftMethod: return "swiftMethod"
+            case .swiftBlock: return "swiftBlock"
+            case .objectRetain: return "objectRetain"
+            case .objectRelease: return "objectRelease"
+            case .gvlWait: return "gvlWait"
+            }
+        }
+    }
+
+    /// The counts and timings for one kind of event.
+    public struct Stats {
+        /// The number of histogram buckets
+        static let bucketCount = 64
+
+        /// How many times the event happened.
+        public private(set) var count = 0
+        /// The total time spent, in nanoseconds.
+        public private(set) var totalNanoseconds: UInt64 = 0
+        /// The longest time taken, in nanoseconds.
+        public private(set) var maxNanoseconds: UInt64 = 0
+        /// Histogram of times taken.  `buckets[0]` counts times under 2ns and
+        /// `buckets[n]` counts times from 2^n up to 2^(n+1) ns.
+        public private(set) var buckets = Array(repeating: 0, count: Stats.bucketCount)
+
+        /// The mean time taken, in nanoseconds.
+        public var meanNanoseconds: Double {
+            return count == 0 ? 0 : Double(totalNanoseconds) / Double(count)
+        }
+
+        /// An upper bound on the time, in nanoseconds, within which a percentage
+        /// of events finished.  Accurate to a factor of 2.
+        ///
+        /// - parameter percent: The percentile, for example 99.
+        public func percentile(_ percent: Double) -> UInt64 {
+            let target = Int((Double(count) * percent / 100).rounded(.up))
+            var seen = 0
+            for (n, bucketCount) in buckets.enumerated() {
+                seen += bucketCount
+                if seen >= target && seen > 0 {
+                    return n == Stats.bucketCount - 1 ? maxNanoseconds : min(maxNanoseconds, (2 << n) - 1)
+                }
+            }
+            return 0
+        }
+
+        mutating func add(nanoseconds: UInt64) {
+            count += 1
+            totalNanoseconds &+= nanoseconds
+            maxNanoseconds = max(maxNanoseconds, nanoseconds)
+            let bucket = nanoseconds < 2 ? 0 : (63 - nanoseconds.leadingZeroBitCount)
+            buckets[bucket] += 1
+        }
+    }
+
+    /// Collect metrics?  Default `false`.
+    ///
+    /// Collecting takes a lock and reads the clock twice per event.
+    public static var isEnabled: Bool {
+        get {
+            return rbg_atomic_load_int(enabledSlot) != 0
+        }
+        set {
+            rbg_atomic_store_int(enabledSlot, newValue ? 1 : 0)
+        }
+    }
+
+    /// Something to tell about each event as it starts and finishes.
+    /// Default `nil`.  Only used while `isEnabled` is set.
+    public static var tracer: RbTracer? {
+        get {
+            return lock.locked { theTracer }
+        }
+        set {
+            lock.locked { theTracer = newValue }
+        }
+    }
+
+    /// The counts and timings collected since the last `reset()`.
+    public static func snapshot() -> [Event: Stats] {
+        let current = lock.locked { stats }
+        return Dictionary(uniqueKeysWithValues: Event.allCases.map { ($0, current[$0.rawValue]) })
+    }
+
+    /// Forget the counts and timings collected so far.
+    public static func reset() {
+        lock.locked {
+            stats = Array(repeating: Stats(), count: Event.allCases.count)
+        }
+    }
+
+    // MARK: - Collection
+
+    private static let lock = Lock()
+    /// Where `isEnabled` lives, read atomically on every instrumented point.
+    private static let enabledSlot: UnsafeMutablePointer<Int32> = {
+        let slot = UnsafeMutablePointer<Int32>.allocate(capacity: 1)
+        slot.initialize(to: 0)
+        return slot
+    }()
+    private static var stats = Array(repeating: Stats(), count: Event.allCases.count)
+    private static var theTracer: RbTracer?
+
+    /// An event in progress
+    struct Span {
+        let event: Event
+        let name: String?
+        let start: UInt64
+        let tracer: RbTracer?
+    }
+
+    private static var now: UInt64 {
+        return DispatchTime.now().uptimeNanoseconds
+    }
+
+    /// Start timing an event.  `name` is only evaluated if there is a tracer.
+    @inline(__always)
+    static func begin(_ event: Event, name: @autoclosure () -> String? = nil) -> Span? {
+        guard isEnabled else {
+            return nil
+        }
+        return beginEnabled(event, name: name)
+    }
+
+    private static func beginEnabled(_ event: Event, name: () -> String?) -> Span {
+        let tracer = self.tracer
+        let spanName = tracer == nil ? nil : name()
+        tracer?.began(event, name: spanName)
+        return Span(event: event, name: spanName, start: now, tracer: tracer)
+    }
+
+    /// Finish timing an event.
+    @inline(__always)
+    static func end(_ span: Span?) {
+        if let span = span {
+            endEnabled(span)
+        }
+    }
+
+    private static func endEnabled(_ span: Span) {
+        let nanoseconds = now - span.start
+        lock.locked {
+            stats[span.event.rawValue].add(nanoseconds: nanoseconds)
+        }
+        span.tracer?.ended(span.event, name: span.name, nanoseconds: nanoseconds)
+    }
+
+    /// Time an event.
+    @inline(__always)
+    static func measure<T>(_ event: Event, name: @autoclosure () -> String? = nil, call: () throws -> T) rethrows -> T {
+        let span = begin(event, name: name())
+        defer { end(span) }
+        return try call()
+    }
+
+    /// Record an event that has already finished.  Not traced.
+    static func record(_ event: Event, nanoseconds: UInt64) {
+        lock.locked {
+            stats[event.rawValue].add(nanoseconds: nanoseconds)
+        }
+    }
+
+    /// The current time if enabled, for events measured in pieces.
+    static var timestamp: UInt64? {
+        return isEnabled ? now : nil
+    }
+
+    /// Method name for spans
+    static func name(id: ID) -> String? {
+        return rb_id2name(id).map { String(cString: $0) }
+    }
+}
+
+/// Receives events from RubyGateway as they start and finish.
+///
+/// See `RbMetrics.tracer`.  The methods are called on whichever thread does
+/// the work, usually with the GVL held.  The exception is
+/// `RbMetrics.Event.objectRelease`, which happens when an `RbObject` is
+/// destroyed and so can be on any thread, with or without the GVL.  They
+/// must not call Ruby.  Events nest and each `ended(...)` matches the most
+/// recent `began(...)` on the same thread.
+///
+/// `RbMetrics.Event.gvlWait` is counted but not traced.
+public protocol RbTracer: AnyObject {
+    /// Some work is starting.
+    ///
+    /// - parameter event: The kind of work.
+    /// - parameter name: The method name for `methodCall` and `swiftMethod`, otherwise `nil`.
+    func began(_ event: RbMetrics.Event, name: String?)
+
+    /// Some work has finished.
+    ///
+    /// - parameter event: The kind of work.
+    /// - parameter name: The same name passed to `began(_:name:)`.
+    /// - parameter nanoseconds: How long the work took.
+    func ended(_ event: RbMetrics.Event, name: String?, nanoseconds: UInt64)
+}
@@ -86,7 +86,12 @@
 /// add methods implemented in Swift to an object or class.  Use
 /// `RbGateway.defineClass(_:parent:under:)` to define entirely new classes.
 public final class RbObject: RbObjectAccess {
-    internal let valueBox: UnsafeMutablePointer<Rbg_value>
+    /// The `VALUE` of a special constant like `nil` or a fixnum.  Anything the
+    /// GC could collect has a `valueBox` instead: the `VALUE` there changes if
+    /// `GC.compact` moves the object.
+    private let value: VALUE
+    /// GC root for the `VALUE`, shared between copies.  `nil` for special constants.
+    private let valueBox: UnsafeMutablePointer<Rbg_value>?
 
     /// Convenience typealias to avoid exposing all of CRuby :nodoc:
     public typealias VALUE = UInt
@@ -99,8 +104,10 @@ public final class RbObject: RbObjectAccess {
     /// This initializer is public to allow use with other parts
     /// of the Ruby API.  It is not normally needed.
     public init(rubyValue: VALUE) {
-        valueBox = rbg_value_alloc(rubyValue);
-        super.init(getValue: { rubyValue })
+        value = rubyValue
+        valueBox = RB_SPECIAL_CONST_P(rubyValue) ? nil :
+            RbMetrics.measure(.objectRetain) { rbg_value_alloc(rubyValue) }
+        super.init()
     }
 
     /// Create another Swift reference to an existing `RbObject`.
@@ -114,21 +121,30 @@ public final class RbObject: RbObjectAccess {
     /// let myClone = myObject.call("clone")
     /// ```
     public init(_ value: RbObject) {
-        valueBox = rbg_value_dup(value.valueBox);
-        let rubyValue = valueBox.pointee.value
-        super.init(getValue: { rubyValue }, associatedObjects: value.associatedObjects)
+        self.value = value.value
+        valueBox = value.valueBox.map { box in
+            RbMetrics.measure(.objectRetain) { rbg_value_dup(box) }
+        }
+        super.init(associatedObjects: value.associatedObjects)
     }
 
     /// Allow the tracked Ruby object to be GCed when we go out of scope.
     deinit {
-        rbg_value_free(valueBox)
+        if let valueBox = valueBox {
+            RbMetrics.measure(.objectRelease) { rbg_value_free(valueBox) }
+        }
     }
 
     /// Access the raw `VALUE` object handle.  Very restricted use because
     /// too hard to use safely outside of the instance!
     /// Use `withRubyValue(...)` instead.
     fileprivate var rubyValue: VALUE {
-        return valueBox.pointee.value
+        return valueBox?.pointee.value ?? value
+    }
+
+    /// For `RbObjectAccess`
+    override func getValue() -> VALUE {
+        return rubyValue
     }
 
     /// Safely access the `VALUE` object handle for use with the Ruby C API.
@@ -192,6 +208,17 @@ public final class RbObject: RbObjectAccess {
 // MARK: - In-module utility
 
 extension RbObject {
+    /// Stop `GC.compact` moving the object, for callers that need its `VALUE`
+    /// to stay the same.  Balance with `unpin()`.
+    func pin() {
+        valueBox.map { rbg_value_pin($0) }
+    }
+
+    /// Let `GC.compact` move the object again.
+    func unpin() {
+        valueBox.map { rbg_value_unpin($0) }
+    }
+
     /// Check object is a symbol
     func checkIsSymbol() throws {
         guard rubyType == .T_SYMBOL else {
@@ -335,7 +362,10 @@ extension RbObject: CustomStringConvertible,
 extension RbObject: Hashable, Equatable, Comparable {
     /// The hash value for the Ruby object.
     ///
-    /// Calls the Ruby `hash` method.
+    /// Calls the Ruby `hash` method.  Like Ruby's `Hash`, integers, symbols,
+    /// `nil`, `true`, `false`, and `String`s are hashed directly without calling
+    /// `hash`.  The hash of a frozen string, or on Ruby 3 any deeply-frozen
+    /// object, is calculated just once.
     /// - note: Crashes the process (`fatalError`) if the object does not support `hash`
     ///   or if the `hash` call returns something that can't be converted to `Int`.
     public func hash(into hasher: inout Hasher) {
@@ -343,6 +373,18 @@ extension RbObject: Hashable, Equatable, Comparable {
         guard Ruby.softSetup() else {
             return
         }
+        hasher.combine(rubyHash)
+    }
+
+    private var rubyHash: Int {
+        let value = rubyValue
+        var fastHash = 0
+        if rbg_fast_hash(value, &fastHash) != 0 {
+            return fastHash
+        }
+        if let valueBox = valueBox, rbg_value_get_hash(valueBox, &fastHash) != 0 {
+            return fastHash
+        }
         // not super happy about this - could we instead call hash just once, cache
         // result + use some arbitrary value on failure?
         do {
@@ -350,7 +392,10 @@ extension RbObject: Hashable, Equatable, Comparable {
             guard let hash = Int(hashObj) else {
                 fatalError("Hash value for \(self) not numeric: \(hashObj)")
             }
-            hasher.combine(hash)
+            if let valueBox = valueBox, rbg_hash_is_stable(value) != 0 {
+                rbg_value_set_hash(valueBox, hash)
+            }
+            return hash
         } catch {
             fatalError("Calling 'hash' on \(self) failed: \(error)")
         }
@@ -359,9 +404,17 @@ extension RbObject: Hashable, Equatable, Comparable {
     /// Returns a Boolean value indicating whether two values are equal.
     ///
     /// Calls the Ruby `==` method of the `lhs` passing `rhs` as the parameter.
+    /// Like Ruby's `Hash`, the same object is equal to itself -- except for
+    /// a `Float` -- and integers, symbols, `nil`, `true`, `false`, and `String`s
+    /// are compared directly without calling `==`.
     /// - note: Crashes the process (`fatalError`) if the call to `==` goes wrong.
     /// - returns: Whether the objects are the same under `==`.
     public static func ==(lhs: RbObject, rhs: RbObject) -> Bool {
+        switch rbg_fast_equal(lhs.rubyValue, rhs.rubyValue) {
+        case 1: return true
+        case 0: return false
+        default: break
+        }
         do {
             let result = try lhs.call("==", args: [rhs])
             return result.isTruthy
@@ -55,20 +55,20 @@
 /// }
 /// ```
 public class RbObjectAccess {
-    /// Getter for the `VALUE` associated with this object
-    private let getValue: () -> VALUE
-
     /// Swift objects whose lifetimes need to be tied to this one.
     internal private(set) var associatedObjects: [AnyObject]?
 
     /// Set up Swift access to a Ruby object.
-    /// - parameter getValue: Getter for the `VALUE` to be accessed.
     /// - parameter associatedObjects: Set of objects to reference.
-    init(getValue: @escaping () -> VALUE, associatedObjects: [AnyObject]? = nil) {
-        self.getValue = getValue
+    init(associatedObjects: [AnyObject]? = nil) {
         self.associatedObjects = associatedObjects
     }
 
+    /// The `VALUE` associated with this object.  Subclasses override.
+    func getValue() -> VALUE {
+        fatalError("RbObjectAccess.getValue() must be overridden")
+    }
+
     /// Add a Swift object to be forgotten about when this one is.
     func associate(object: AnyObject) {
         if associatedObjects != nil {
@@ -300,6 +300,74 @@ extension RbObjectAccess {
                           blockCall: blockCall)
     }
 
+    /// Call a Ruby object method passing Swift code that uses borrowed arguments
+    /// as a block.
+    ///
+    /// This is faster than `call(_:args:kwArgs:blockRetention:blockCall:)` for
+    /// methods that yield many times: nothing is allocated to hold the closure
+    /// and no `RbObject`s are created for the values passed to the block.  The
+    /// `RbBorrowedArgs` are only valid until the block returns.
+    ///
+    /// Ruby must not keep the block beyond the method call, as with
+    /// `RbBlockRetention.none`.
+    ///
+    /// The block can throw `RbBreak` and `RbException` as usual.  Any other
+    /// error thrown by the block stops the method, like `break`, and is thrown
+    /// again by this method.
+    ///
+    /// - parameter methodName: The name of the method to call.
+    /// - parameter args: The positional arguments to the method.  None by default.
+    /// - parameter kwArgs: The keyword arguments to the method.  None by default.
+    /// - parameter blockCall: Swift code to pass as a block to the method.
+    /// - returns: The result of calling the method.
+    /// - throws: `RbError.rubyException(_:)` if there is a Ruby exception.
+    ///           `RbError.duplicateKwArg(_:)` if there are duplicate keywords in `kwArgs`.
+    ///           Whatever error the block throws.
+    @discardableResult
+    public func callWithBorrowedBlock(_ methodName: String,
+                                      args: [RbObjectConvertible?] = [],
+                                      kwArgs: KeyValuePairs<String, RbObjectConvertible?> = [:],
+                                      blockCall: (RbBorrowedArgs) throws -> RbObject) throws -> RbObject {
+        try Ruby.setup()
+        let methodId = try Ruby.getID(for: methodName)
+        return try doBorrowedBlockCall(id: methodId, args: args, kwArgs: kwArgs) { argValues in
+            try blockCall(RbBorrowedArgs(values: argValues)).withRubyValue { $0 }
+        }
+    }
+
+    /// Call the object's `each` method, converting each value it yields to
+    /// some Swift type.
+    ///
+    /// ```swift
+    /// var total = 0
+    /// try numbers.each(as: Int.self) { total += $0 }
+    /// ```
+    ///
+    /// This uses the same fast path as `callWithBorrowedBlock(_:args:kwArgs:blockCall:)`.
+    /// `Int`, `Double`, `Bool` and `String` values are converted without creating
+    /// any `RbObject`s.  If `each` yields several values at once then they are
+    /// converted as an array.
+    ///
+    /// - parameter type: The Swift type of the values.
+    /// - parameter body: Swift code to run for each value.
+    /// - throws: `RbError.badType(_:)` if a value does not convert to `type`.  The
+    ///           iteration stops.
+    ///           `RbError.rubyException(_:)` if there is a Ruby exception.
+    ///           Whatever error `body` throws.
+    public func each<T: RbObjectConvertible>(as type: T.Type = T.self, _ body: (T) throws -> Void) throws {
+        try Ruby.setup()
+        let methodId = try Ruby.getID(for: "each")
+        try doBorrowedBlockCall(id: methodId, args: [], kwArgs: [:]) { argValues in
+            let args = RbBorrowedArgs(values: argValues)
+            switch args.count {
+            case 1: try body(args[0].convert(to: type))
+            case 0: try body(RbObject.nilObject.convert(to: type))
+            default: try body(args.retained.rubyObject.convert(to: type))
+            }
+            return Qnil
+        }
+    }
+
     /// Call a Ruby object method passing a Ruby Proc as a block.
     ///
     /// - parameter methodName: The name of the method to call.
@@ -400,6 +468,9 @@ extension RbObjectAccess {
                         blockRetention: RbBlockRetention = .none,
                         block: RbObjectConvertible? = nil,
                         blockCall: RbBlockCallback? = nil) throws -> RbObject {
+        let span = RbMetrics.begin(.methodCall, name: RbMetrics.name(id: id))
+        defer { RbMetrics.end(span) }
+
         // Sort out unlikely block errors
         let blockObj: RbObject?
         if let block = block {
@@ -451,6 +522,24 @@ extension RbObjectAccess {
         }
     }
 
+    /// Backend to method calls with borrowed-args blocks.
+    @discardableResult
+    private func doBorrowedBlockCall(id: ID,
+                                     args: [RbObjectConvertible?],
+                                     kwArgs: KeyValuePairs<String, RbObjectConvertible?>,
+                                     blockCall: (UnsafeBufferPointer<VALUE>) throws -> VALUE) throws -> RbObject {
+        let span = RbMetrics.begin(.methodCall, name: RbMetrics.name(id: id))
+        defer { RbMetrics.end(span) }
+
+        let argObjects = try RbObjectAccess.flattenArgs(args: args, kwArgs: kwArgs)
+        return try argObjects.withRubyValues { argValues in
+            RbObject(rubyValue: try RbBlock.doBorrowedBlockCall(value: getValue(), methodId: id,
+                                                                argValues: argValues,
+                                                                hasKwArgs: kwArgs.count > 0,
+                                                                blockCall: blockCall))
+        }
+    }
+
     /// Helper to massage Swift-format args ready for the API
     internal static func flattenArgs(args: [RbObjectConvertible?],
                                      kwArgs: KeyValuePairs<String, RbObjectConvertible?>) throws -> [RbObject] {
@@ -465,18 +554,22 @@ extension RbObjectAccess {
 
     /// Build a keyword args hash.  The keys are Symbols of the keywords.
     private static func buildKwArgsHash(from kwArgs: KeyValuePairs<String, RbObjectConvertible?>) throws -> RbObject {
-        let hashValue = rb_hash_new()
-        try kwArgs.forEach { (key, value) in
-            try RbSymbol(key).rubyObject.withRubyValue { symValue in
-                if rb_hash_lookup(hashValue, symValue) != Qnil {
-                    try RbError.raise(error: .duplicateKwArg(key))
-                }
-                value.rubyObject.withRubyValue {
-                    rb_hash_aset(hashValue, symValue, $0)
-                }
+        var pairs: [RbObject] = []
+        pairs.reserveCapacity(kwArgs.count * 2)
+        for index in kwArgs.indices {
+            let (key, value) = kwArgs[index]
+            // Keyword lists are short: don't bother hashing
+            if kwArgs[..<index].contains(where: { $0.key == key }) {
+                try RbError.raise(error: .duplicateKwArg(key))
             }
+            pairs.append(RbSymbol(key).rubyObject)
+            pairs.append(value.rubyObject)
         }
-        return RbObject(rubyValue: hashValue)
+        return RbObject(rubyValue: try pairs.withRubyValues { pairValues in
+            try RbVM.doProtect { tag in
+                rbg_hash_new_from_pairs_protect(pairValues, kwArgs.count, &tag)
+            }
+        })
     }
 }
 
@@ -4,6 +4,8 @@
 //
 //  Distributed under the MIT license, see LICENSE
 //
+@_implementationOnly import CRuby
+@_implementationOnly import RubyGatewayHelpers
 
 /// A view onto a Ruby array using Swift collection protocols.
 ///
@@ -17,6 +19,9 @@
 /// myObj.collection.replaceSubrange(lower..<upper, with: otherArray)
 /// ```
 ///
+/// Real Ruby arrays are accessed directly.  Other objects are accessed
+/// by calling their `length`, `[]`, and `[]=` methods.
+///
 /// This is separate to `RbObject` to avoid dumping all the
 /// collection protocol members into its dynamic member lookup
 /// namespace.
@@ -29,16 +34,21 @@ public struct RbObjectCollection: RandomAccessCollection,
     /// The same thing as accessing `RbObject.collection`.
     public init(_ value: RbObject) {
         self.rubyObject = value
+        self.isArray = value.rubyType == .T_ARRAY
     }
 
     /// The Ruby object for the underlying array.
     public private(set) var rubyObject: RbObject
 
+    /// Is `rubyObject` a real Ruby array, so we can skip method calls
+    private let isArray: Bool
+
     // MARK: - Collection protocol conformance
 
     /// Create an empty collection - an empty Ruby array.
     public init() {
         self.rubyObject = []
+        self.isArray = true
     }
 
     public var startIndex: Int {
@@ -46,6 +56,9 @@ public struct RbObjectCollection: RandomAccessCollection,
     }
 
     public var endIndex: Int {
+        if isArray {
+            return rubyObject.withRubyValue { rb_array_len($0) }
+        }
         if let lengthObj = try? rubyObject.call("length"),
             let length = Int(lengthObj) {
             return length
@@ -55,10 +68,27 @@ public struct RbObjectCollection: RandomAccessCollection,
 
     public subscript(index: Int) -> RbObject {
         get {
-            return rubyObject[index]
+            guard isArray else {
+                return rubyObject[index]
+            }
+            return rubyObject.withRubyValue { RbObject(rubyValue: rb_ary_entry($0, index)) }
         }
         set {
-            rubyObject[index] = newValue
+            guard isArray else {
+                rubyObject[index] = newValue
+                return
+            }
+            do {
+                try rubyObject.withRubyValue { aryValue in
+                    try newValue.withRubyValue { elementValue in
+                        try RbVM.doProtect { tag in
+                            rbg_ary_store_protect(aryValue, index, elementValue, &tag)
+                        }
+                    }
+                }
+            } catch {
+                fatalError("RbObjectCollection[]= failed: \(error)")
+            }
         }
     }
 
@@ -69,6 +99,77 @@ public struct RbObjectCollection: RandomAccessCollection,
     public mutating func replaceSubrange<C>(_ subrange: Range<Int>, with newElements: C) where C: Collection, C.Element: RbObjectConvertible {
         let newArray = Array(newElements)
 
-        rubyObject[subrange.rubyObject] = RbObject(newArray)
+        guard isArray else {
+            rubyObject[subrange.rubyObject] = RbObject(newArray)
+            return
+        }
+        do {
+            try newArray.map { $0.rubyObject }.withRubyValues { newValues in
+                try rubyObject.withRubyValue { aryValue in
+                    try RbVM.doProtect { tag in
+                        rbg_ary_splice_protect(aryValue, subrange.lowerBound, subrange.count,
+                                               newValues, newValues.count, &tag)
+                    }
+                }
+            }
+        } catch {
+            fatalError("RbObjectCollection.replaceSubrange failed: \(error)")
+        }
+    }
+
+    // MARK: - Iteration
+
+    /// Iterator for `RbObjectCollection`.
+    ///
+    /// Ruby arrays are read in chunks rather than one element at a time.
+    public struct Iterator: IteratorProtocol {
+        private let collection: RbObjectCollection
+        /// Index of the first element after `chunk`
+        private var index: Int
+        /// Elements read but not yet returned, in reverse order
+        private var chunk: [RbObject]
+        /// Length of a non-array collection, read once up front
+        private let endIndex: Int
+
+        private static let chunkSize = 64
+
+        init(_ collection: RbObjectCollection) {
+            self.collection = collection
+            self.index = 0
+            self.chunk = []
+            self.endIndex = collection.isArray ? 0 : collection.endIndex
+        }
+
+        public mutating func next() -> RbObject? {
+            guard collection.isArray else {
+                guard index < endIndex else {
+                    return nil
+                }
+                defer { index += 1 }
+                return collection[index]
+            }
+            if chunk.isEmpty {
+                readChunk()
+            }
+            return chunk.popLast()
+        }
+
+        /// Read the next few elements.  The array is re-measured each time
+        /// in case it has been changed during the iteration.
+        private mutating func readChunk() {
+            let start = index
+            chunk = collection.rubyObject.withRubyValue { aryValue in
+                let count = min(Iterator.chunkSize, rb_array_len(aryValue) - start)
+                guard count > 0, let elements = rbg_RARRAY_CONST_PTR(aryValue) else {
+                    return []
+                }
+                return (0..<count).reversed().map { RbObject(rubyValue: elements[start + $0]) }
+            }
+            index += chunk.count
+        }
+    }
+
+    public func makeIterator() -> Iterator {
+        return Iterator(self)
     }
 }
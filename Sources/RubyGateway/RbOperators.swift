@@ -4,6 +4,7 @@
 //
 //  Distributed under the MIT license, see LICENSE
 //
+@_implementationOnly import CRuby
 
 // This file provides conformances and so on to let users treat `RbObject`s as
 // number-like things, forwarding on to Ruby methods for +-*/ and enabling
@@ -15,6 +16,12 @@
 //
 // More concerning is the lack of error handling - need to refactor in future
 // similar to `Hashable` etc. to enable less shakey policy.
+//
+// Integers and floats that Ruby holds as immediate values -- fixnums and
+// flonums -- are worked out here in Swift without calling Ruby, like the
+// Ruby VM's own optimized instructions.  Unlike the VM this does not notice
+// if `Integer#+` etc. have been redefined.  Anything else, including answers
+// that overflow or divide by zero, goes to the Ruby method.
 
 // MARK: - SignedNumeric
 
@@ -29,9 +36,13 @@ extension RbObject: SignedNumeric {
 
     /// Subtraction operator for `RbObject`s.
     ///
-    /// - note: Calls Ruby `-` method.  Crashes the process (`fatalError`)
+    /// - note: Calls Ruby `-` method unless both operands are small integers
+    ///         or floats.  Crashes the process (`fatalError`)
     ///         if the objects do not support subtraction.
     public static func -(lhs: RbObject, rhs: RbObject) -> RbObject {
+        if let result = RbImmediateNumber.subtract(lhs, rhs) {
+            return result
+        }
         do {
             return try lhs.call("-", args: [rhs])
         } catch {
@@ -41,9 +52,13 @@ extension RbObject: SignedNumeric {
 
     /// Addition operator for `RbObject`s.
     ///
-    /// - note: Calls Ruby `+` method.  Crashes the process (`fatalError`)
+    /// - note: Calls Ruby `+` method unless both operands are small integers
+    ///         or floats.  Crashes the process (`fatalError`)
     ///         if the objects do not support addition.
     public static func +(lhs: RbObject, rhs: RbObject) -> RbObject {
+        if let result = RbImmediateNumber.add(lhs, rhs) {
+            return result
+        }
         do {
             return try lhs.call("+", args: [rhs])
         } catch {
@@ -53,9 +68,13 @@ extension RbObject: SignedNumeric {
 
     /// Multiplication operator for `RbObject`s.
     ///
-    /// - note: Calls Ruby `*` method.  Crashes the process (`fatalError`)
+    /// - note: Calls Ruby `*` method unless both operands are small integers
+    ///         or floats.  Crashes the process (`fatalError`)
     ///         if the objects do not support multiplication.
     public static func *(lhs: RbObject, rhs: RbObject) -> RbObject {
+        if let result = RbImmediateNumber.multiply(lhs, rhs) {
+            return result
+        }
         do {
             return try lhs.call("*", args: [rhs])
         } catch {
@@ -65,9 +84,13 @@ extension RbObject: SignedNumeric {
 
     /// Division operator for `RbObject`s.
     ///
-    /// - note: Calls Ruby `/` method.  Crashes the process (`fatalError`)
+    /// - note: Calls Ruby `/` method unless both operands are small integers
+    ///         or floats.  Crashes the process (`fatalError`)
     ///         if the objects do not support division.
     public static func /(lhs: RbObject, rhs: RbObject) -> RbObject {
+        if let result = RbImmediateNumber.divide(lhs, rhs) {
+            return result
+        }
         do {
             return try lhs.call("/", args: [rhs])
         } catch {
@@ -77,9 +100,13 @@ extension RbObject: SignedNumeric {
 
     /// Remainder operator for `RbObject`s.
     ///
-    /// - note: Calls Ruby `%` method.  Crashes the process (`fatalError`)
+    /// - note: Calls Ruby `%` method unless both operands are small integers
+    ///         or floats.  Crashes the process (`fatalError`)
     ///         if the objects do not support remaindering.
     public static func %(lhs: RbObject, rhs: RbObject) -> RbObject {
+        if let result = RbImmediateNumber.remainder(lhs, rhs) {
+            return result
+        }
         do {
             return try lhs.call("%", args: [rhs])
         } catch {
@@ -131,6 +158,9 @@ extension RbObject: SignedNumeric {
     /// - note: Calls Ruby unary - method.  Crashes the process (`fatalError`)
     ///         if the object does not support this.
     public static prefix func -(_ operand: RbObject) -> RbObject {
+        if let result = RbImmediateNumber.negate(operand) {
+            return result
+        }
         do {
             return try operand.call("-@")
         } catch {
@@ -151,6 +181,114 @@ extension RbObject: SignedNumeric {
     }
 }
 
+// MARK: - Immediate arithmetic
+
+/// Arithmetic on fixnums and flonums, following the Ruby `Integer` and
+/// `Float` methods.  Each returns `nil` if Ruby has to do the work.
+private enum RbImmediateNumber {
+    case fixnum(Int)
+    case flonum(Double)
+
+    init?(_ object: RbObject) {
+        let value = object.withRubyValue { $0 }
+        if RB_FIXNUM_P(value) {
+            self = .fixnum(RB_FIX2LONG(value))
+        } else if RB_FLONUM_P(value) {
+            self = .flonum(RB_FLONUM2DBL(value))
+        } else {
+            return nil
+        }
+    }
+
+    var double: Double {
+        switch self {
+        case .fixnum(let int): return Double(int)
+        case .flonum(let dbl): return dbl
+        }
+    }
+
+    /// Apply an integer op if both are fixnums, otherwise a floating-point op
+    private static func apply(_ lhs: RbObject, _ rhs: RbObject,
+                              integer: (Int, Int) -> Int?,
+                              float: (Double, Double) -> Double?) -> RbObject? {
+        guard let left = RbImmediateNumber(lhs),
+            let right = RbImmediateNumber(rhs) else {
+            return nil
+        }
+        if case let .fixnum(l) = left, case let .fixnum(r) = right {
+            return integer(l, r).map { RbObject(rubyValue: RB_LONG2NUM($0)) }
+        }
+        return float(left.double, right.double).map { RbObject(rubyValue: DBL2NUM($0)) }
+    }
+
+    static func add(_ lhs: RbObject, _ rhs: RbObject) -> RbObject? {
+        apply(lhs, rhs, integer: { l, r in
+            let (result, overflow) = l.addingReportingOverflow(r)
+            return overflow ? nil : result
+        }, float: { $0 + $1 })
+    }
+
+    static func subtract(_ lhs: RbObject, _ rhs: RbObject) -> RbObject? {
+        apply(lhs, rhs, integer: { l, r in
+            let (result, overflow) = l.subtractingReportingOverflow(r)
+            return overflow ? nil : result
+        }, float: { $0 - $1 })
+    }
+
+    static func multiply(_ lhs: RbObject, _ rhs: RbObject) -> RbObject? {
+        apply(lhs, rhs, integer: { l, r in
+            let (result, overflow) = l.multipliedReportingOverflow(by: r)
+            return overflow ? nil : result
+        }, float: { $0 * $1 })
+    }
+
+    /// Integer division rounds towards negative infinity
+    static func divide(_ lhs: RbObject, _ rhs: RbObject) -> RbObject? {
+        apply(lhs, rhs, integer: { l, r in
+            divmod(l, r)?.div
+        }, float: { $0 / $1 })
+    }
+
+    /// Remainder has the sign of the divisor
+    static func remainder(_ lhs: RbObject, _ rhs: RbObject) -> RbObject? {
+        apply(lhs, rhs, integer: { l, r in
+            divmod(l, r)?.mod
+        }, float: { l, r in
+            // ruby_float_mod
+            guard r != 0 else {
+                return nil
+            }
+            var mod = (r.isInfinite && !l.isInfinite) ? l : l.truncatingRemainder(dividingBy: r)
+            if r * mod < 0 {
+                mod += r
+            }
+            return mod
+        })
+    }
+
+    /// fixdivmod - `nil` for divide by zero and the one overflow case
+    private static func divmod(_ l: Int, _ r: Int) -> (div: Int, mod: Int)? {
+        guard r != 0, !(l == Int.min && r == -1) else {
+            return nil
+        }
+        var div = l / r
+        var mod = l % r
+        if (mod < 0 && r > 0) || (mod > 0 && r < 0) {
+            mod += r
+            div -= 1
+        }
+        return (div, mod)
+    }
+
+    static func negate(_ operand: RbObject) -> RbObject? {
+        switch RbImmediateNumber(operand) {
+        case .fixnum(let int)?: return RbObject(rubyValue: RB_LONG2NUM(-int)) // fixnums are 63-bit
+        case .flonum(let dbl)?: return RbObject(rubyValue: DBL2NUM(-dbl))
+        case nil: return nil
+        }
+    }
+}
+
 // MARK: - Subscript
 
 extension RbObject {
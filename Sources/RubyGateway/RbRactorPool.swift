@@ -0,0 +1,168 @@
+//
+//  RbRactorPool.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+/// A pool of Ruby Ractors that run the same Ruby code in parallel on
+/// different inputs.
+///
+/// Ruby runs one thread at a time under the GVL, but each Ractor has its own
+/// lock so code running in different Ractors can use several cores.  A pool
+/// compiles some Ruby code into each of its Ractors and then runs it once
+/// for each input:
+/// ```swift
+/// let pool = try RbRactorPool(size: 8, ruby: "Transform.apply(input)")
+/// let outputs = try pool.map(inputs)
+/// ```
+///
+/// Each input goes to the next Ractor that is free, so one slow input does
+/// not hold up the rest.  The results come back in the same order as the inputs.
+///
+/// Ractors have strict rules about sharing objects.  Inputs and results are
+/// deep-copied between Ractors unless they are shareable.  The code can use
+/// classes and modules defined before the pool is created but cannot use most
+/// global state, nor any methods implemented in Swift.  See the Ruby
+/// `Ractor` documentation.
+///
+/// Ractors need Ruby 3.0 or later.
+///
+/// Use the pool from the Ruby thread that created it.  It holds its Ractors
+/// until `shutdown()` is called or the pool is deinitialized.
+public final class RbRactorPool {
+    /// The number of Ractors in the pool.
+    public let size: Int
+
+    /// The Ruby code that each Ractor runs for an input.
+    public let source: String
+
+    /// The Ruby-side pool object
+    private let pool: RbObject
+
+    /// Create a pool of Ractors.
+    ///
+    /// - parameter size: The number of Ractors to create, typically the number
+    ///             of CPU cores to use.
+    /// - parameter ruby: Ruby code to run for each input.  The code is the body
+    ///             of a lambda whose parameter is called `inputName`.
+    /// - parameter inputName: The name of the local variable holding the input.
+    ///             Default `input`.
+    /// - throws: `RbError.badParameter(_:)` if `size` is not positive or Ruby does
+    ///           not support Ractors.
+    ///           `RbError.badIdentifier(type:id:)` if `inputName` looks wrong.
+    ///           `RbError.rubyException(_:)` if Ruby can't create the Ractors or
+    ///           compile the code.
+    public init(size: Int, ruby: String, inputName: String = "input") throws {
+        try Ruby.setup()
+        guard size > 0 else {
+            try RbError.raise(error: .badParameter("Ractor pool size must be positive: \(size)."))
+        }
+        guard Ruby.apiVersion.0 >= 3 else {
+            try RbError.raise(error: .badParameter("Ractors need Ruby 3.0 or later, have \(Ruby.version)."))
+        }
+        try inputName.checkRubyLocalVarName()
+        self.size = size
+        self.source = ruby
+        pool = try RbRactorPool.poolClass().call("new", args: [size, ruby, inputName])
+    }
+
+    deinit {
+        shutdown()
+    }
+
+    /// Run the code once for each input, in parallel, and collect the results.
+    ///
+    /// Waits for every input to finish, even if some raise exceptions.
+    ///
+    /// - parameter inputs: The inputs to pass to the code.
+    /// - returns: The results of running the code, in the order of `inputs`.
+    /// - throws: `RbError.rubyException(_:)` if the code raises an exception
+    ///           for any input -- the message says which -- or if the pool has
+    ///           been shut down.
+    public func map(_ inputs: [RbObjectConvertible?]) throws -> [RbObject] {
+        let results = try pool.call("map", args: [inputs])
+        return Array(results.collection)
+    }
+
+    /// Stop the Ractors.  The pool cannot be used afterwards.
+    public func shutdown() {
+        // Only fails if we are being torn down with Ruby
+        let _ = try? pool.call("shutdown")
+    }
+
+    // MARK: - Ruby implementation
+
+    /// Lazily-created anonymous class implementing the pool
+    private static var poolClassObject: RbObject?
+
+    private static func poolClass() throws -> RbObject {
+        if let poolClassObject = poolClassObject {
+            return poolClassObject
+        }
+        let newPoolClass = try Ruby.eval(ruby: poolClassSource)
+        poolClassObject = newPoolClass
+        return newPoolClass
+    }
+
+    private static let poolClassSource = """
+    Class.new do
+      def initialize(size, code, input_name)
+        src = "lambda { |#{input_name}| #{code}\\n}"
+        @workers = Array.new(size) do |i|
+          Ractor.new(src, name: "rubygateway-#{i}") do |src|
+            fn = eval(src)
+            while (job = Ractor.receive) != :stop
+              token, id, input = job
+              result = begin
+                [token, id, true, fn.call(input)]
+              rescue Exception => e
+                [token, id, false, "#{e.class}: #{e.message}"]
+              end
+              Ractor.yield(result)
+            end
+          end
+        end
+        # Results each worker has been sent a job for but not yet given back.
+        # Outlives a `map` that raises or is interrupted part way through.
+        @owed = Hash.new(0)
+        @token = 0
+      end
+
+      def map(inputs)
+        raise "Ractor pool has been shut down" if @workers.empty?
+        # Tags this call's jobs: results for an earlier call are dropped
+        token = (@token += 1)
+        results = Array.new(inputs.size)
+        failure = nil
+        next_id = 0
+        done = 0
+        while done < inputs.size
+          @workers.each do |worker|
+            break if next_id >= inputs.size
+            next unless @owed[worker] == 0
+            worker.send([token, next_id, inputs[next_id]])
+            @owed[worker] += 1
+            next_id += 1
+          end
+          worker, (job_token, id, ok, value) = Ractor.select(*@workers.select { |w| @owed[w] > 0 })
+          @owed[worker] -= 1
+          next unless job_token == token
+          if ok
+            results[id] = value
+          else
+            failure ||= "Ractor job #{id} failed: #{value}"
+          end
+          done += 1
+        end
+        raise failure if failure
+        results
+      end
+
+      def shutdown
+        @workers.each { |worker| worker.send(:stop) }
+        @workers.clear
+      end
+    end
+    """
+}
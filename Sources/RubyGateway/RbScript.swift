@@ -0,0 +1,171 @@
+//
+//  RbScript.swift
+//  RubyGateway
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+/// A Ruby script compiled once that can be run many times.
+///
+/// `RbGateway.eval(ruby:)` parses and compiles its Ruby code every time it
+/// is called unless you turn on its cache, see `RbGateway.evalCacheCapacity`.
+/// When you run the same code many times it is faster to compile it yourself:
+/// ```swift
+/// let rule = try Ruby.compile(ruby: "price * quantity > limit",
+///                             localNames: ["price", "quantity"])
+/// for order in orders {
+///     if try rule.run(locals: [order.price, order.quantity]).isTruthy {
+///         ...
+///     }
+/// }
+/// ```
+///
+/// Scripts run at the top level, like `RbGateway.eval(ruby:)`.  A script with
+/// `localNames` is compiled as the body of a lambda whose parameters are those
+/// names, so a `return` ends the script early.
+///
+/// Create scripts using `RbGateway.compile(ruby:localNames:)`.
+public final class RbScript {
+    /// The Ruby code.
+    public let source: String
+
+    /// The names of the local variables set on each run.
+    public let localNames: [String]
+
+    /// The `RubyVM::InstructionSequence`, or the lambda made from it if there are locals
+    private let code: RbObject
+
+    init(source: String, localNames: [String]) throws {
+        self.source = source
+        self.localNames = localNames
+
+        // Keep the user's code on line 1 so errors make sense.
+        let iseqSource = localNames.isEmpty ?
+            source :
+            "lambda { |\(localNames.joined(separator: ", "))| \(source)\n}"
+        let iseq = try Ruby.get("RubyVM::InstructionSequence").call("compile", args: [iseqSource, "(eval)"])
+        code = localNames.isEmpty ? iseq : try iseq.call("eval")
+    }
+
+    /// Run the script and return the result.
+    ///
+    /// - parameter locals: Values for the local variables, in the order
+    ///             of `localNames`.  None by default.
+    /// - returns: The result of running the script.
+    /// - throws: `RbError.badParameter(_:)` if the wrong number of `locals` is passed.
+    ///           `RbError.rubyException(_:)` if there is a Ruby exception.
+    @discardableResult
+    public func run(locals: [RbObjectConvertible?] = []) throws -> RbObject {
+        guard locals.count == localNames.count else {
+            try RbError.raise(error: .badParameter("Script has \(localNames.count) locals, passed \(locals.count) values."))
+        }
+        if localNames.isEmpty {
+            return try code.call("eval")
+        }
+        return try code.call("call", args: locals)
+    }
+}
+
+// MARK: - Eval cache
+
+/// Least-recently-used cache of scripts for `RbGateway.eval(ruby:)`, keyed by source.
+///
+/// Source is only compiled and cached the second time it is seen: one-off code
+/// keeps going through `rb_eval_string()` and doesn't churn the cache.
+///
+/// Only touched with the GVL held.  Nothing here calls Ruby except for
+/// compiling a new script, which happens before the cache is modified.
+final class RbScriptCache {
+    private var entries: [String: (script: RbScript, lastUse: UInt64)] = [:]
+    private var seenOnce: Set<String> = []
+    private var clock: UInt64 = 0
+
+    /// The most scripts to keep, 0 to disable the cache
+    var capacity: Int {
+        didSet {
+            while entries.count > max(capacity, 0) {
+                evictOldest()
+            }
+            seenOnce.removeAll()
+        }
+    }
+
+    init(capacity: Int) {
+        self.capacity = capacity
+    }
+
+    private func evictOldest() {
+        if let oldest = entries.min(by: { $0.value.lastUse < $1.value.lastUse }) {
+            entries[oldest.key] = nil
+        }
+    }
+
+    /// Get the compiled version of some source, compiling if it has been seen before.
+    /// Returns `nil` if the cache is disabled or this is the first sighting.
+    func script(for source: String) throws -> RbScript? {
+        guard capacity > 0 else {
+            return nil
+        }
+        clock += 1
+        if let entry = entries[source] {
+            entries[source] = (entry.script, clock)
+            return entry.script
+        }
+        guard seenOnce.remove(source) != nil else {
+            if seenOnce.count >= capacity {
+                seenOnce.removeAll()
+            }
+            seenOnce.insert(source)
+            return nil
+        }
+        let script = try RbScript(source: source, localNames: [])
+        if entries.count >= capacity {
+            evictOldest()
+        }
+        entries[source] = (script, clock)
+        return script
+    }
+
+    /// The number of cached scripts
+    var count: Int {
+        entries.count
+    }
+}
+
+// MARK: - Compiling scripts
+
+extension RbGateway {
+    /// The cache behind `eval(ruby:)`
+    static let scriptCache = RbScriptCache(capacity: 0)
+
+    /// The number of distinct pieces of Ruby code `eval(ruby:)` keeps compiled.
+    ///
+    /// Default 0: `eval(ruby:)` compiles code every time.  With a capacity set,
+    /// code evaluated a second time is compiled once and kept.
+    ///
+    /// Cached code runs at the top level using `RubyVM::InstructionSequence#eval`
+    /// so it cannot see the local variables or `self` of any Ruby frame that
+    /// calls into Swift.  Leave the cache off if you rely on those, or use
+    /// `compile(ruby:localNames:)` to pass values in explicitly.
+    public var evalCacheCapacity: Int {
+        get {
+            RbGateway.scriptCache.capacity
+        }
+        set {
+            RbGateway.scriptCache.capacity = newValue
+        }
+    }
+
+    /// Compile some Ruby code so it can be run many times.  See `RbScript`.
+    ///
+    /// - parameter ruby: Ruby code to compile.
+    /// - parameter localNames: Names of local variables to set on each run.  None by default.
+    /// - returns: The compiled script.
+    /// - throws: `RbError.badIdentifier(type:id:)` if a local name looks wrong.
+    ///           `RbError.rubyException(_:)` if Ruby can't compile the code.
+    public func compile(ruby: String, localNames: [String] = []) throws -> RbScript {
+        try setup()
+        try localNames.forEach { try $0.checkRubyLocalVarName() }
+        return try RbScript(source: ruby, localNames: localNames)
+    }
+}
@@ -41,6 +41,16 @@ public struct RbSymbol: RbObjectConvertible, Hashable {
         }
         return RbObject(rubyValue: rb_id2sym(id))
     }
+
+    /// Symbols are equal if their names are
+    public static func == (lhs: RbSymbol, rhs: RbSymbol) -> Bool {
+        lhs.name == rhs.name
+    }
+
+    /// Hash the symbol's name
+    public func hash(into hasher: inout Hasher) {
+        hasher.combine(name)
+    }
 }
 
 // MARK: - CustomStringConvertible
@@ -89,12 +89,68 @@ public enum RbThread {
     /// Using this API ends up with no unblocking function for the section.
     /// See `callWithoutGvl(unblocking:callback:)` to configure that.
     public static func callWithoutGvl(callback: () -> Void) {
-        withoutActuallyEscaping(callback) { escapingCallback in
-            let context = RbThreadContext(escapingCallback)
-            context.withRaw { rawContext in
-                rb_thread_call_without_gvl(rbthread_callback, rawContext, nil, nil)
+        withoutGvl(unblocking: nil, checkingInterrupts: false, callback: callback)
+    }
+
+    /// A Ruby unblocking function
+    private typealias Ubf = @convention(c) (UnsafeMutableRawPointer?) -> Void
+
+    /// The one implementation of running some code without the GVL.
+    ///
+    /// `checkingInterrupts` leaves interrupts pending instead of letting Ruby
+    /// longjmp through the caller.
+    ///
+    /// - returns: `false` if `callback` didn't run because of an interrupt;
+    ///            only with `checkingInterrupts`.
+    @discardableResult
+    private static func withoutGvl(unblocking: UnblockingFunc?,
+                                   checkingInterrupts: Bool,
+                                   callback: () -> Void) -> Bool {
+        var ran = true
+        measuringGvlWait(callback) { callback in
+            withoutActuallyEscaping(callback) { escapingCallback in
+                let context = RbThreadContext(escapingCallback)
+                context.withRaw { rawContext in
+                    func call(ubf: Ubf?, ubfContext: UnsafeMutableRawPointer?) {
+                        if checkingInterrupts {
+                            ran = rbg_call_without_gvl(rbthread_callback, rawContext, ubf, ubfContext) != 0
+                        } else {
+                            rb_thread_call_without_gvl(rbthread_callback, rawContext, ubf, ubfContext)
+                        }
+                    }
+                    switch unblocking {
+                    case nil:
+                        call(ubf: nil, ubfContext: nil)
+                    case .io?:
+                        call(ubf: rbg_RUBY_UBF_IO(), ubfContext: nil)
+                    case .custom(let ubfFunc)?:
+                        withoutActuallyEscaping(ubfFunc) { escapingUbfFunc in
+                            let ubfContext = RbThreadContext(escapingUbfFunc)
+                            ubfContext.withRaw { rawUbfContext in
+                                call(ubf: rbthread_ubf_callback, ubfContext: rawUbfContext)
+                            }
+                        }
+                    }
+                }
             }
         }
+        return ran
+    }
+
+    /// Time how long it takes to get the GVL back after `callback` has run, for `RbMetrics`.
+    private static func measuringGvlWait(_ callback: () -> Void, call: (() -> Void) -> Void) {
+        guard RbMetrics.isEnabled else {
+            call(callback)
+            return
+        }
+        var callbackEnd: UInt64?
+        call {
+            callback()
+            callbackEnd = RbMetrics.timestamp
+        }
+        if let callbackEnd = callbackEnd, let now = RbMetrics.timestamp, now >= callbackEnd {
+            RbMetrics.record(.gvlWait, nanoseconds: now - callbackEnd)
+        }
     }
 
     /// A way to unblock a thread executing inside a `callWithoutGvl` section.
@@ -102,6 +158,7 @@ public enum RbThread {
         /// Same as `RUBY_UBF_IO`
         ///
         /// For pthread platforms, sends `SIGVTALRM` to the thread until it wakes up.
+        /// This interrupts a blocking system call but not CPU-bound code.
         case io
 
         /// A custom unblocking function.
@@ -118,21 +175,26 @@ public enum RbThread {
     /// This version of the API takes an unblocking function to be used when
     /// Ruby wants to interrupt the thread and get it back under GVL control.
     public static func callWithoutGvl(unblocking: UnblockingFunc, callback: () -> Void) {
-        withoutActuallyEscaping(callback) { escapingCallback in
-            let context = RbThreadContext(escapingCallback)
-            context.withRaw { rawContext in
-                switch unblocking {
-                case .custom(let ubfFunc):
-                    withoutActuallyEscaping(ubfFunc) { escapingUbfFunc in
-                        let ubfContext = RbThreadContext(escapingUbfFunc)
-                        ubfContext.withRaw { rawUbfContext in
-                            rb_thread_call_without_gvl(rbthread_callback, rawContext,
-                                                       rbthread_ubf_callback, rawUbfContext)
-                        }
-                    }
-                case .io:
-                    rb_thread_call_without_gvl(rbthread_callback, rawContext, rbg_RUBY_UBF_IO(), nil)
-                }
+        withoutGvl(unblocking: unblocking, checkingInterrupts: false, callback: callback)
+    }
+
+    /// Run some non-Ruby code without the GVL, then raise as a Swift error any
+    /// interrupt Ruby has for the thread such as `Thread#raise` or `Thread#kill`.
+    ///
+    /// `callWithoutGvl(unblocking:callback:)` lets Ruby act on those by
+    /// longjmp-ing through the Swift frames that called it; this waits until
+    /// they have returned.
+    ///
+    /// - throws: `RbError.rubyException(_:)` or `RbError.rubyJump(_:)` for an
+    ///           interrupt.  `callback` may not have run.
+    static func callWithoutGvlCheckingInterrupts(unblocking: UnblockingFunc, callback: () -> Void) throws {
+        var ran = false
+        while !ran {
+            ran = withoutGvl(unblocking: unblocking, checkingInterrupts: true, callback: callback)
+            // An interrupt pending on the way in stops `callback` running: if it
+            // isn't one that throws, try again.
+            try RbVM.doProtect { tag in
+                rbg_thread_check_ints_protect(&tag)
             }
         }
     }
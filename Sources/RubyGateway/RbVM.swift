@@ -28,8 +28,24 @@ final class RbVM {
     /// Current state of the VM
     private var state: State
 
-    /// Cache of rb_intern() calls.
-    private var idCache: [String: ID]
+    /// Immutable cache of rb_intern() calls, read without taking `lock`.
+    private final class IDSnapshot {
+        let ids: [String: ID]
+
+        init(_ ids: [String: ID]) {
+            self.ids = ids
+        }
+    }
+
+    /// Where the current `IDSnapshot` is published.
+    private let idSnapshotSlot: UnsafeMutablePointer<UnsafeMutableRawPointer?>
+
+    /// Every `IDSnapshot` ever published: a lock-free reader may still be using
+    /// any of them.  Snapshots grow geometrically so this is O(total IDs).
+    private var idSnapshots: [IDSnapshot]
+
+    /// Cache of rb_intern() calls made since the current snapshot, under `lock`.
+    private var idPending: [String: ID]
 
     /// Protect state (bit pointless given Ruby's state but feels bad not to)
     private var lock: Lock
@@ -37,7 +53,10 @@ final class RbVM {
     /// Set up data
     init() {
         state = .unknown
-        idCache = [:]
+        idSnapshotSlot = .allocate(capacity: 1)
+        idSnapshotSlot.initialize(to: nil)
+        idSnapshots = []
+        idPending = [:]
         // Paranoid about reentrant symbol lookup during finalizers...
         lock = Lock(recursive: true)
     }
@@ -88,6 +107,7 @@ final class RbVM {
     /// ... there's a compensating atexit() in `RbGateway.setup()`.)
     deinit {
         cleanup()
+        idSnapshotSlot.deallocate()
     }
 
     /// Has Ruby ever been set up in this process?
@@ -157,35 +177,85 @@ final class RbVM {
 
     /// Get an `ID` ready to call a method, for example.
     ///
-    /// Cache this on the Swift side.
+    /// Cache this on the Swift side.  Names in the published snapshot are found
+    /// without locking; others go via `idPending` and periodically get merged
+    /// into a new snapshot.
     ///
     /// - parameter name: name to look up, typically constant or method name.
     /// - returns: the corresponding ID
     /// - throws: `RbException` if Ruby raises -- probably means the `ID` space
     ///   is full, which is fairly unlikely.
     func getID(for name: String) throws -> ID {
+        if let rbId = currentIDSnapshot?.ids[name] {
+            return rbId
+        }
         return try lock.locked {
-            if let rbId = idCache[name] {
-                return rbId
+            let rbId = try intern(name: name)
+            if idPending.count > (currentIDSnapshot?.ids.count ?? 0) / 2 {
+                publishIDs()
             }
-            let rbId = try RbVM.doProtect { tag in
-                rbg_intern_protect(name, &tag)
-            }
-            idCache[name] = rbId
             return rbId
         }
     }
 
+    /// Get `ID`s for a set of names and make them all available to lock-free
+    /// lookup in `getID(for:)`.
+    ///
+    /// - parameter names: names to look up.
+    /// - throws: `RbException` if Ruby raises.
+    func preloadIDs(for names: [String]) throws {
+        try lock.locked {
+            defer { publishIDs() }
+            try names.forEach { _ = try intern(name: $0) }
+        }
+    }
+
+    /// The most recently published snapshot.
+    private var currentIDSnapshot: IDSnapshot? {
+        guard let raw = rbg_atomic_load_ptr(idSnapshotSlot) else {
+            return nil
+        }
+        return Unmanaged<IDSnapshot>.fromOpaque(raw).takeUnretainedValue()
+    }
+
+    /// Lookup-or-create an `ID` on the slow path.  Called under `lock`.
+    private func intern(name: String) throws -> ID {
+        if let rbId = currentIDSnapshot?.ids[name] ?? idPending[name] {
+            return rbId
+        }
+        let rbId = try RbVM.doProtect { tag in
+            rbg_intern_protect(name, &tag)
+        }
+        idPending[name] = rbId
+        return rbId
+    }
+
+    /// Merge pending `ID`s into a new snapshot and publish it.  Called under `lock`.
+    private func publishIDs() {
+        guard !idPending.isEmpty else {
+            return
+        }
+        let merged = (currentIDSnapshot?.ids ?? [:]).merging(idPending) { old, _ in old }
+        let snapshot = IDSnapshot(merged)
+        idSnapshots.append(snapshot)
+        idPending = [:]
+        rbg_atomic_store_ptr(idSnapshotSlot, Unmanaged.passUnretained(snapshot).toOpaque())
+    }
+
     /// Helper to call a protected Ruby API function and propagate any Ruby exception
     /// or unusual flow control as a Swift `RbException`.
     static func doProtect<T>(call: (inout Int32) -> T) throws -> T {
+        let span = RbMetrics.begin(.protectedCall)
         var tag = Int32(0)
         let result = call(&tag)
+        RbMetrics.end(span)
 
-        let errorObj = RbObject(rubyValue: rb_errinfo())
-        guard !errorObj.isNil else {
+        // Don't create an `RbObject` on the no-error path.
+        let errorValue = rb_errinfo()
+        guard errorValue != Qnil else {
             return result
         }
+        let errorObj = RbObject(rubyValue: errorValue)
 
         switch errorObj.rubyType {
         case .T_OBJECT:
@@ -197,4 +267,50 @@ final class RbVM {
             try RbError.raise(error: .rubyJump(tag))
         }
     }
+
+    /// Run a batch of operations under one Ruby exception handler.
+    ///
+    /// - parameter ops: The operations to run.
+    /// - parameter keep: A Ruby array to hold the result `VALUE`s.
+    /// - parameter completed: Set to the number of operations that succeeded.
+    /// - throws: The error from the first operation that fails, as `doProtect(call:)`.
+    static func doProtectBatch(ops: UnsafeMutableBufferPointer<Rbg_batch_op>,
+                               keep: VALUE,
+                               completed: inout Int) throws {
+        guard let opsBase = ops.baseAddress else {
+            completed = 0
+            return
+        }
+        try doProtect { tag in
+            rbg_protect_batch(opsBase, ops.count, keep, &completed, &tag)
+        }
+    }
+
+    /// Visit each key-value pair of a Ruby hash under one Ruby exception handler.
+    ///
+    /// - parameter hashValue: The hash to iterate, which the caller keeps alive.
+    /// - parameter visit: Called with each key and value.  Return `false` to stop.
+    ///             It must not modify the hash.
+    /// - throws: `RbError.rubyException(_:)` if Ruby has a problem, as `doProtect(call:)`.
+    static func doProtectHashForEach(hashValue: VALUE, visit: (VALUE, VALUE) -> Bool) throws {
+        try withoutActuallyEscaping(visit) { visit in
+            var visitor = RbHashVisitor(visit: visit)
+            try withUnsafeMutablePointer(to: &visitor) { visitorPtr in
+                try doProtect { tag in
+                    rbg_hash_foreach_protect(hashValue, rbvm_hash_foreach_callback, visitorPtr, &tag)
+                }
+            }
+        }
+    }
+}
+
+/// Context for `RbVM.doProtectHashForEach(hashValue:visit:)`
+private struct RbHashVisitor {
+    let visit: (VALUE, VALUE) -> Bool
+}
+
+/// Callback from `rbg_hash_foreach_protect`, must not raise
+private func rbvm_hash_foreach_callback(key: VALUE, value: VALUE, context: UnsafeMutableRawPointer?) -> Int32 {
+    let visitor = context!.assumingMemoryBound(to: RbHashVisitor.self)
+    return visitor.pointee.visit(key, value) ? 0 : 1
 }
@@ -80,6 +80,26 @@ extension String {
         try check(\String.isRubyClassVarName, "class var (@@)")
     }
 
+    /// Does the string look like a Ruby local variable name?
+    var isRubyLocalVarName: Bool {
+        // ASCII lowercase or underscore to start, any non-ASCII is OK
+        func isIdentChar(_ char: UInt8) -> Bool {
+            return char == UInt8(ascii: "_") || char >= 0x80 || rb_isalnum(Int32(char)) != 0
+        }
+        guard let firstChar = utf8.first,
+            isIdentChar(firstChar),
+            rb_isdigit(Int32(firstChar)) == 0,
+            rb_isupper(Int32(firstChar)) == 0 else {
+            return false
+        }
+        return utf8.allSatisfy(isIdentChar)
+    }
+
+    /// Throw if the string does not look like a local variable name.
+    func checkRubyLocalVarName() throws {
+        try check(\String.isRubyLocalVarName, "local var")
+    }
+
     /// Does the string look like a Ruby method name?
     var isRubyMethodName: Bool {
         return !isRubyConstantName && !isRubyGlobalVarName && !isRubyInstanceVarName && !isRubyClassVarName
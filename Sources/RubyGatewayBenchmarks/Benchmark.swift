@@ -0,0 +1,93 @@
+//
+//  Benchmark.swift
+//  RubyGatewayBenchmarks
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+import Dispatch
+import Foundation
+import RubyGateway
+
+/// One thing to measure, optionally parameterized by size or arity.
+struct Benchmark {
+    /// Name of the path being measured, eg. `call`
+    let name: String
+    /// Size or arity, if relevant
+    let parameter: Int?
+    /// Set up the benchmark and return the code to time.  The returned
+    /// closure is passed the number of operations to run.
+    let setup: () throws -> (Int) throws -> Void
+
+    init(_ name: String, _ parameter: Int? = nil, setup: @escaping () throws -> (Int) throws -> Void) {
+        self.name = name
+        self.parameter = parameter
+        self.setup = setup
+    }
+
+    /// The name shown in the results
+    var fullName: String {
+        parameter.map { "\(name)/\($0)" } ?? name
+    }
+}
+
+/// The cost of one operation.
+struct BenchmarkResult {
+    /// Wall-clock nanoseconds, best of the timed rounds
+    let nsPerOp: Double
+    /// Ruby heap objects allocated
+    let allocsPerOp: Double
+}
+
+/// Somewhere to put results so the optimizer can't discard them.
+var blackHole: Any?
+
+/// Ruby's running count of allocated heap objects.
+private func rubyAllocations() throws -> Int {
+    try Int(Ruby.get("GC").call("stat", args: [RbSymbol("total_allocated_objects")])) ?? 0
+}
+
+private func runGC() throws {
+    try Ruby.get("GC").call("start")
+}
+
+extension Benchmark {
+    /// Measure the benchmark.
+    ///
+    /// The number of operations is scaled until a round takes about
+    /// `roundTime` seconds, then the fastest of `rounds` rounds is reported.
+    func run(roundTime: Double, rounds: Int) throws -> BenchmarkResult {
+        let body = try setup()
+
+        func timeRound(_ count: Int) throws -> UInt64 {
+            let start = DispatchTime.now().uptimeNanoseconds
+            try body(count)
+            return DispatchTime.now().uptimeNanoseconds - start
+        }
+
+        // Warm up + calibrate
+        let targetNs = roundTime * 1e9
+        var count = 1
+        var elapsed = try timeRound(count)
+        while Double(elapsed) < targetNs / 10 {
+            count *= 2
+            elapsed = try timeRound(count)
+        }
+        count = max(1, Int(Double(count) * targetNs / Double(max(elapsed, 1))))
+
+        // Both numbers come from the fastest round
+        var bestNs = Double.greatestFiniteMagnitude
+        var bestAllocs = 0
+        for _ in 0..<rounds {
+            try runGC()
+            let allocsBefore = try rubyAllocations()
+            let ns = Double(try timeRound(count)) / Double(count)
+            let allocs = try rubyAllocations() - allocsBefore
+            if ns < bestNs {
+                bestNs = ns
+                bestAllocs = allocs
+            }
+        }
+        return BenchmarkResult(nsPerOp: bestNs, allocsPerOp: Double(bestAllocs) / Double(count))
+    }
+}
@@ -0,0 +1,408 @@
+//
+//  main.swift
+//  RubyGatewayBenchmarks
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+// Microbenchmarks for the RubyGateway hot paths.
+//
+// swift run -c release RubyGatewayBenchmarks [--filter <text>] [--time <seconds>] [--rounds <n>]
+//
+// Reports wall-clock ns/op and Ruby heap objects allocated per op.
+
+import Foundation
+import RubyGateway
+
+let sizes = [1, 16, 256, 4096]
+let arities = [0, 1, 2, 4]
+
+// MARK: - Ruby fixture
+
+let rubyFixture = """
+class BenchmarkTarget
+  def m0; end
+  def m1(a); end
+  def m2(a, b); end
+  def m3(a, b, c); end
+  def m4(a, b, c, d); end
+
+  def yield_one
+    yield 1
+  end
+
+  def yield_n(n)
+    n.times { |i| yield i }
+  end
+
+  # Drive Swift method dispatch from Ruby
+  def drive(method, n, *args)
+    i = 0
+    while i < n
+      send(method, *args)
+      i += 1
+    end
+  end
+end
+"""
+
+func makeTarget() throws -> RbObject {
+    try Ruby.get("BenchmarkTarget").call("new")
+}
+
+/// Args for a method call of some arity
+func makeArgs(_ arity: Int) -> [RbObject] {
+    (0..<arity).map { RbObject($0) }
+}
+
+// MARK: - Benchmarks
+
+var benchmarks: [Benchmark] = []
+
+// Objects
+
+benchmarks.append(Benchmark("object.copy") {
+    let obj = RbObject("string")
+    return { count in
+        for _ in 0..<count {
+            blackHole = RbObject(obj)
+        }
+    }
+})
+
+benchmarks.append(Benchmark("object.int") {
+    { count in
+        for i in 0..<count {
+            blackHole = RbObject(i)
+        }
+    }
+})
+
+benchmarks.append(Benchmark("int.fromRuby") {
+    let object = RbObject(12345)
+    return { count in
+        for _ in 0..<count {
+            blackHole = Int(object)
+        }
+    }
+})
+
+benchmarks.append(Benchmark("operator.int") {
+    let one: RbObject = 1
+    return { count in
+        var total: RbObject = 0
+        for _ in 0..<count {
+            total = total + one
+        }
+        blackHole = total
+    }
+})
+
+benchmarks.append(Benchmark("operator.double") {
+    let half: RbObject = 0.5
+    return { count in
+        var total: RbObject = 0.0
+        for _ in 0..<count {
+            total = total * half + half
+        }
+        blackHole = total
+    }
+})
+
+benchmarks.append(Benchmark("getID") {
+    { count in
+        for _ in 0..<count {
+            blackHole = try Ruby.getID(for: "benchmark_method")
+        }
+    }
+})
+
+// Calls
+
+for arity in arities {
+    benchmarks.append(Benchmark("call", arity) {
+        let target = try makeTarget()
+        let args = makeArgs(arity)
+        let name = "m\(arity)"
+        return { count in
+            for _ in 0..<count {
+                blackHole = try target.call(name, args: args)
+            }
+        }
+    })
+}
+
+for arity in arities {
+    benchmarks.append(Benchmark("callSite", arity) {
+        let callSite = try makeTarget().callSite("m\(arity)", arity: arity)
+        let args = makeArgs(arity)
+        return { count in
+            for _ in 0..<count {
+                blackHole = try callSite.call(args: args)
+            }
+        }
+    })
+}
+
+benchmarks.append(Benchmark("call.kwArgs") {
+    let target = try Ruby.eval(ruby: "Struct.new(:a, :b, keyword_init: true)")
+    return { count in
+        for _ in 0..<count {
+            blackHole = try target.call("new", kwArgs: ["a": 1, "b": 2])
+        }
+    }
+})
+
+// Blocks
+
+benchmarks.append(Benchmark("block.call") {
+    let target = try makeTarget()
+    return { count in
+        for _ in 0..<count {
+            blackHole = try target.call("yield_one") { _ in .nilObject }
+        }
+    }
+})
+
+for size in sizes {
+    benchmarks.append(Benchmark("block.yield", size) {
+        let target = try makeTarget()
+        return { count in
+            for _ in 0..<count {
+                blackHole = try target.call("yield_n", args: [size]) { _ in .nilObject }
+            }
+        }
+    })
+}
+
+for size in sizes {
+    benchmarks.append(Benchmark("block.borrowed", size) {
+        let target = try makeTarget()
+        return { count in
+            for _ in 0..<count {
+                blackHole = try target.callWithBorrowedBlock("yield_n", args: [size]) { _ in .nilObject }
+            }
+        }
+    })
+}
+
+for size in sizes {
+    benchmarks.append(Benchmark("each.int", size) {
+        let object = Array(0..<size).rubyObject
+        return { count in
+            var total = 0
+            for _ in 0..<count {
+                try object.each(as: Int.self) { total &+= $0 }
+            }
+            blackHole = total
+        }
+    })
+}
+
+// Swift methods, called from a Ruby loop
+
+for arity in arities {
+    benchmarks.append(Benchmark("method.swift", arity) {
+        let target = try makeTarget()
+        try target.defineSingletonMethod("swift_m\(arity)",
+                                         argsSpec: RbMethodArgsSpec(leadingMandatoryCount: arity)) { _, _ in
+            .nilObject
+        }
+        let args: [RbObjectConvertible?] = makeArgs(arity)
+        return { count in
+            let driveArgs: [RbObjectConvertible?] = [RbSymbol("swift_m\(arity)"), count]
+            try target.call("drive", args: driveArgs + args)
+        }
+    })
+}
+
+for arity in arities {
+    benchmarks.append(Benchmark("method.borrowed", arity) {
+        let target = try makeTarget()
+        try target.defineSingletonMethod("borrowed_m\(arity)", argCount: arity) { _ in
+            .nilObject
+        }
+        let args: [RbObjectConvertible?] = makeArgs(arity)
+        return { count in
+            let driveArgs: [RbObjectConvertible?] = [RbSymbol("borrowed_m\(arity)"), count]
+            try target.call("drive", args: driveArgs + args)
+        }
+    })
+}
+
+benchmarks.append(Benchmark("method.ruby") {
+    let target = try makeTarget()
+    return { count in
+        try target.call("drive", args: [RbSymbol("m0"), count])
+    }
+})
+
+// Arrays
+
+for size in sizes {
+    benchmarks.append(Benchmark("array.int.toRuby", size) {
+        let array = Array(0..<size)
+        return { count in
+            for _ in 0..<count {
+                blackHole = array.rubyObject
+            }
+        }
+    })
+}
+
+for size in sizes {
+    benchmarks.append(Benchmark("array.int.fromRuby", size) {
+        let object = Array(0..<size).rubyObject
+        return { count in
+            for _ in 0..<count {
+                blackHole = Array<Int>(object)
+            }
+        }
+    })
+}
+
+for size in sizes {
+    benchmarks.append(Benchmark("array.string.fromRuby", size) {
+        let object = (0..<size).map { "element \($0)" }.rubyObject
+        return { count in
+            for _ in 0..<count {
+                blackHole = Array<String>(object)
+            }
+        }
+    })
+}
+
+// Strings
+
+for size in sizes {
+    benchmarks.append(Benchmark("string.toRuby", size) {
+        let string = String(repeating: "x", count: size)
+        return { count in
+            for _ in 0..<count {
+                blackHole = string.rubyObject
+            }
+        }
+    })
+}
+
+for size in sizes {
+    benchmarks.append(Benchmark("string.fromRuby", size) {
+        let object = String(repeating: "x", count: size).rubyObject
+        return { count in
+            for _ in 0..<count {
+                blackHole = String(object)
+            }
+        }
+    })
+}
+
+benchmarks.append(Benchmark("string.interned") {
+    { count in
+        for _ in 0..<count {
+            blackHole = RbObject(interned: "status ok")
+        }
+    }
+})
+
+benchmarks.append(Benchmark("symbol.toRuby") {
+    let symbol = RbSymbol("status")
+    return { count in
+        for _ in 0..<count {
+            blackHole = symbol.rubyObject
+        }
+    }
+})
+
+// Hashes
+
+for size in sizes {
+    benchmarks.append(Benchmark("hash.toRuby", size) {
+        let dict = Dictionary(uniqueKeysWithValues: (0..<size).map { ("key \($0)", $0) })
+        return { count in
+            for _ in 0..<count {
+                blackHole = dict.rubyObject
+            }
+        }
+    })
+}
+
+for size in sizes {
+    benchmarks.append(Benchmark("hash.fromRuby", size) {
+        let object = Dictionary(uniqueKeysWithValues: (0..<size).map { ("key \($0)", $0) }).rubyObject
+        return { count in
+            for _ in 0..<count {
+                blackHole = Dictionary<String, Int>(object)
+            }
+        }
+    })
+}
+
+// Codable
+
+struct CodableRecord: Codable {
+    let id: Int
+    let name: String
+    let score: Double
+    let tags: [String]
+}
+
+for size in sizes {
+    benchmarks.append(Benchmark("codable.encode", size) {
+        let encoder = RbEncoder()
+        let records = (0..<size).map { CodableRecord(id: $0, name: "record \($0)", score: 0.5, tags: ["a", "b"]) }
+        return { count in
+            for _ in 0..<count {
+                blackHole = try encoder.encode(records)
+            }
+        }
+    })
+}
+
+for size in sizes {
+    benchmarks.append(Benchmark("codable.decode", size) {
+        let decoder = RbDecoder()
+        let records = (0..<size).map { CodableRecord(id: $0, name: "record \($0)", score: 0.5, tags: ["a", "b"]) }
+        let object = try RbEncoder().encode(records)
+        return { count in
+            for _ in 0..<count {
+                blackHole = try decoder.decode([CodableRecord].self, from: object)
+            }
+        }
+    })
+}
+
+// MARK: - Main
+
+var filter: String?
+var roundTime = 0.2
+var rounds = 3
+
+var arguments = CommandLine.arguments.dropFirst().makeIterator()
+while let argument = arguments.next() {
+    switch argument {
+    case "--filter": filter = arguments.next()
+    case "--time": roundTime = arguments.next().flatMap(Double.init) ?? roundTime
+    case "--rounds": rounds = arguments.next().flatMap(Int.init) ?? rounds
+    default:
+        print("Usage: RubyGatewayBenchmarks [--filter <text>] [--time <seconds>] [--rounds <n>]")
+        exit(1)
+    }
+}
+
+do {
+    let _ = try Ruby.eval(ruby: rubyFixture)
+    print("Ruby \(Ruby.versionDescription)")
+    print("benchmark".padding(toLength: 28, withPad: " ", startingAt: 0) + "      ns/op   allocs/op")
+
+    for benchmark in benchmarks {
+        if let filter = filter, !benchmark.fullName.contains(filter) {
+            continue
+        }
+        let result = try benchmark.run(roundTime: roundTime, rounds: rounds)
+        print(benchmark.fullName.padding(toLength: 28, withPad: " ", startingAt: 0) +
+              String(format: "%11.1f %11.2f", result.nsPerOp, result.allocsPerOp))
+    }
+} catch {
+    print("Benchmark failed: \(error)")
+    exit(1)
+}
@@ -27,6 +27,10 @@ void rbg_load_protect(VALUE fname, int wrap, int * _Nonnull status);
 /// Safely call `rb_intern` and report exception status.
 ID rbg_intern_protect(const char * _Nonnull name, int * _Nonnull status);
 
+/// Safely make a frozen UTF-8 string from Ruby's table of deduplicated
+/// strings and report exception status.
+VALUE rbg_interned_str_protect(const char * _Nonnull ptr, long len, int * _Nonnull status);
+
 /// Safely call `rb_const_get_at` and report exception status.
 VALUE rbg_const_get_protect(VALUE value, ID id, int * _Nonnull status);
 
@@ -56,6 +60,8 @@ typedef enum {
     RBG_RT_VALUE,
     /// Raise an exception
     RBG_RT_RAISE,
+    /// Create an exception from `value` class and `message`, and raise it
+    RBG_RT_RAISE_NEW,
     /// Do 'break' - rare use in iterator blocks
     RBG_RT_BREAK,
     /// Do 'break' with a value - rare use in iterator blocks
@@ -70,8 +76,17 @@ typedef struct {
     Rbg_return_type type;
     /// Value to return or exception to raise
     VALUE           value;
+    /// Message for `RBG_RT_RAISE_NEW`, freed after raising, NULL if out of memory
+    char * _Nullable message;
+    long            messageLength;
 } Rbg_return_value;
 
+/// Ask Ruby to raise a new exception without creating it now.
+void rbg_return_value_set_new_exception(Rbg_return_value * _Nonnull rv,
+                                        VALUE exceptionClass,
+                                        const char * _Nonnull message,
+                                        long messageLength);
+
 /// Callback into Swift code for a block, using a void * context
 typedef void (*Rbg_pvoid_block_call)(void * _Nonnull context,
                                      int argc,
@@ -92,6 +107,10 @@ void rbg_register_pvoid_block_proc_callback(Rbg_pvoid_block_call _Nonnull);
 /// Set the single function where all value-context block/proc calls go
 void rbg_register_value_block_proc_callback(Rbg_value_block_call _Nonnull);
 
+/// Set the single function where all borrowed-args block calls go.
+/// The context is a pointer to a Swift struct on the caller's stack.
+void rbg_register_borrowed_block_proc_callback(Rbg_pvoid_block_call _Nonnull);
+
 /// Safely call `rb_block_call`, invoking the registered pvoid-context
 /// block handler with the given context as the block.
 /// And report exception status.
@@ -108,6 +127,14 @@ VALUE rbg_block_call_value_protect(VALUE value, ID id,
                                    VALUE context,
                                    int * _Nonnull status);
 
+/// Safely call `rb_block_call`, invoking the registered borrowed-args
+/// block handler with the given context as the block.
+/// And report exception status.
+VALUE rbg_block_call_borrowed_protect(VALUE value, ID id,
+                                      int argc, const VALUE * _Nonnull argv, int kwArgs,
+                                      void * _Nonnull context,
+                                      int * _Nonnull status);
+
 /// Safely call `rb_proc_call_with_block` and report exception status.
 VALUE rbg_proc_call_with_block_protect(VALUE value,
                                        int argc, const VALUE * _Nonnull argv,
@@ -124,6 +151,27 @@ VALUE rbg_String_protect(VALUE v, int * _Nonnull status);
 long                  rbg_RSTRING_LEN(VALUE v);
 const char * _Nonnull rbg_RSTRING_PTR(VALUE v);
 
+/// `RHASH_SIZE` for Swift
+long rbg_RHASH_SIZE(VALUE v);
+
+/// `RARRAY_CONST_PTR` for Swift.  Only valid until Ruby code runs.
+const VALUE * _Nullable rbg_RARRAY_CONST_PTR(VALUE v);
+
+/// `==` for simple keys -- fixnums, symbols, `nil`, `true`, `false`, plain
+/// `String`s -- as Ruby's Hash does.  Also says identical objects are equal,
+/// except floats.  Returns 1 or 0, or -1 if Ruby's `==` must decide.
+int rbg_fast_equal(VALUE lhs, VALUE rhs);
+/// `hash` for simple keys.  Returns nonzero if it set `hash`, 0 if Ruby's
+/// `hash` must be called.
+int rbg_fast_hash(VALUE v, long * _Nonnull hash);
+/// Can `v`'s hash never change: Ruby 3+ and deep-frozen.  For objects `rbg_fast_hash` can't do.
+int rbg_hash_is_stable(VALUE v);
+
+/// Stop a string being modified until `rbg_str_unlock()`, unless it is
+/// frozen or already locked.  Returns nonzero if it needs unlocking.
+int  rbg_str_lock(VALUE v);
+void rbg_str_unlock(VALUE v);
+
 /// Safely call `rb_num2ulong(rb_Integer)` and report exception status.
 /// Additionally, raise an exception if the number is negative.
 unsigned long rbg_obj2ulong_protect(VALUE v, int * _Nonnull status);
@@ -137,11 +185,84 @@ double rbg_obj2double_protect(VALUE v, int * _Nonnull status);
 /// Safely call `rb_Array` and report exception status.
 VALUE rbg_Array_protect(VALUE v, int * _Nonnull status);
 
+/// Convert every element of a Ruby array as `rbg_obj2long_protect` would,
+/// writing `count` results to `out`.  Reports the first exception.
+void rbg_ary_to_longs_protect(VALUE ary, long * _Nonnull out, long count,
+                              int * _Nonnull status);
+
+/// Convert every element of a Ruby array as `rbg_obj2double_protect` would,
+/// writing `count` results to `out`.  Reports the first exception.
+void rbg_ary_to_doubles_protect(VALUE ary, double * _Nonnull out, long count,
+                                int * _Nonnull status);
+
+/// Write the truthiness of the first `count` elements of a Ruby array to `out`.
+void rbg_ary_to_bools(VALUE ary, _Bool * _Nonnull out, long count);
+
+/// Create Ruby arrays from C arrays of simple types.
+VALUE rbg_ary_new_from_longs(const long * _Nullable values, long count);
+VALUE rbg_ary_new_from_doubles(const double * _Nullable values, long count);
+VALUE rbg_ary_new_from_bools(const _Bool * _Nullable values, long count);
+
+/// Safely call `rb_ary_store` and report exception status.
+void rbg_ary_store_protect(VALUE ary, long index, VALUE value,
+                           int * _Nonnull status);
+
+/// Safely replace `length` elements of an array starting at `start` with
+/// `count` new `values`, and report exception status.
+void rbg_ary_splice_protect(VALUE ary, long start, long length,
+                            const VALUE * _Nullable values, long count,
+                            int * _Nonnull status);
+
+/// Batched operations
+typedef enum {
+    RBG_BATCH_FUNCALLV,
+    RBG_BATCH_INSPECT,
+    RBG_BATCH_STRING,
+    RBG_BATCH_TO_LONG,
+    RBG_BATCH_TO_DOUBLE,
+} Rbg_batch_job;
+
+/// One operation in a batch.  The `argv` etc. are as for the regular
+/// protected version of the call.
+typedef struct {
+    Rbg_batch_job          job;
+    VALUE                  value;
+    ID                     id;
+    int                    argc;
+    const VALUE * _Nullable argv;
+    int                    kwArgs;
+
+    /// Results, depending on the job
+    VALUE                  valueResult;
+    long                   longResult;
+    double                 doubleResult;
+} Rbg_batch_op;
+
+/// Run `count` operations under a single `rb_protect`, stopping at the first
+/// exception and reporting its status.  `completed` says how many succeeded.
+/// Every result `VALUE` is appended to the Ruby array `keep`.
+void rbg_protect_batch(Rbg_batch_op * _Nonnull ops, long count, VALUE keep,
+                       long * _Nonnull completed, int * _Nonnull status);
+
 /// Safely call `rb_Hash` (sort of) and report exception status.
 VALUE rbg_Hash_protect(VALUE v, int * _Nonnull status);
 
-/// Safely call `rb_error_arity` and report exception status.
-void rbg_error_arity_protect(int argc, int min, int max, int * _Nonnull status);
+/// Callback for `rbg_hash_foreach_protect`, must not raise.
+/// Return nonzero to stop iterating.
+typedef int (*Rbg_hash_foreach_call)(VALUE key, VALUE value, void * _Nullable context);
+
+/// Safely call `rb_hash_foreach`, passing each key-value pair to `call`,
+/// and report exception status.
+void rbg_hash_foreach_protect(VALUE hash,
+                              Rbg_hash_foreach_call _Nonnull call,
+                              void * _Nullable context,
+                              int * _Nonnull status);
+
+/// Safely create a Ruby hash from `count` key-value pairs stored as
+/// `[key0, value0, key1, value1, ...]` and report exception status.
+/// Later duplicate keys replace earlier ones.
+VALUE rbg_hash_new_from_pairs_protect(const VALUE * _Nullable pairs, long count,
+                                      int * _Nonnull status);
 
 /// Safely call `rb_extract/scan_args` and report exception status.
 VALUE rbg_scan_arg_hash_protect(VALUE last_arg,
@@ -174,9 +295,20 @@ void rbg_inject_module_protect(VALUE into, VALUE module,
 VALUE rbg_call_super_protect(int argc, const VALUE * _Nonnull argv, int kwArgs,
                              int * _Nonnull status);
 
+/// Storage for a gvar implemented in Swift -- Ruby passes it back to
+/// the getter and setter.  Ruby marks `value`.
+typedef struct {
+    /// Value Ruby reads in cached mode.  Must come first.
+    VALUE           value;
+    /// Nonzero to read `value` instead of calling Swift.
+    int             cached;
+    /// The Swift context.
+    void * _Nonnull context;
+} Rbg_gvar;
+
 /// Callback into Swift code for gvar access
-typedef VALUE (*Rbg_gvar_get_call)(ID id);
-typedef void (*Rbg_gvar_set_call)(ID id,
+typedef VALUE (*Rbg_gvar_get_call)(void * _Nonnull context);
+typedef void (*Rbg_gvar_set_call)(void * _Nonnull context,
                                   VALUE newValue,
                                   Rbg_return_value * _Nonnull returnValue);
 
@@ -184,8 +316,14 @@ typedef void (*Rbg_gvar_set_call)(ID id,
 void rbg_register_gvar_callbacks(Rbg_gvar_get_call _Nonnull get,
                                  Rbg_gvar_set_call _Nonnull set);
 
-/// Bind a global variable name to Swift code
-ID rbg_create_virtual_gvar(const char * _Nonnull name, int readonly);
+/// Bind a global variable name to Swift code.  The `Rbg_gvar` must be
+/// freed with `rbg_gvar_free()` once Ruby no longer uses it.
+Rbg_gvar * _Nonnull rbg_create_virtual_gvar(const char * _Nonnull name,
+                                            int readonly,
+                                            int cached,
+                                            VALUE cachedValue,
+                                            void * _Nonnull context);
+void rbg_gvar_free(Rbg_gvar * _Nonnull gvar);
 
 /// Strings hidden from importer
 const char * _Nonnull rbg_ruby_version(void);
@@ -195,23 +333,53 @@ const char * _Nonnull rbg_ruby_description(void);
 typedef void rbg_unblock_function_t(void * _Nullable);
 rbg_unblock_function_t * _Nonnull rbg_RUBY_UBF_IO(void);
 
+/// `rb_thread_call_without_gvl2`: call `func` without the GVL, leaving any
+/// interrupts pending for `rbg_thread_check_ints_protect()`.  Does not call
+/// `func` if there is an interrupt pending already.  Returns nonzero if it did.
+int rbg_call_without_gvl(void * _Nullable (* _Nonnull func)(void * _Nullable),
+                         void * _Nullable data,
+                         rbg_unblock_function_t * _Nullable ubf,
+                         void * _Nullable ubfData);
+
+/// Safely call `rb_thread_check_ints` and report exception status.
+void rbg_thread_check_ints_protect(int * _Nonnull status);
+
+/// Atomic pointer access for lock-free publication of immutable data.
+/// The C11 atomics, because Swift's standard library has none of its own.
+void * _Nullable rbg_atomic_load_ptr(void * _Nullable * _Nonnull slot);
+void             rbg_atomic_store_ptr(void * _Nullable * _Nonnull slot,
+                                      void * _Nullable value);
+/// Atomic access for flags.
+int  rbg_atomic_load_int(int * _Nonnull slot);
+void rbg_atomic_store_int(int * _Nonnull slot, int value);
+
 /// Ruby 3 incompatible changes from Swift's point of view
 int rbg_type(VALUE v);
 int rbg_qfalse(void);
 int rbg_qtrue(void);
 int rbg_qnil(void);
 int rbg_qundef(void);
+int rbg_use_flonum(void);
 int rbg_RB_TEST(VALUE v);
 int rbg_RB_NIL_P(VALUE v);
 
-/// Rbg_value - keep a VALUE safe so it does not get GC'ed
+/// Rbg_value - keep a VALUE safe so it does not get GC'ed.
+/// The VALUE changes if `GC.compact` moves the object.
 typedef struct  {
     VALUE value;
 } Rbg_value;
 
-Rbg_value * _Nonnull rbg_value_alloc(VALUE value);
-Rbg_value * _Nonnull rbg_value_dup(const Rbg_value * _Nonnull box);
-void                 rbg_value_free(Rbg_value * _Nonnull box);
+/// NULL for special constants, which need no protection.
+Rbg_value * _Nullable rbg_value_alloc(VALUE value);
+/// Share a box: returns `box` with its reference count bumped.
+Rbg_value * _Nonnull  rbg_value_dup(Rbg_value * _Nonnull box);
+void                  rbg_value_free(Rbg_value * _Nonnull box);
+/// Stop or let `GC.compact` move the boxed object.  Nest.
+void                  rbg_value_pin(Rbg_value * _Nonnull box);
+void                  rbg_value_unpin(Rbg_value * _Nonnull box);
+/// Remember a stable Ruby `hash` for the boxed object, shared by every user of the box.
+int                   rbg_value_get_hash(Rbg_value * _Nonnull box, long * _Nonnull hash);
+void                  rbg_value_set_hash(Rbg_value * _Nonnull box, long hash);
 
 /// Method calling
 
@@ -226,14 +394,17 @@ typedef struct {
 
 /// Swift callback that all methods go through
 typedef void (*Rbg_method_call)(VALUE,                  // symbol
-                                long,                   // targetCount
-                                const VALUE * _Nonnull, // targets
+                                VALUE,                  // class
                                 VALUE,                  // self
                                 int,                    // argc
                                 const VALUE * _Nonnull, // argv
                                 Rbg_return_value * _Nonnull);
 void rbg_register_method_callback(Rbg_method_call _Nonnull);
 
+/// Counter bumped whenever a module is included, prepended, or extended
+/// anywhere, invalidating any cached class -> callback resolutions.
+unsigned long rbg_method_ancestry_generation(void);
+
 /// Define a global function
 Rbg_method_id rbg_define_global_function(const char * _Nonnull name);
 /// Define a regular method on some class
@@ -244,20 +415,39 @@ Rbg_method_id rbg_define_singleton_method(VALUE object,
 
 /// Instance binding
 
-/// Callback into Swift code for instance alloc/free
-typedef void * _Nullable (*Rbg_bind_allocate_call)(const char * _Nonnull);
-typedef void (*Rbg_bind_free_call)(const char * _Nonnull, void * _Nonnull);
+/// Callback into Swift code for instance alloc/free, passing the class's binding
+typedef void * _Nullable (*Rbg_bind_allocate_call)(void * _Nonnull binding);
+typedef void (*Rbg_bind_free_call)(void * _Nonnull binding, void * _Nonnull instance);
 
 /// Set the single functions where all gvar calls go
 void rbg_register_object_binding_callbacks(
         Rbg_bind_allocate_call _Nonnull alloc,
         Rbg_bind_free_call _Nonnull free);
 
-/// Have Ruby associate Swift instances with this class.
-void rbg_bind_class(VALUE rubyClass);
+/// Have Ruby associate Swift instances with this class, created and
+/// freed by `binding`.  The class is never garbage-collected.
+void rbg_bind_class(VALUE rubyClass, void * _Nonnull binding);
+
+/// Get the binding for a bound class, or NULL if it is not bound.
+void * _Nullable rbg_bound_class_binding(VALUE rubyClass);
 
 /// Get hold of the Swift object for this instance of a bound class, or NULL
 /// if something is amiss.
 void * _Nullable rbg_get_bound_object(VALUE instance);
 
+/// External IO::Buffers
+
+/// Callback into Swift code when Ruby is done with an external buffer
+typedef void (*Rbg_buffer_release_call)(void * _Nonnull owner);
+
+/// Set the single function where all external buffer releases go
+void rbg_register_buffer_release_callback(Rbg_buffer_release_call _Nonnull release);
+
+/// Safely create an `IO::Buffer` for some memory without copying it.
+/// Ruby 3.1+, raises `NotImplementedError` for earlier versions.  Once this
+/// succeeds, `owner` is passed to the release callback when the buffer and
+/// all its slices are garbage-collected.
+VALUE rbg_io_buffer_new_protect(void * _Nullable base, long size, int readOnly,
+                                void * _Nonnull owner, int * _Nonnull status);
+
 #endif /* rbg_helpers_h */
@@ -23,6 +23,115 @@ const char *rbg_RSTRING_PTR(VALUE v)
     return RSTRING_PTR(v);
 }
 
+long rbg_RHASH_SIZE(VALUE v)
+{
+    return RHASH_SIZE(v);
+}
+
+const VALUE *rbg_RARRAY_CONST_PTR(VALUE v)
+{
+    return RARRAY_CONST_PTR(v);
+}
+
+int rbg_str_lock(VALUE v)
+{
+    if (OBJ_FROZEN(v))
+    {
+        return 0;
+    }
+    // Only fails if someone else has it locked, that's fine too.
+    int status = 0;
+    (void) rb_protect(rb_str_locktmp, v, &status);
+    if (status)
+    {
+        rb_set_errinfo(Qnil);
+        return 0;
+    }
+    return 1;
+}
+
+void rbg_str_unlock(VALUE v)
+{
+    rb_str_unlocktmp(v);
+}
+
+// # Hashing and equality
+//
+// Ruby's own Hash compares and hashes some core types directly instead of
+// calling their `==` and `hash` methods.  Do the same for `RbObject`'s
+// `Hashable` so that it does not have to call Ruby for the common keys.
+
+#if RUBY_API_VERSION_MAJOR >= 3
+#import <ruby/ractor.h>
+#define RBG_HAVE_RACTOR_SHAREABLE 1
+#endif
+
+/// Fixnums, symbols, `nil`, `true`, `false`, and plain `String`s
+static int rbg_is_simple_key(VALUE v)
+{
+    if (RB_SPECIAL_CONST_P(v))
+    {
+        return !RB_FLONUM_P(v) && v != Qundef;
+    }
+    return (RB_BUILTIN_TYPE(v) == T_STRING && RBASIC_CLASS(v) == rb_cString) ||
+           RB_BUILTIN_TYPE(v) == T_SYMBOL;
+}
+
+int rbg_fast_equal(VALUE lhs, VALUE rhs)
+{
+    // Floats because NaN != NaN
+    if (lhs == rhs && !RB_FLOAT_TYPE_P(lhs))
+    {
+        return 1;
+    }
+    if (!rbg_is_simple_key(lhs) || !rbg_is_simple_key(rhs))
+    {
+        return -1;
+    }
+    if (RB_TYPE_P(lhs, T_STRING) && RB_TYPE_P(rhs, T_STRING))
+    {
+        return rb_str_equal(lhs, rhs) == Qtrue;
+    }
+    // Different simple objects are equal only if both are strings
+    return 0;
+}
+
+int rbg_fast_hash(VALUE v, long * _Nonnull hash)
+{
+    if (!rbg_is_simple_key(v))
+    {
+        return 0;
+    }
+    if (RB_TYPE_P(v, T_STRING))
+    {
+        *hash = (long) rb_str_hash(v);
+    }
+    else if (RB_TYPE_P(v, T_SYMBOL) && !RB_STATIC_SYM_P(v))
+    {
+        // Dynamic symbol: can be moved by `GC.compact`
+        *hash = (long) rb_str_hash(rb_sym2str(v));
+    }
+    else
+    {
+        *hash = (long) v;
+    }
+    return 1;
+}
+
+// Plain `String`s never get here: `rbg_fast_hash` always handles them.
+int rbg_hash_is_stable(VALUE v)
+{
+    if (RB_SPECIAL_CONST_P(v) || !RB_OBJ_FROZEN(v))
+    {
+        return 0;
+    }
+#if RBG_HAVE_RACTOR_SHAREABLE
+    return rb_ractor_shareable_p(v);
+#else
+    return 0;
+#endif
+}
+
 // # Version constants
 // These are exported as char [] which don't get imported
 const char *rbg_ruby_version(void)
@@ -41,6 +150,28 @@ rb_unblock_function_t * _Nonnull rbg_RUBY_UBF_IO(void)
     return RUBY_UBF_IO;
 }
 
+// Atomic pointers - acquire/release is enough to publish a fully-built
+// immutable Swift object to lock-free readers.
+void *rbg_atomic_load_ptr(void **slot)
+{
+    return __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+}
+
+void rbg_atomic_store_ptr(void **slot, void *value)
+{
+    __atomic_store_n(slot, value, __ATOMIC_RELEASE);
+}
+
+int rbg_atomic_load_int(int *slot)
+{
+    return __atomic_load_n(slot, __ATOMIC_ACQUIRE);
+}
+
+void rbg_atomic_store_int(int *slot, int value)
+{
+    __atomic_store_n(slot, value, __ATOMIC_RELEASE);
+}
+
 // Ruby pre-3 and 3+
 
 // Ruby 3 adds actual C enums for ruby_value_type and ruby_special_constants.
@@ -50,6 +181,13 @@ int rbg_qfalse(void) { return RUBY_Qfalse; }
 int rbg_qtrue(void) { return RUBY_Qtrue; }
 int rbg_qnil(void)  { return RUBY_Qnil; }
 int rbg_qundef(void) { return RUBY_Qundef; }
+int rbg_use_flonum(void) {
+#if USE_FLONUM
+    return 1;
+#else
+    return 0;
+#endif
+}
 
 // These become inlines in Ruby 3 that get imported
 int rbg_RB_TEST(VALUE v) { return RB_TEST(v); }
@@ -10,6 +10,11 @@
 #import <stdbool.h>
 #import <stdint.h>
 
+#if RUBY_API_VERSION_MAJOR > 3 || (RUBY_API_VERSION_MAJOR == 3 && RUBY_API_VERSION_MINOR >= 1)
+#define RBG_HAVE_IO_BUFFER 1
+#import <ruby/io/buffer.h>
+#endif
+
 // Clang 13 doesn't like Ruby 2.X header files
 #if !defined(__has_warning) || __has_warning("-Wcompound-token-split-by-macro")
 #pragma clang diagnostic ignored "-Wcompound-token-split-by-macro"
@@ -72,24 +77,34 @@
 typedef enum {
     RBG_JOB_LOAD,
     RBG_JOB_INTERN,
+    RBG_JOB_INTERNED_STR,
     RBG_JOB_CONST_GET,
     RBG_JOB_CONST_GET_AT,
     RBG_JOB_CONST_SET,
     RBG_JOB_FUNCALLV,
     RBG_JOB_BLOCK_CALL_PVOID,
     RBG_JOB_BLOCK_CALL_VALUE,
+    RBG_JOB_BLOCK_CALL_BORROWED,
     RBG_JOB_CVAR_GET,
     RBG_JOB_TO_ULONG,
     RBG_JOB_TO_LONG,
     RBG_JOB_TO_DOUBLE,
+    RBG_JOB_ARY_TO_LONGS,
+    RBG_JOB_ARY_TO_DOUBLES,
+    RBG_JOB_ARY_STORE,
+    RBG_JOB_ARY_SPLICE,
+    RBG_JOB_BATCH,
+    RBG_JOB_HASH_FOREACH,
+    RBG_JOB_HASH_NEW,
     RBG_JOB_PROC_CALL,
     RBG_JOB_YIELD,
-    RBG_JOB_ERR_ARITY,
     RBG_JOB_SCAN_ARG_HASH,
     RBG_JOB_DEFINE_CLASS,
     RBG_JOB_DEFINE_MODULE,
     RBG_JOB_INJECT_MODULE,
     RBG_JOB_CALL_SUPER,
+    RBG_JOB_IO_BUFFER_NEW,
+    RBG_JOB_CHECK_INTS,
 } Rbg_job;
 
 typedef struct {
@@ -100,6 +115,7 @@ typedef struct {
 
     bool          loadWrap;
     const char   *name;
+    long          nameLength;
     int           argc;
     const VALUE  *argv;
     int           kwArgs;
@@ -107,9 +123,6 @@ typedef struct {
     void         *blockContext;
     VALUE         blockArg;
 
-    int           arityMin;
-    int           arityMax;
-
     int          *argIsHash;
     int          *argIsOpts;
 
@@ -117,20 +130,41 @@ typedef struct {
     VALUE         module;
     VALUE         constant;
     Rbg_inject_type injectType;
+
+    void         *bulkData;
+    long          bulkCount;
+    long         *bulkCompleted;
+    long          aryStart;
+    long          aryLength;
+
+    Rbg_hash_foreach_call hashCall;
+
+    bool          readOnly;
+    void         *owner;
 } Rbg_protect_data;
 
 #define RBG_PDATA_TO_VALUE(pdata) ((uintptr_t)(void *)(pdata))
 #define RBG_VALUE_TO_PDATA(value) ((Rbg_protect_data *)(void *)(uintptr_t)(value))
 
 static VALUE rbg_obj2ulong(VALUE v);
+static void rbg_ary_to_longs(VALUE ary, long *out, long count);
+static void rbg_ary_to_doubles(VALUE ary, double *out, long count);
+static void rbg_ary_splice(VALUE ary, long start, long length,
+                           const VALUE *values, long count);
+static void rbg_batch_run(Rbg_batch_op *ops, long count, VALUE keep, long *completed);
+static int rbg_hash_foreach_callback(VALUE key, VALUE value, VALUE arg);
+static VALUE rbg_hash_new_from_pairs(const VALUE *pairs, long count);
 
 static VALUE rbg_block_pvoid_callback(VALUE yieldedArg, VALUE callbackArg,
                                       int argc, const VALUE *argv, VALUE blockArg);
 static VALUE rbg_block_value_callback(VALUE yieldedArg, VALUE callbackArg,
                                       int argc, const VALUE *argv, VALUE blockArg);
+static VALUE rbg_block_borrowed_callback(VALUE yieldedArg, VALUE callbackArg,
+                                         int argc, const VALUE *argv, VALUE blockArg);
 static VALUE rbg_scan_arg_hash(VALUE last_arg,
                                int * _Nonnull is_hash,
                                int * _Nonnull is_opts);
+static VALUE rbg_io_buffer_new(void *base, size_t size, bool readOnly, void *owner);
 
 // Ruby 3 _kw wrappers
 
@@ -169,6 +203,13 @@ int rb_keyword_given_p(void)
     return 0;
 }
 
+static void rb_hash_bulk_insert(long argc, const VALUE *argv, VALUE hash)
+{
+    for (long i = 0; i < argc; i += 2) {
+        rb_hash_aset(hash, argv[i], argv[i + 1]);
+    }
+}
+
 #else
  #if RUBY_API_VERSION_MAJOR > 2
 RBIMPL_STATIC_ASSERT(rbg_r2_compat1, RB_NO_KEYWORDS == 0);
@@ -176,6 +217,24 @@ RBIMPL_STATIC_ASSERT(rbg_r2_compat2, RB_PASS_KEYWORDS == 1);
  #endif
 #endif
 
+// Ruby 3.2 sized hash
+
+#if RUBY_API_VERSION_MAJOR < 3 || (RUBY_API_VERSION_MAJOR == 3 && RUBY_API_VERSION_MINOR < 2)
+static VALUE rb_hash_new_capa(long capa)
+{
+    return rb_hash_new();
+}
+#endif
+
+// Ruby 3.0 interned strings
+
+#if RUBY_API_VERSION_MAJOR < 3
+static VALUE rb_str_to_interned_str(VALUE str)
+{
+    return rb_funcall(str, rb_intern("-@"), 0);
+}
+#endif
+
 /// Callback made by Ruby from `rb_protect` -- OK to raise exceptions from here.
 static VALUE rbg_protect_thunk(VALUE value)
 {
@@ -190,6 +249,9 @@ static VALUE rbg_protect_thunk(VALUE value)
     case RBG_JOB_INTERN:
         rc = (VALUE) rb_intern(d->name);
         break;
+    case RBG_JOB_INTERNED_STR:
+        rc = rb_str_to_interned_str(rb_utf8_str_new(d->name, d->nameLength));
+        break;
     case RBG_JOB_CONST_GET:
         rc = rb_const_get(d->value, d->id);
         break;
@@ -212,6 +274,11 @@ static VALUE rbg_protect_thunk(VALUE value)
                               rbg_block_value_callback, (VALUE) d->blockContext,
                               d->kwArgs);
         break;
+    case RBG_JOB_BLOCK_CALL_BORROWED:
+        rc = rb_block_call_kw(d->value, d->id, d->argc, d->argv,
+                              rbg_block_borrowed_callback, (VALUE) d->blockContext,
+                              d->kwArgs);
+        break;
     case RBG_JOB_CVAR_GET:
         rc = rb_cvar_get(d->value, d->id);
         break;
@@ -224,15 +291,33 @@ static VALUE rbg_protect_thunk(VALUE value)
     case RBG_JOB_TO_DOUBLE:
         d->toDoubleResult = NUM2DBL(rb_Float(d->value));
         break;
+    case RBG_JOB_ARY_TO_LONGS:
+        rbg_ary_to_longs(d->value, d->bulkData, d->bulkCount);
+        break;
+    case RBG_JOB_ARY_TO_DOUBLES:
+        rbg_ary_to_doubles(d->value, d->bulkData, d->bulkCount);
+        break;
+    case RBG_JOB_ARY_STORE:
+        rb_ary_store(d->value, d->aryStart, d->constant);
+        break;
+    case RBG_JOB_ARY_SPLICE:
+        rbg_ary_splice(d->value, d->aryStart, d->aryLength, d->bulkData, d->bulkCount);
+        break;
+    case RBG_JOB_BATCH:
+        rbg_batch_run(d->bulkData, d->bulkCount, d->value, d->bulkCompleted);
+        break;
+    case RBG_JOB_HASH_FOREACH:
+        rb_hash_foreach(d->value, rbg_hash_foreach_callback, RBG_PDATA_TO_VALUE(d));
+        break;
+    case RBG_JOB_HASH_NEW:
+        rc = rbg_hash_new_from_pairs(d->argv, d->bulkCount);
+        break;
     case RBG_JOB_PROC_CALL:
         rc = rb_proc_call_with_block_kw(d->value, d->argc, d->argv, d->blockArg, d->kwArgs);
         break;
     case RBG_JOB_YIELD:
         rc = rb_yield_values_kw(d->argc, d->argv, d->kwArgs);
         break;
-    case RBG_JOB_ERR_ARITY:
-        rb_error_arity(d->argc, d->arityMin, d->arityMax);
-        /* break; */
     case RBG_JOB_SCAN_ARG_HASH:
         rc = rbg_scan_arg_hash(d->value, d->argIsHash, d->argIsOpts);
         break;
@@ -267,6 +352,12 @@ static VALUE rbg_protect_thunk(VALUE value)
     case RBG_JOB_CALL_SUPER:
         rc = rb_call_super_kw(d->argc, d->argv, d->kwArgs);
         break;
+    case RBG_JOB_IO_BUFFER_NEW:
+        rc = rbg_io_buffer_new(d->bulkData, d->bulkCount, d->readOnly, d->owner);
+        break;
+    case RBG_JOB_CHECK_INTS:
+        rb_thread_check_ints();
+        break;
     }
     return rc;
 }
@@ -292,6 +383,13 @@ ID rbg_intern_protect(const char * _Nonnull name, int * _Nonnull status)
     return (ID) rbg_protect(&data, status);
 }
 
+// Frozen, deduplicated UTF-8 string via the fstring table
+VALUE rbg_interned_str_protect(const char * _Nonnull ptr, long len, int * _Nonnull status)
+{
+    Rbg_protect_data data = { .job = RBG_JOB_INTERNED_STR, .name = ptr, .nameLength = len };
+    return rbg_protect(&data, status);
+}
+
 // rb_const_get - raises if not found
 VALUE rbg_const_get_protect(VALUE value, ID id, int * _Nonnull status)
 {
@@ -364,6 +462,18 @@ VALUE rbg_block_call_value_protect(VALUE value, ID id,
     return rbg_protect(&data, status);
 }
 
+// rb_block_call - run two lots of arbitrary code
+VALUE rbg_block_call_borrowed_protect(VALUE value, ID id,
+                                      int argc, const VALUE * _Nonnull argv, int kwArgs,
+                                      void * _Nonnull context,
+                                      int * _Nonnull status)
+{
+    Rbg_protect_data data = { .job = RBG_JOB_BLOCK_CALL_BORROWED, .value = value, .id = id,
+                              .argc = argc, .argv = argv, .kwArgs = kwArgs,
+                              .blockContext = context };
+    return rbg_protect(&data, status);
+}
+
 // rb_cvar_get - raises if you look at it funny
 VALUE rbg_cvar_get_protect(VALUE clazz, ID id, int * _Nonnull status)
 {
@@ -466,6 +576,213 @@ VALUE rbg_Array_protect(VALUE v, int * _Nonnull status)
     return rb_protect(rb_Array, v, status);
 }
 
+//
+// Bulk array conversion.
+//
+// Converting element-by-element costs a protect and an `RbObject` for each
+// element.  For arrays of simple types we do the whole thing here instead,
+// decoding immediates directly and falling back to the regular conversion
+// for anything else.  The fallback can run Ruby code that changes the array
+// so we re-read its contents after each one; elements that have vanished
+// read as `nil`, same as `rb_ary_entry`.
+//
+
+static void rbg_ary_to_longs(VALUE ary, long *out, long count)
+{
+    const VALUE *ptr = RARRAY_CONST_PTR(ary);
+    long len = RARRAY_LEN(ary);
+
+    for (long i = 0; i < count; i++)
+    {
+        VALUE v = (i < len) ? ptr[i] : Qnil;
+        if (RB_FIXNUM_P(v))
+        {
+            out[i] = FIX2LONG(v);
+            continue;
+        }
+        out[i] = RB_NUM2LONG(rb_Integer(v));
+        ptr = RARRAY_CONST_PTR(ary);
+        len = RARRAY_LEN(ary);
+    }
+}
+
+static void rbg_ary_to_doubles(VALUE ary, double *out, long count)
+{
+    const VALUE *ptr = RARRAY_CONST_PTR(ary);
+    long len = RARRAY_LEN(ary);
+
+    for (long i = 0; i < count; i++)
+    {
+        VALUE v = (i < len) ? ptr[i] : Qnil;
+        if (RB_FLOAT_TYPE_P(v))
+        {
+            out[i] = RFLOAT_VALUE(v);
+            continue;
+        }
+        if (RB_FIXNUM_P(v))
+        {
+            out[i] = (double) FIX2LONG(v);
+            continue;
+        }
+        out[i] = NUM2DBL(rb_Float(v));
+        ptr = RARRAY_CONST_PTR(ary);
+        len = RARRAY_LEN(ary);
+    }
+}
+
+/// rb_Integer on each element - raises if any conversion goes wrong
+void rbg_ary_to_longs_protect(VALUE ary, long * _Nonnull out, long count,
+                              int * _Nonnull status)
+{
+    Rbg_protect_data data = { .job = RBG_JOB_ARY_TO_LONGS, .value = ary,
+                              .bulkData = out, .bulkCount = count };
+    (void) rbg_protect(&data, status);
+}
+
+/// rb_Float on each element - raises if any conversion goes wrong
+void rbg_ary_to_doubles_protect(VALUE ary, double * _Nonnull out, long count,
+                                int * _Nonnull status)
+{
+    Rbg_protect_data data = { .job = RBG_JOB_ARY_TO_DOUBLES, .value = ary,
+                              .bulkData = out, .bulkCount = count };
+    (void) rbg_protect(&data, status);
+}
+
+/// rb_ary_store - raises if frozen or index too negative
+void rbg_ary_store_protect(VALUE ary, long index, VALUE value,
+                           int * _Nonnull status)
+{
+    Rbg_protect_data data = { .job = RBG_JOB_ARY_STORE, .value = ary,
+                              .aryStart = index, .constant = value };
+    (void) rbg_protect(&data, status);
+}
+
+/// Appending is the common case, go direct.  Otherwise `ary[start, length] = values`
+/// without making a Range.
+static void rbg_ary_splice(VALUE ary, long start, long length,
+                           const VALUE *values, long count)
+{
+    if (length == 0 && start == RARRAY_LEN(ary)) {
+        if (count > 0) {
+            rb_ary_cat(ary, values, count);
+        }
+        else {
+            rb_check_frozen(ary);
+        }
+        return;
+    }
+    VALUE args[3] = { LONG2NUM(start), LONG2NUM(length), rb_ary_new_from_values(count, values) };
+    (void) rb_funcallv(ary, rb_intern("[]="), 3, args);
+}
+
+/// Replace part of an array - raises if frozen etc.
+void rbg_ary_splice_protect(VALUE ary, long start, long length,
+                            const VALUE * _Nullable values, long count,
+                            int * _Nonnull status)
+{
+    Rbg_protect_data data = { .job = RBG_JOB_ARY_SPLICE, .value = ary,
+                              .aryStart = start, .aryLength = length,
+                              .bulkData = (void *) values, .bulkCount = count };
+    (void) rbg_protect(&data, status);
+}
+
+/// Truthiness of each element - can't fail
+void rbg_ary_to_bools(VALUE ary, _Bool * _Nonnull out, long count)
+{
+    const VALUE *ptr = RARRAY_CONST_PTR(ary);
+    long len = RARRAY_LEN(ary);
+
+    for (long i = 0; i < count; i++)
+    {
+        out[i] = (i < len) && RTEST(ptr[i]);
+    }
+}
+
+// Building arrays goes via a small buffer on the stack, where the GC can see
+// any new objects before they are in the array.
+#define RBG_ARY_CHUNK 256
+
+#define RBG_ARY_NEW_FROM(values, count, convert)                \
+    VALUE ary = rb_ary_new_capa(count);                         \
+    VALUE chunk[RBG_ARY_CHUNK];                                 \
+    for (long i = 0; i < count; i += RBG_ARY_CHUNK)             \
+    {                                                           \
+        long n = count - i;                                     \
+        if (n > RBG_ARY_CHUNK) n = RBG_ARY_CHUNK;               \
+        for (long j = 0; j < n; j++)                            \
+        {                                                       \
+            chunk[j] = convert(values[i + j]);                  \
+        }                                                       \
+        rb_ary_cat(ary, chunk, n);                              \
+    }                                                           \
+    return ary
+
+#define RBG_BOOL2VALUE(b) ((b) ? Qtrue : Qfalse)
+
+VALUE rbg_ary_new_from_longs(const long * _Nullable values, long count)
+{
+    RBG_ARY_NEW_FROM(values, count, RB_LONG2NUM);
+}
+
+VALUE rbg_ary_new_from_doubles(const double * _Nullable values, long count)
+{
+    RBG_ARY_NEW_FROM(values, count, DBL2NUM);
+}
+
+VALUE rbg_ary_new_from_bools(const _Bool * _Nullable values, long count)
+{
+    RBG_ARY_NEW_FROM(values, count, RBG_BOOL2VALUE);
+}
+
+//
+// Batches.
+//
+// Run a list of jobs under a single `rb_protect`, stopping at the first
+// exception.  Results go into the `keep` array as well as the op so that
+// the GC can see them until the caller has finished with the batch.
+//
+
+static void rbg_batch_run(Rbg_batch_op *ops, long count, VALUE keep, long *completed)
+{
+    for (long i = 0; i < count; i++)
+    {
+        Rbg_batch_op *op = &ops[i];
+        VALUE rc = Qnil;
+
+        switch (op->job)
+        {
+        case RBG_BATCH_FUNCALLV:
+            rc = rb_funcallv_kw(op->value, op->id, op->argc, op->argv, op->kwArgs);
+            break;
+        case RBG_BATCH_INSPECT:
+            rc = rb_inspect(op->value);
+            break;
+        case RBG_BATCH_STRING:
+            rc = rb_String(op->value);
+            break;
+        case RBG_BATCH_TO_LONG:
+            op->longResult = RB_NUM2LONG(rb_Integer(op->value));
+            break;
+        case RBG_BATCH_TO_DOUBLE:
+            op->doubleResult = NUM2DBL(rb_Float(op->value));
+            break;
+        }
+        op->valueResult = rc;
+        rb_ary_push(keep, rc);
+        *completed = i + 1;
+    }
+}
+
+void rbg_protect_batch(Rbg_batch_op * _Nonnull ops, long count, VALUE keep,
+                       long * _Nonnull completed, int * _Nonnull status)
+{
+    *completed = 0;
+    Rbg_protect_data data = { .job = RBG_JOB_BATCH, .value = keep,
+                              .bulkData = ops, .bulkCount = count,
+                              .bulkCompleted = completed };
+    (void) rbg_protect(&data, status);
+}
+
 //
 // Hash conversion.
 //
@@ -513,14 +830,42 @@ VALUE rbg_Hash_protect(VALUE v, int * _Nonnull status)
     return rb_protect(rbg_Hash, v, status);
 }
 
-/// rb_error_arity - always raises an exception
-void rbg_error_arity_protect(int argc, int min, int max, int * _Nonnull status)
+/// rb_hash_foreach - the callback must not raise, it can stop the iteration
+/// by returning nonzero.  Raises if the callback modifies the hash.
+static int rbg_hash_foreach_callback(VALUE key, VALUE value, VALUE arg)
 {
-    Rbg_protect_data data = { .job = RBG_JOB_ERR_ARITY,
-        .argc = argc, .arityMin = min, .arityMax = max };
+    Rbg_protect_data *d = RBG_VALUE_TO_PDATA(arg);
+    return d->hashCall(key, value, d->blockContext) ? ST_STOP : ST_CONTINUE;
+}
+
+void rbg_hash_foreach_protect(VALUE hash,
+                              Rbg_hash_foreach_call _Nonnull call,
+                              void * _Nullable context,
+                              int * _Nonnull status)
+{
+    Rbg_protect_data data = { .job = RBG_JOB_HASH_FOREACH, .value = hash,
+        .hashCall = call, .blockContext = context };
     (void) rbg_protect(&data, status);
 }
 
+/// rb_hash_bulk_insert - runs `hash` and `eql?` on keys
+static VALUE rbg_hash_new_from_pairs(const VALUE *pairs, long count)
+{
+    VALUE hash = rb_hash_new_capa(count);
+    if (count > 0) {
+        rb_hash_bulk_insert(count * 2, pairs, hash);
+    }
+    return hash;
+}
+
+VALUE rbg_hash_new_from_pairs_protect(const VALUE * _Nullable pairs, long count,
+                                      int * _Nonnull status)
+{
+    Rbg_protect_data data = { .job = RBG_JOB_HASH_NEW,
+        .argv = pairs, .bulkCount = count };
+    return rbg_protect(&data, status);
+}
+
 /// rb_scan_args / rb_extract_keywords
 ///
 /// If user asks for a kw hash and there is a non-nil arg that could
@@ -591,6 +936,10 @@ VALUE rbg_define_module_protect(const char * _Nonnull name,
     return rbg_protect(&data, status);
 }
 
+/// Bumped when some class's ancestors may have changed.  See
+/// `rbg_method_ancestry_hook` for the Ruby-side equivalent.
+static unsigned long rbg_method_generation;
+
 void rbg_inject_module_protect(VALUE into, VALUE module,
                                Rbg_inject_type type,
                                int * _Nonnull status)
@@ -598,6 +947,7 @@ void rbg_inject_module_protect(VALUE into, VALUE module,
     Rbg_protect_data data = { .job = RBG_JOB_INJECT_MODULE,
         .value = into, .module = module, .injectType = type };
     (void) rbg_protect(&data, status);
+    rbg_method_generation++;
 }
 
 VALUE rbg_call_super_protect(int argc, const VALUE * _Nonnull argv, int kwArgs,
@@ -608,6 +958,44 @@ VALUE rbg_call_super_protect(int argc, const VALUE * _Nonnull argv, int kwArgs,
     return rbg_protect(&data, status);
 }
 
+//
+// Running without the GVL
+//
+// `rb_thread_call_without_gvl` acts on interrupts such as `Thread#kill`
+// when it gets the GVL back -- that longjmps through the Swift frames that
+// called it.  Instead use the '2' version that leaves them pending and
+// deal with them once Swift has unwound.
+//
+
+typedef struct {
+    void * _Nullable (* _Nonnull func)(void * _Nullable);
+    void * _Nullable data;
+    int               ran;
+} Rbg_nogvl_call;
+
+static void *rbg_nogvl_trampoline(void *data)
+{
+    Rbg_nogvl_call *call = data;
+    call->ran = 1;
+    return call->func(call->data);
+}
+
+int rbg_call_without_gvl(void * _Nullable (* _Nonnull func)(void * _Nullable),
+                         void * _Nullable data,
+                         rbg_unblock_function_t * _Nullable ubf,
+                         void * _Nullable ubfData)
+{
+    Rbg_nogvl_call call = { .func = func, .data = data, .ran = 0 };
+    (void) rb_thread_call_without_gvl2(rbg_nogvl_trampoline, &call, ubf, ubfData);
+    return call.ran;
+}
+
+void rbg_thread_check_ints_protect(int * _Nonnull status)
+{
+    Rbg_protect_data data = { .job = RBG_JOB_CHECK_INTS };
+    (void) rbg_protect(&data, status);
+}
+
 //
 // Procs/blocks written in Swift
 //
@@ -631,6 +1019,9 @@ static Rbg_pvoid_block_call rbg_pvoid_block_call;
 /// This is `rbproc_value_block_callback` in RbBlockCall.swift.
 static Rbg_value_block_call rbg_value_block_call;
 
+/// This is `rbproc_borrowed_block_callback` in RbBlockCall.swift.
+static Rbg_pvoid_block_call rbg_borrowed_block_call;
+
 void rbg_register_pvoid_block_proc_callback(Rbg_pvoid_block_call callback)
 {
     rbg_pvoid_block_call = callback;
@@ -641,6 +1032,11 @@ void rbg_register_value_block_proc_callback(Rbg_value_block_call callback)
     rbg_value_block_call = callback;
 }
 
+void rbg_register_borrowed_block_proc_callback(Rbg_pvoid_block_call callback)
+{
+    rbg_borrowed_block_call = callback;
+}
+
 /// All block/proc callbacks come into these functions from Ruby core.
 ///
 /// We get in the way to let the Swift implementation do its thing and
@@ -677,6 +1073,61 @@ static VALUE rbg_block_value_callback(VALUE yieldedArg,
     return rbg_handle_return_value(&return_value);
 }
 
+static VALUE rbg_block_borrowed_callback(VALUE yieldedArg,
+                                         VALUE callbackArg,
+                                         int argc,
+                                         const VALUE *argv,
+                                         VALUE blockArg)
+{
+    Rbg_return_value return_value = { 0 };
+
+    rbg_borrowed_block_call((void *) callbackArg, argc, argv, blockArg, &return_value);
+
+    return rbg_handle_return_value(&return_value);
+}
+
+void rbg_return_value_set_new_exception(Rbg_return_value * _Nonnull rv,
+                                        VALUE exceptionClass,
+                                        const char * _Nonnull message,
+                                        long messageLength)
+{
+    rv->type = RBG_RT_RAISE_NEW;
+    rv->value = exceptionClass;
+    rv->message = malloc(messageLength + 1);
+    if (rv->message != NULL)
+    {
+        memcpy(rv->message, message, messageLength);
+    }
+    rv->messageLength = messageLength;
+}
+
+/// Copy a `RBG_RT_RAISE_NEW` message into a Ruby string
+static VALUE rbg_new_exception_message(VALUE value)
+{
+    Rbg_return_value *rv = (Rbg_return_value *)value;
+    return rb_str_new(rv->message, rv->messageLength);
+}
+
+/// Create the exception for `RBG_RT_RAISE_NEW`, freeing the message whatever happens
+static VALUE rbg_new_exception(Rbg_return_value * _Nonnull rv)
+{
+    VALUE message;
+    int status = 0;
+
+    if (rv->message == NULL)
+    {
+        rb_memerror();    /* does not return */
+    }
+    message = rb_protect(rbg_new_exception_message, (VALUE)rv, &status);
+    free(rv->message);
+    rv->message = NULL;
+    if (status != 0)
+    {
+        rb_jump_tag(status);    /* does not return */
+    }
+    return rb_exc_new_str(rv->value, message);
+}
+
 static VALUE rbg_handle_return_value(Rbg_return_value * _Nonnull rv)
 {
     switch (rv->type)
@@ -689,6 +1140,8 @@ static VALUE rbg_handle_return_value(Rbg_return_value * _Nonnull rv)
         rb_iter_break_value(rv->value);   /* does not return */
     case RBG_RT_RAISE:
         rb_exc_raise(rv->value);    /* does not return */
+    case RBG_RT_RAISE_NEW:
+        rb_exc_raise(rbg_new_exception(rv));    /* does not return */
     case RBG_RT_JUMP:
         rb_jump_tag((int)rv->value);    /* does not return */
     default:
@@ -701,9 +1154,9 @@ static VALUE rbg_handle_return_value(Rbg_return_value * _Nonnull rv)
 //
 
 //
-// We support only the 'virtual' kind which are the most generic.
-// Callback thunking means we funnel all calls through a single
-// Swift entrypoint, using the variable name to distinguish them.
+// We present the 'hooked' kind to Ruby so that it passes our `Rbg_gvar`
+// back to the getter and setter, saving a lookup by name, and marks its
+// cached value.  Behaviour is like the 'virtual' kind, the most generic.
 //
 
 ///  This is `rbobject_gvar_get_callback` in RbGlobalVar.swift.
@@ -727,7 +1180,12 @@ void rbg_register_gvar_callbacks(Rbg_gvar_get_call get,
 // Callback from Ruby to implement getter for virtual RbObjects
 static VALUE rbg_gvar_virtual_getter(ID id, VALUE *data)
 {
-    return rbg_gvar_get_call(id);
+    Rbg_gvar *gvar = (Rbg_gvar *) data;
+    if (gvar->cached)
+    {
+        return gvar->value;
+    }
+    return rbg_gvar_get_call(gvar->context);
 }
 
 // Callback from Ruby to implement setter for virtual RbObjects
@@ -735,17 +1193,39 @@ static void rbg_gvar_virtual_setter(VALUE newValue,
                                     ID id,
                                     VALUE *data)
 {
+    Rbg_gvar *gvar = (Rbg_gvar *) data;
     Rbg_return_value rv = { 0 };
-    rbg_gvar_set_call(id, newValue, &rv);
+    rbg_gvar_set_call(gvar->context, newValue, &rv);
     (void) rbg_handle_return_value(&rv);
 }
 
-ID rbg_create_virtual_gvar(const char * _Nonnull name, int readonly)
+Rbg_gvar * _Nonnull rbg_create_virtual_gvar(const char * _Nonnull name,
+                                            int readonly,
+                                            int cached,
+                                            VALUE cachedValue,
+                                            void * _Nonnull context)
 {
-    rb_define_virtual_variable(name,
-                               rbg_gvar_virtual_getter,
-                               readonly ? NULL : rbg_gvar_virtual_setter);
-    return rb_intern(name);
+    Rbg_gvar *gvar = malloc(sizeof(*gvar));
+    gvar->value = cached ? cachedValue : Qnil;
+    gvar->cached = cached;
+    gvar->context = context;
+    // Unlike the virtual kind, hooked with no setter means writable
+    if (readonly)
+    {
+        rb_define_hooked_variable(name, &gvar->value,
+                                  rbg_gvar_virtual_getter, rb_gvar_readonly_setter);
+    }
+    else
+    {
+        rb_define_hooked_variable(name, &gvar->value,
+                                  rbg_gvar_virtual_getter, rbg_gvar_virtual_setter);
+    }
+    return gvar;
+}
+
+void rbg_gvar_free(Rbg_gvar * _Nonnull gvar)
+{
+    free(gvar);
 }
 
 //
@@ -755,26 +1235,40 @@ ID rbg_create_virtual_gvar(const char * _Nonnull name, int readonly)
 /// This is `rbmethod_callback` in RbMethod.swift.
 static Rbg_method_call rbg_method_call;
 
-static ID rbg_method_method_id;
-static ID rbg_method_ancestors_id;
+/// Override of `Module#append_features` etc. to spot ancestry changes.
+/// Anything that really adds a module has to call through to the original.
+static VALUE rbg_method_ancestry_hook(int argc, VALUE *argv, VALUE self)
+{
+    rbg_method_generation++;
+    VALUE rc = rb_call_super(argc, argv);
+    rbg_method_generation++;
+    return rc;
+}
 
 void rbg_register_method_callback(Rbg_method_call call)
 {
     rbg_method_call = call;
-    rbg_method_method_id = rb_intern("__method__");
-    rbg_method_ancestors_id = rb_intern("ancestors");
+
+    VALUE hooks = rb_module_new();
+    rb_define_private_method(hooks, "append_features", rbg_method_ancestry_hook, -1);
+    rb_define_private_method(hooks, "prepend_features", rbg_method_ancestry_hook, -1);
+    rb_define_private_method(hooks, "extend_object", rbg_method_ancestry_hook, -1);
+    rb_prepend_module(rb_cModule, hooks);
+}
+
+unsigned long rbg_method_ancestry_generation(void)
+{
+    return rbg_method_generation;
 }
 
 /// Common method callback handler
 static VALUE rbg_method_do_callback(VALUE clazz, VALUE self, int argc, VALUE *argv)
 {
-    VALUE methodSym = rb_funcall(rb_mKernel, rbg_method_method_id, 0);
-    VALUE ancestors = rb_funcall(clazz, rbg_method_ancestors_id, 0);
+    VALUE methodSym = ID2SYM(rb_frame_this_func());
 
     Rbg_return_value rv = { 0 };
     rbg_method_call(methodSym,
-                    RARRAY_LEN(ancestors),
-                    RARRAY_CONST_PTR(ancestors),
+                    clazz,
                     self,
                     argc,
                     argv,
@@ -797,7 +1291,10 @@ static VALUE rbg_method_singleton_callback(int argc, VALUE *argv, VALUE self)
     return rbg_method_do_callback(clazz, self, argc, argv);
 }
 
-/// Helper to return callback token to Swift
+/// Helper to return callback token to Swift.
+///
+/// Swift finds the callback by the target's VALUE so keeps the target
+/// alive and pinned for as long as it holds the callback.
 static Rbg_method_id rbg_method_id_create(const char * _Nonnull name, VALUE target)
 {
     Rbg_method_id mid = { .method = rb_id2sym(rb_intern(name)), .target = target };
@@ -855,17 +1352,36 @@ static rb_data_type_t rbg_bound_data_type = {
 
 // We indirect so we know what is going on at `free` time....
 typedef struct {
-    char *rubyClassName;
+    void *binding;
     void *swiftObject;
 } Rbg_bound_data;
 
-static VALUE rbg_bound_alloc_instance(VALUE rubyClass)
+// Bound class VALUE -> Swift binding.  Bound classes are kept alive
+// forever so their VALUEs are never reused.
+static st_table *rbg_bound_classes;
+
+void *rbg_bound_class_binding(VALUE rubyClass)
 {
-    Rbg_bound_data *bdata = malloc(sizeof(*bdata));
-    bdata->rubyClassName = strdup(rb_class2name(rubyClass));
-    bdata->swiftObject = rbg_bind_allocate_call(bdata->rubyClassName);
+    st_data_t binding;
+    if (rbg_bound_classes != NULL &&
+        st_lookup(rbg_bound_classes, (st_data_t) rubyClass, &binding))
+    {
+        return (void *) binding;
+    }
+    return NULL;
+}
 
-    return TypedData_Wrap_Struct(rubyClass, &rbg_bound_data_type, bdata);
+static VALUE rbg_bound_alloc_instance(VALUE rubyClass)
+{
+    Rbg_bound_data *bdata;
+    VALUE instance = TypedData_Make_Struct(rubyClass, Rbg_bound_data,
+                                           &rbg_bound_data_type, bdata);
+    bdata->binding = rbg_bound_class_binding(rubyClass);
+    if (bdata->binding != NULL)
+    {
+        bdata->swiftObject = rbg_bind_allocate_call(bdata->binding);
+    }
+    return instance;
 }
 
 static void rbg_bound_free_data(void *handle)
@@ -873,10 +1389,9 @@ static void rbg_bound_free_data(void *handle)
     Rbg_bound_data *bdata = handle;
     if ( bdata->swiftObject != NULL )
     {
-        rbg_bind_free_call(bdata->rubyClassName, bdata->swiftObject);
+        rbg_bind_free_call(bdata->binding, bdata->swiftObject);
     }
-    free(bdata->rubyClassName);
-    free(bdata);
+    ruby_xfree(bdata);
 }
 
 void *rbg_get_bound_object(VALUE instance)
@@ -890,7 +1405,82 @@ void *rbg_get_bound_object(VALUE instance)
     return bdata->swiftObject;
 }
 
-void rbg_bind_class(VALUE rubyClass)
+void rbg_bind_class(VALUE rubyClass, void * _Nonnull binding)
 {
+    if (rbg_bound_classes == NULL)
+    {
+        rbg_bound_classes = st_init_numtable();
+    }
+    rb_gc_register_mark_object(rubyClass);
+    st_insert(rbg_bound_classes, (st_data_t) rubyClass, (st_data_t) binding);
     rb_define_alloc_func(rubyClass, rbg_bound_alloc_instance);
 }
+
+//
+// External IO::Buffers
+//
+
+// To `rbbuffer_release` in RbIOBuffer.swift
+static Rbg_buffer_release_call rbg_buffer_release_call;
+
+void rbg_register_buffer_release_callback(Rbg_buffer_release_call _Nonnull releasefn)
+{
+    rbg_buffer_release_call = releasefn;
+}
+
+#if RBG_HAVE_IO_BUFFER
+static void rbg_buffer_owner_free(void *owner)
+{
+    if (owner != NULL)
+    {
+        rbg_buffer_release_call(owner);
+    }
+}
+
+// Hidden object keeping the Swift owner of an external buffer's memory alive.
+// Slices of the buffer refer back to it so they keep it alive too.
+static const rb_data_type_t rbg_buffer_owner_type = {
+    .wrap_struct_name = "RubyGateway::BufferOwner",
+    .function = {
+        .dmark = NULL,
+        .dfree = rbg_buffer_owner_free,
+        .dsize = NULL,
+    },
+    .data = NULL,
+    .flags = 0
+};
+
+static VALUE rbg_io_buffer_new(void *base, size_t size, bool readOnly, void *owner)
+{
+    VALUE ownerObj = TypedData_Wrap_Struct(0, &rbg_buffer_owner_type, NULL);
+    // Locked so Ruby can't `free` or `transfer` the memory away from the owner
+    int flags = RB_IO_BUFFER_EXTERNAL | RB_IO_BUFFER_LOCKED;
+    if (readOnly)
+    {
+        flags |= RB_IO_BUFFER_READONLY;
+    }
+    VALUE buffer = rb_io_buffer_new(base, size, flags);
+    rb_ivar_set(buffer, rb_intern("__rubygateway_owner"), ownerObj);
+    // Nothing raises from here so the owner is now Ruby's to release
+    DATA_PTR(ownerObj) = owner;
+    return buffer;
+}
+#else
+static VALUE rbg_io_buffer_new(void *base, size_t size, bool readOnly, void *owner)
+{
+    rb_raise(rb_eNotImpError, "IO::Buffer needs Ruby 3.1 or later");
+}
+#endif
+
+VALUE rbg_io_buffer_new_protect(void * _Nullable base, long size, int readOnly,
+                                void * _Nonnull owner, int * _Nonnull status)
+{
+    Rbg_protect_data data = {
+        .job = RBG_JOB_IO_BUFFER_NEW,
+        .bulkData = base,
+        .bulkCount = size,
+        .readOnly = readOnly != 0,
+        .owner = owner
+    };
+    return rbg_protect(&data, status);
+}
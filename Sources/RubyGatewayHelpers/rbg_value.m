@@ -14,54 +14,399 @@
 #define RB_SPECIAL_CONST_P SPECIAL_CONST_P
 #endif
 
+// Fixups for Ruby < 2.7: no compaction, nothing moves
+
+#if RUBY_API_VERSION_MAJOR > 2 || (RUBY_API_VERSION_MAJOR == 2 && RUBY_API_VERSION_MINOR >= 7)
+#define RBG_HAVE_COMPACTION 1
+#else
+#define rb_gc_mark_movable rb_gc_mark
+#endif
+
 //
 // # VALUE protection.
 //
 // Ruby GC relies on being able to find VALUEs that are in use.
 // Most of the C world relies on these being on the stack, which Ruby snoops.
 // Approach here to is to store each VALUE in a known-address box associated
-// with each Swift `RbObject`.  Then Ruby APIs are used to register this special
-// address with the GC, tied to the lifetime of the `RbObject`.
+// with each Swift `RbObject`.
+//
+// The Ruby `rb_gc_register_address` APIs are not scalable: the registry is
+// an SLL so unregistering is O(n) and every mark walks the whole list.  So
+// instead all the boxes live in a table of slots owned by a single hidden
+// Ruby object.  That object is registered once with the GC and its `dmark`
+// function marks every live slot.
+//
+// The table is a list of fixed-size slabs that are never moved or freed, so
+// a slot's address is stable for as long as the `RbObject` needs it.  Free
+// slots are chained together so that taking and releasing one is O(1).
+//
+// Special constants -- `nil`, fixnums, symbols, and so on -- are never
+// collected so they get no slot at all.  Copies of an `RbObject` share its
+// slot, which is reference-counted.
+//
+// The slots do not pin their objects: `GC.compact` can move them and the
+// `dcompact` function updates each slot to the new address.  So Swift must
+// always read a VALUE from its slot rather than keep a copy.  A slot can be
+// pinned for code that does need a stable VALUE, for example as a
+// dictionary key.
 //
-// The Ruby `rb_gc_register_address` APIs are not super-scalable (SLL) but should
-// be OK for our use cases.  If it turns out to be too slow then we will need to
-// implement a single parent Ruby object registered with GC and treat all of the
-// `RbObject`s as efficiently stored dynamic children, participating in the GC
-// protocols as required.  Sounds fun, might do that anyway!
+// The table memory comes from plain `malloc` -- `ruby_xmalloc` could trigger
+// a GC while the table is half-updated.  All access is serialized by the GVL,
+// same as the GC itself.
 //
 
-Rbg_value * _Nonnull rbg_value_alloc(VALUE value)
+/// One entry in the table.  `box` must come first: Swift sees just that part.
+typedef struct Rbg_slot {
+    Rbg_value box;
+    union {
+        /// In use
+        struct {
+            /// Number of `RbObject`s sharing the slot.
+            uint32_t     refs;
+            /// Number of users needing the VALUE not to move.
+            uint32_t     pins : 31;
+            /// Has a hash in `rbg_hashes`.
+            uint32_t     has_hash : 1;
+        };
+        /// Free: next free slot.
+        struct Rbg_slot *next_free;
+    };
+} Rbg_slot;
+
+/// Number of slots in each slab - 16KB worth.
+#define RBG_SLAB_SLOTS 1024
+
+static struct {
+    /// Directory of slabs, each `RBG_SLAB_SLOTS` long.
+    Rbg_slot **slabs;
+    size_t     slab_count;
+    size_t     slab_capacity;
+    /// Slots [0, high_water) have been handed out at least once.
+    size_t     high_water;
+    /// Chain of released slots.
+    Rbg_slot  *free_list;
+} rbg_roots;
+
+/// Marking: a slot in use holds a VALUE; a free slot holds `Qundef`.
+static void rbg_roots_mark(void *data)
 {
-    Rbg_value *box = malloc(sizeof(*box));
-    if (box == NULL)
+    size_t remaining = rbg_roots.high_water;
+
+    for (size_t i = 0; remaining > 0; i++)
     {
-        // No good way out here, don't want to make the RbEnv
-        // initializers failable.
-        abort();
+        Rbg_slot *slab = rbg_roots.slabs[i];
+        size_t count = remaining < RBG_SLAB_SLOTS ? remaining : RBG_SLAB_SLOTS;
+
+        for (size_t j = 0; j < count; j++)
+        {
+            VALUE value = slab[j].box.value;
+            if (RB_SPECIAL_CONST_P(value))
+            {
+                continue;
+            }
+            if (slab[j].pins > 0)
+            {
+                rb_gc_mark(value);
+            }
+            else
+            {
+                rb_gc_mark_movable(value);
+            }
+        }
+        remaining -= count;
     }
-    box->value = value;
+}
+
+#if RBG_HAVE_COMPACTION
+/// Compaction: update slots whose objects have moved.
+static void rbg_roots_compact(void *data)
+{
+    size_t remaining = rbg_roots.high_water;
 
-    // Subtlety - it would do no harm to register constants except that
-    // in the scenario where Ruby is not functioning we use Qnil etc. instead
-    // of actual values to avoid crashing, and we mustn't talk to the GC...
-    if (!RB_SPECIAL_CONST_P(value))
+    for (size_t i = 0; remaining > 0; i++)
     {
-        rb_gc_register_address(&box->value);
+        Rbg_slot *slab = rbg_roots.slabs[i];
+        size_t count = remaining < RBG_SLAB_SLOTS ? remaining : RBG_SLAB_SLOTS;
+
+        for (size_t j = 0; j < count; j++)
+        {
+            VALUE value = slab[j].box.value;
+            if (!RB_SPECIAL_CONST_P(value))
+            {
+                slab[j].box.value = rb_gc_location(value);
+            }
+        }
+        remaining -= count;
     }
-    return box;
+}
+#endif
+
+static size_t rbg_roots_size(const void *data)
+{
+    return rbg_roots.slab_count * RBG_SLAB_SLOTS * sizeof(Rbg_slot) +
+           rbg_roots.slab_capacity * sizeof(Rbg_slot *);
 }
 
-Rbg_value *rbg_value_dup(const Rbg_value * _Nonnull box)
+static const rb_data_type_t rbg_roots_data_type = {
+    .wrap_struct_name = "RubyGateway::Roots",
+    .function = {
+        .dmark = rbg_roots_mark,
+        .dfree = NULL, // table outlives the VM: RbObjects are freed after cleanup
+        .dsize = rbg_roots_size,
+#if RBG_HAVE_COMPACTION
+        .dcompact = rbg_roots_compact,
+#endif
+    },
+    .data = NULL,
+    .flags = 0
+};
+
+/// The Ruby object that owns the table.
+static VALUE rbg_roots_object = 0;
+
+/// Create and register the table owner.
+///
+/// Done lazily on the first non-constant VALUE because `RbObject`s get created
+/// for `Qnil` and friends before Ruby is set up, or when it is broken.
+static void rbg_roots_init(void)
 {
-    return rbg_value_alloc(box->value);
+    // No class => hidden from ObjectSpace.
+    rbg_roots_object = TypedData_Wrap_Struct(0, &rbg_roots_data_type, &rbg_roots);
+    rb_gc_register_mark_object(rbg_roots_object);
+}
+
+/// Get an unused slot, growing the table if necessary.
+static Rbg_slot *rbg_roots_get_slot(void)
+{
+    Rbg_slot *slot = rbg_roots.free_list;
+
+    if (slot != NULL)
+    {
+        rbg_roots.free_list = slot->next_free;
+        return slot;
+    }
+
+    if (rbg_roots.high_water == rbg_roots.slab_count * RBG_SLAB_SLOTS)
+    {
+        if (rbg_roots.slab_count == rbg_roots.slab_capacity)
+        {
+            size_t new_capacity = rbg_roots.slab_capacity ? rbg_roots.slab_capacity * 2 : 16;
+            Rbg_slot **new_slabs = realloc(rbg_roots.slabs, new_capacity * sizeof(Rbg_slot *));
+            if (new_slabs == NULL)
+            {
+                // No good way out here, don't want to make the RbEnv
+                // initializers failable.
+                abort();
+            }
+            rbg_roots.slabs = new_slabs;
+            rbg_roots.slab_capacity = new_capacity;
+        }
+
+        Rbg_slot *slab = malloc(RBG_SLAB_SLOTS * sizeof(Rbg_slot));
+        if (slab == NULL)
+        {
+            abort();
+        }
+        rbg_roots.slabs[rbg_roots.slab_count++] = slab;
+    }
+
+    size_t index = rbg_roots.high_water;
+    slot = &rbg_roots.slabs[index / RBG_SLAB_SLOTS][index % RBG_SLAB_SLOTS];
+    // Publish the slot only once it holds something the marker can read.
+    slot->box.value = Qundef;
+    rbg_roots.high_water = index + 1;
+    return slot;
+}
+
+//
+// Memoized hashes.
+//
+// Few objects get a memoized `hash` so it lives out of line, keeping the
+// slots small: an open-addressed table from slot to hash, with plain
+// `malloc` memory for the same reasons as the slots.  A slot's `has_hash`
+// bit says whether to look here.
+//
+
+typedef struct {
+    /// NULL for never used, `RBG_HASH_REMOVED` for a removed entry.
+    Rbg_slot *slot;
+    long      hash;
+} Rbg_hash_entry;
+
+#define RBG_HASH_REMOVED ((Rbg_slot *) 1)
+
+static struct {
+    Rbg_hash_entry *entries;
+    /// Power of 2
+    size_t          capacity;
+    /// Entries not NULL: live plus removed
+    size_t          used;
+    size_t          live;
+} rbg_hashes;
+
+static size_t rbg_hashes_start(Rbg_slot *slot)
+{
+    uint64_t key = (uint64_t) (uintptr_t) slot * 0x9E3779B97F4A7C15ULL;
+    return (size_t) (key >> 32) & (rbg_hashes.capacity - 1);
+}
+
+/// Entry for a slot with `has_hash` set.
+static Rbg_hash_entry *rbg_hashes_find(Rbg_slot *slot)
+{
+    size_t i = rbg_hashes_start(slot);
+
+    while (rbg_hashes.entries[i].slot != slot)
+    {
+        i = (i + 1) & (rbg_hashes.capacity - 1);
+    }
+    return &rbg_hashes.entries[i];
+}
+
+/// Rebuild at a size for the live entries, dropping removed ones.
+static int rbg_hashes_resize(void)
+{
+    size_t new_capacity = 64;
+    while (new_capacity < rbg_hashes.live * 4)
+    {
+        new_capacity *= 2;
+    }
+    Rbg_hash_entry *new_entries = calloc(new_capacity, sizeof(Rbg_hash_entry));
+    if (new_entries == NULL)
+    {
+        return 0;
+    }
+
+    Rbg_hash_entry *old_entries = rbg_hashes.entries;
+    size_t old_capacity = rbg_hashes.capacity;
+    rbg_hashes.entries = new_entries;
+    rbg_hashes.capacity = new_capacity;
+    rbg_hashes.used = rbg_hashes.live;
+    for (size_t j = 0; j < old_capacity; j++)
+    {
+        Rbg_slot *slot = old_entries[j].slot;
+        if (slot != NULL && slot != RBG_HASH_REMOVED)
+        {
+            size_t i = rbg_hashes_start(slot);
+            while (new_entries[i].slot != NULL)
+            {
+                i = (i + 1) & (new_capacity - 1);
+            }
+            new_entries[i] = old_entries[j];
+        }
+    }
+    free(old_entries);
+    return 1;
+}
+
+/// Add a hash for a slot without one.  Returns 0 if out of memory.
+static int rbg_hashes_insert(Rbg_slot *slot, long hash)
+{
+    if ((rbg_hashes.used + 1) * 2 > rbg_hashes.capacity && !rbg_hashes_resize())
+    {
+        return 0;
+    }
+    size_t i = rbg_hashes_start(slot);
+    while (rbg_hashes.entries[i].slot != NULL)
+    {
+        i = (i + 1) & (rbg_hashes.capacity - 1);
+    }
+    rbg_hashes.entries[i].slot = slot;
+    rbg_hashes.entries[i].hash = hash;
+    rbg_hashes.used++;
+    rbg_hashes.live++;
+    return 1;
+}
+
+static void rbg_hashes_remove(Rbg_slot *slot)
+{
+    rbg_hashes_find(slot)->slot = RBG_HASH_REMOVED;
+    rbg_hashes.live--;
+    slot->has_hash = 0;
+}
+
+Rbg_value * _Nullable rbg_value_alloc(VALUE value)
+{
+    // Besides saving the slot, this matters when Ruby is not functioning:
+    // we use Qnil etc. instead of actual values to avoid crashing, and we
+    // mustn't talk to the GC...
+    if (RB_SPECIAL_CONST_P(value))
+    {
+        return NULL;
+    }
+    if (rbg_roots_object == 0)
+    {
+        rbg_roots_init();
+    }
+
+    Rbg_slot *slot = rbg_roots_get_slot();
+    slot->refs = 1;
+    slot->pins = 0;
+    slot->has_hash = 0;
+    slot->box.value = value;
+    return &slot->box;
+}
+
+Rbg_value * _Nonnull rbg_value_dup(Rbg_value * _Nonnull box)
+{
+    Rbg_slot *slot = (Rbg_slot *) box;
+
+    slot->refs++;
+    return box;
 }
 
 void rbg_value_free(Rbg_value * _Nonnull box)
 {
-    if (!RB_SPECIAL_CONST_P(box->value))
+    Rbg_slot *slot = (Rbg_slot *) box;
+
+    if (--slot->refs > 0)
+    {
+        return;
+    }
+    if (slot->has_hash)
+    {
+        rbg_hashes_remove(slot);
+    }
+    slot->box.value = Qundef;
+    slot->next_free = rbg_roots.free_list;
+    rbg_roots.free_list = slot;
+}
+
+void rbg_value_pin(Rbg_value * _Nonnull box)
+{
+    Rbg_slot *slot = (Rbg_slot *) box;
+
+    slot->pins++;
+}
+
+void rbg_value_unpin(Rbg_value * _Nonnull box)
+{
+    Rbg_slot *slot = (Rbg_slot *) box;
+
+    slot->pins--;
+}
+
+int rbg_value_get_hash(Rbg_value * _Nonnull box, long * _Nonnull hash)
+{
+    Rbg_slot *slot = (Rbg_slot *) box;
+
+    if (!slot->has_hash)
+    {
+        return 0;
+    }
+    *hash = rbg_hashes_find(slot)->hash;
+    return 1;
+}
+
+void rbg_value_set_hash(Rbg_value * _Nonnull box, long hash)
+{
+    Rbg_slot *slot = (Rbg_slot *) box;
+
+    if (slot->has_hash)
+    {
+        rbg_hashes_find(slot)->hash = hash;
+    }
+    else if (rbg_hashes_insert(slot, hash))
     {
-        rb_gc_unregister_address(&box->value);
+        slot->has_hash = 1;
     }
-    box->value = Qundef;
-    free(box);
 }
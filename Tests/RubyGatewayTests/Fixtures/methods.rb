@@ -1,3 +1,5 @@
+require 'set'
+
 class MethodsTest
     attr_accessor :property
 
@@ -28,6 +28,28 @@ class TestArrays: XCTestCase {
         doTestRoundTrip(arr: [1, 2, 3])
     }
 
+    /// Bulk-converted primitives
+    func testRoundTripBulk() {
+        doTestRoundTrip(arr: [Int.max, Int.min, 0, -1, 1 << 40])
+        doTestRoundTrip(arr: [1.5, -0.0, Double.greatestFiniteMagnitude, 1e-300])
+        doTestRoundTrip(arr: [true, false, false])
+        doTestRoundTrip(arr: [Int]())
+        doTestRoundTrip(arr: Array(0..<10_000))
+    }
+
+    /// Bulk conversion of elements that need Ruby's help
+    func testBulkFallback() {
+        doErrorFree {
+            let mixed = try Ruby.eval(ruby: "[1, 2.7, '3', 2**70 / 2**10, nil, false]")
+            XCTAssertEqual([1, 2, 3, 1 << 60], Array<Int>(try mixed.call("first", args: [4])))
+            XCTAssertEqual([1.0, 2.7, 3.0, Double(1 << 60)], Array<Double>(try mixed.call("first", args: [4])))
+            XCTAssertEqual([true, true, true, true, false, false], Array<Bool>(mixed))
+            XCTAssertNil(Array<Int>(mixed))
+            XCTAssertNil(Array<Double>(mixed))
+            XCTAssertNil(Array<Int>(try Ruby.eval(ruby: "[2**70]")))
+        }
+    }
+
     /// Another primitive...
     func testRoundTripString() {
         doTestRoundTrip(arr: ["one", "two", "three"])
@@ -0,0 +1,80 @@
+//
+//  TestBatch.swift
+//  RubyGatewayTests
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+import XCTest
+import RubyGateway
+
+/// Batched operations
+class TestBatch: XCTestCase {
+
+    // Mix of operations
+    func testBatch() {
+        doErrorFree {
+            let batch = RbBatch()
+            let str = try batch.call(RbObject("abc"), "upcase")
+            let sum = try batch.call(RbObject(3), "+", args: [4])
+            let global = try batch.call(Ruby, "sprintf", args: ["%d-%s", 5, "x"])
+            let int = batch.convert(RbObject("42"), to: Int.self)
+            let dbl = batch.convert(RbObject(2), to: Double.self)
+            let text = batch.convert(RbObject(1.5), to: String.self)
+            let insp = batch.inspect(RbObject("q"))
+            let site = try batch.call(try RbObject([1, 2, 3]).callSite("fetch", arity: 1), args: [1])
+            XCTAssertEqual(8, batch.count)
+
+            try batch.run()
+            XCTAssertEqual(8, batch.completedCount)
+            XCTAssertNil(batch.failedIndex)
+
+            try Ruby.get("GC").call("start")
+
+            XCTAssertEqual("ABC", batch[str])
+            XCTAssertEqual(7, batch[sum])
+            XCTAssertEqual("5-x", batch[global])
+            XCTAssertEqual(42, batch[int])
+            XCTAssertEqual(2.0, batch[dbl])
+            XCTAssertEqual("1.5", batch[text])
+            XCTAssertEqual("\"q\"", batch[insp])
+            XCTAssertEqual(2, batch[site])
+
+            // Again
+            try batch.run()
+            XCTAssertEqual("ABC", batch[str])
+        }
+    }
+
+    // Failure stops the batch
+    func testBatchFailure() {
+        doErrorFree {
+            let batch = RbBatch()
+            let first = batch.convert(RbObject(1), to: Int.self)
+            batch.convert(RbObject("fish"), to: Int.self)
+            try batch.call(RbObject(1), "no_such_method")
+
+            doError {
+                try batch.run()
+            }
+            XCTAssertEqual(1, batch.completedCount)
+            XCTAssertEqual(1, batch.failedIndex)
+            XCTAssertEqual(1, batch[first])
+        }
+    }
+
+    // Empty + arity
+    func testBatchEdges() {
+        doErrorFree {
+            let batch = RbBatch()
+            try batch.run()
+            XCTAssertEqual(0, batch.completedCount)
+            XCTAssertNil(batch.failedIndex)
+
+            let site = try RbObject(1).callSite("+", arity: 1)
+            doError {
+                try batch.call(site)
+            }
+        }
+    }
+}
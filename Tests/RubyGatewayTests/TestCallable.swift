@@ -186,6 +186,87 @@ class TestCallable: XCTestCase {
         }
     }
 
+    // call with a borrowed-args Swift block
+    func testCallWithBorrowedBlock() {
+        let obj = getNewMethodTest()
+
+        doErrorFree {
+            let expectedRes = "answer"
+
+            let res = try obj.callWithBorrowedBlock("yielder", kwArgs: ["value": 22]) { args in
+                XCTAssertEqual(2, args.count)
+                XCTAssertEqual(22, try args[0].convert(to: Int.self))
+                XCTAssertEqual("fish", try args[1].convert(to: String.self))
+                return RbObject(expectedRes)
+            }
+            XCTAssertEqual(expectedRes, String(res))
+        }
+    }
+
+    // each(as:) fast path
+    func testEachAs() {
+        doErrorFree {
+            let array = try Ruby.eval(ruby: "(1..100).to_a")
+            var total = 0
+            try array.each(as: Int.self) { total += $0 }
+            XCTAssertEqual(5050, total)
+
+            var strings: [String] = []
+            try ["a", "b"].rubyObject.each(as: String.self) { strings.append($0) }
+            XCTAssertEqual(["a", "b"], strings)
+
+            // Several values yielded together come as an array
+            let hash = try Ruby.eval(ruby: "{ 1 => 2, 3 => 4 }")
+            var pairs: [[Int]] = []
+            try hash.each(as: [Int].self) { pairs.append($0) }
+            XCTAssertEqual([[1, 2], [3, 4]], pairs)
+
+            // break
+            var count = 0
+            try array.each(as: Int.self) { _ in
+                count += 1
+                if count == 3 {
+                    throw RbBreak()
+                }
+            }
+            XCTAssertEqual(3, count)
+        }
+    }
+
+    // Errors from borrowed blocks
+    func testBorrowedBlockErrors() {
+        doErrorFree {
+            let array = try Ruby.eval(ruby: "[1, 2, 'three', 4]")
+
+            // Conversion failure stops the loop and comes back as itself
+            var seen: [Int] = []
+            do {
+                try array.each(as: Int.self) { seen.append($0) }
+                XCTFail("Managed to convert 'three'")
+            } catch RbError.badType(let msg) {
+                XCTAssertTrue(msg.contains("three"))
+            }
+            XCTAssertEqual([1, 2], seen)
+
+            // Ruby exception from the block
+            doError {
+                try array.callWithBorrowedBlock("each") { args in
+                    throw RbException(message: "Oops")
+                }
+            }
+
+            // Swift error passes through
+            struct MyError: Error {}
+            do {
+                try array.callWithBorrowedBlock("each") { args -> RbObject in
+                    throw MyError()
+                }
+                XCTFail("Didn't throw")
+            } catch is MyError {
+            }
+        }
+    }
+
     // call with a Proc'd Swift block
     func testCallWithProcBlock() {
         let obj = getNewMethodTest()
@@ -246,4 +327,63 @@ class TestCallable: XCTestCase {
             try obj.call("expectsNil", args: [nil])
         }
     }
+
+    // Call sites
+    func testCallSite() {
+        let obj = getNewMethodTest()
+
+        doErrorFree {
+            let noArgs = try obj.callSite("noArgsMethod")
+            XCTAssertEqual("noArgsMethod", noArgs.methodName)
+            XCTAssertEqual(0, noArgs.arity)
+            XCTAssertTrue(try noArgs.call().isNil)
+
+            let threeArgs = try obj.callSite("threeArgsMethod", arity: 3)
+            for _ in 0..<3 {
+                XCTAssertEqual("OK", String(try threeArgs.call("str", 38, 123.4)))
+            }
+            XCTAssertEqual("OK", String(try threeArgs.call(args: ["str", 38, 123.4])))
+
+            let double = try obj.callSite("double", arity: 1)
+            XCTAssertEqual(8, Int(try double.call(4)))
+            let value = RbObject(10)
+            let result = try value.withRubyValue { rubyValue in
+                try [rubyValue].withUnsafeBufferPointer {
+                    try double.call(rubyValues: $0)
+                }
+            }
+            XCTAssertEqual(20, Int(result))
+
+            let sprintf = try Ruby.callSite("sprintf", arity: 4)
+            XCTAssertEqual("1 2 3", String(try sprintf.call("%d %d %d", 1, 2, 3)))
+        }
+    }
+
+    // Call site errors
+    func testCallSiteErrors() {
+        let obj = getNewMethodTest()
+
+        doErrorFree {
+            let threeArgs = try obj.callSite("threeArgsMethod", arity: 3)
+            doError {
+                let res = try threeArgs.call("str", 38)
+                XCTFail("Managed to call with wrong arity: \(res)")
+            }
+            // Ruby exception
+            doError {
+                let res = try threeArgs.call(38, 38, 38)
+                XCTFail("Managed to call with bad args: \(res)")
+            }
+        }
+
+        doError {
+            let site = try obj.callSite("Invalid")
+            XCTFail("Managed to create call site with bad name: \(site)")
+        }
+
+        doError {
+            let site = try obj.callSite("double", arity: -1)
+            XCTFail("Managed to create call site with bad arity: \(site)")
+        }
+    }
 }
@@ -116,6 +116,43 @@ class TestClassDef: XCTestCase {
         }
     }
 
+    // Method resolution cache invalidation
+    func testMethodResolution() {
+        doErrorFree {
+            let base = try Ruby.defineClass("ResolveBase")
+            let derived = try Ruby.defineClass("ResolveDerived", parent: base)
+            let mod = try Ruby.defineModule("ResolveModule")
+
+            try base.defineMethod("which") { _, _ in "base" }
+            try mod.defineMethod("which") { _, _ in "module" }
+
+            let obj = try derived.call("new")
+            for _ in 0..<3 {
+                XCTAssertEqual("base", try obj.call("which"))
+            }
+
+            // Redefine
+            try base.defineMethod("which") { _, _ in "base2" }
+            XCTAssertEqual("base2", try obj.call("which"))
+
+            // Change ancestors
+            try derived.include(module: mod)
+            XCTAssertEqual("module", try obj.call("which"))
+
+            // Derived-class override
+            try derived.defineMethod("which") { _, _ in "derived" }
+            XCTAssertEqual("derived", try obj.call("which"))
+
+            // Extend one object
+            let single = try derived.call("new")
+            let mod2 = try Ruby.defineModule("ResolveModule2")
+            try mod2.defineMethod("which") { _, _ in "module2" }
+            try single.extend(module: mod2)
+            XCTAssertEqual("module2", try single.call("which"))
+            XCTAssertEqual("derived", try obj.call("which"))
+        }
+    }
+
     private func runGC() throws {
         try Ruby.get("GC").call("start")
     }
@@ -203,6 +240,49 @@ class TestClassDef: XCTestCase {
         }
     }
 
+    class MyPooledClass {
+        static var initCount = 0
+
+        init() {
+            MyPooledClass.initCount += 1
+        }
+    }
+
+    // Swift peers recycled
+    func testBoundPeerPool() {
+        doErrorFree {
+            let clazz = try Ruby.defineClass("SwiftBoundPooled", peerPoolSize: 1, initializer: MyPooledClass.init)
+            MyPooledClass.initCount = 0
+
+            clazz.withRubyValue { classValue in
+                guard let first = RbClassBinding.alloc(classValue: classValue),
+                      let second = RbClassBinding.alloc(classValue: classValue) else {
+                    XCTFail("Couldn't create instances")
+                    return
+                }
+                XCTAssertEqual(2, MyPooledClass.initCount)
+                RbClassBinding.free(classValue: classValue, instance: first)
+                RbClassBinding.free(classValue: classValue, instance: second)
+
+                guard let third = RbClassBinding.alloc(classValue: classValue) else {
+                    XCTFail("Couldn't create instance")
+                    return
+                }
+                XCTAssertEqual(first, third)
+                XCTAssertEqual(2, MyPooledClass.initCount)
+                RbClassBinding.free(classValue: classValue, instance: third)
+            }
+
+            let inst = try clazz.call("new")
+            let _ = try inst.getBoundObject(type: MyPooledClass.self)
+            XCTAssertEqual(2, MyPooledClass.initCount)
+
+            doError {
+                try Ruby.defineClass("SwiftBoundBadPool", peerPoolSize: -1, initializer: MyPooledClass.init)
+            }
+        }
+    }
+
     // Nesting name resolution works properly
     func testNestedBound() {
         doErrorFree {
@@ -222,7 +302,8 @@ class TestClassDef: XCTestCase {
     func testSpecialCases() {
         doErrorFree {
             do {
-                let instance = RbClassBinding.alloc(name: "NotABoundClass")
+                let clazz = try Ruby.get("Object")
+                let instance = clazz.withRubyValue { RbClassBinding.alloc(classValue: $0) }
                 XCTAssertNil(instance)
             }
 
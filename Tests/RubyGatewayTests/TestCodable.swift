@@ -0,0 +1,173 @@
+//
+//  TestCodable.swift
+//  RubyGatewayTests
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+import XCTest
+import RubyGateway
+
+/// Codable via Ruby objects
+class TestCodable: XCTestCase {
+    struct Address: Codable, Equatable {
+        let street: String
+        let zip: UInt32
+    }
+
+    struct Person: Codable, Equatable {
+        let name: String
+        let age: Int
+        let height: Double
+        let admin: Bool
+        let nickname: String?
+        let tags: [String]
+        let addresses: [Address]
+        let scores: [String: Int]
+    }
+
+    let fred = Person(name: "Fred", age: 32, height: 1.8, admin: true, nickname: nil,
+                      tags: ["a", "b"], addresses: [Address(street: "High St", zip: 12345)],
+                      scores: ["x": 1])
+
+    /// Encode to expected Ruby, decode back
+    func testRoundTrip() {
+        doErrorFree {
+            let encoded = try RbEncoder().encode(fred)
+            let expected = try Ruby.eval(ruby: """
+                { name: "Fred", age: 32, height: 1.8, admin: true, tags: ["a", "b"],
+                  addresses: [{ street: "High St", zip: 12345 }], scores: { x: 1 } }
+                """)
+            XCTAssertEqual(expected, encoded)
+
+            let decoded = try RbDecoder().decode(Person.self, from: encoded)
+            XCTAssertEqual(fred, decoded)
+        }
+    }
+
+    /// String keys, reused coders
+    func testStringKeys() {
+        doErrorFree {
+            let encoder = RbEncoder(keyStyle: .strings)
+            let decoder = RbDecoder(keyStyle: .strings)
+            XCTAssertEqual(.strings, encoder.keyStyle)
+
+            for _ in 0..<2 {
+                let encoded = try encoder.encode(Address(street: "Low Rd", zip: 1))
+                let expected = try Ruby.eval(ruby: #"{ "street" => "Low Rd", "zip" => 1 }"#)
+                XCTAssertEqual(expected, encoded)
+                try XCTAssertTrue(encoded.call("keys").call("first").call("frozen?").isTruthy)
+                try XCTAssertEqual(Address(street: "Low Rd", zip: 1), decoder.decode(Address.self, from: encoded))
+            }
+        }
+    }
+
+    /// Top-level values that aren't hashes
+    func testTopLevel() {
+        doErrorFree {
+            let encoder = RbEncoder()
+            try XCTAssertEqual(RbObject(42), encoder.encode(42))
+            try XCTAssertEqual(RbObject([1, 2, 3]), encoder.encode([1, 2, 3]))
+            try XCTAssertEqual(RbObject.nilObject, encoder.encode(Optional<Int>.none))
+
+            let decoder = RbDecoder()
+            try XCTAssertEqual("str", decoder.decode(String.self, from: RbObject("str")))
+            try XCTAssertEqual("sym", decoder.decode(String.self, from: RbSymbol("sym").rubyObject))
+            try XCTAssertEqual([1.5, 2], decoder.decode([Double].self, from: Ruby.eval(ruby: "[1.5, 2]")))
+            try XCTAssertEqual(UInt64.max, decoder.decode(UInt64.self, from: RbObject(UInt64.max)))
+            try XCTAssertEqual(3, decoder.decode(Int8.self, from: RbObject(3.0)))
+            try XCTAssertNil(decoder.decode(Int?.self, from: .nilObject))
+        }
+    }
+
+    /// Decode failures
+    func testDecodeErrors() {
+        let decoder = RbDecoder()
+
+        func check<T: Decodable>(_ type: T.Type, _ ruby: String, _ matches: (DecodingError) -> Bool) {
+            do {
+                let value = try decoder.decode(type, from: Ruby.eval(ruby: ruby))
+                XCTFail("Managed to decode \(ruby) as \(value)")
+            } catch let error as DecodingError {
+                XCTAssertTrue(matches(error), "Unexpected error \(error)")
+            } catch {
+                XCTFail("Unexpected error \(error)")
+            }
+        }
+
+        check(Address.self, "{ street: 'High St' }") {
+            if case .keyNotFound(let key, _) = $0 { return key.stringValue == "zip" }
+            return false
+        }
+        check(Address.self, "{ street: 'High St', zip: '12345' }") {
+            if case .typeMismatch(_, let context) = $0 { return context.codingPath.map { $0.stringValue } == ["zip"] }
+            return false
+        }
+        check(Address.self, "{ street: 'High St', zip: -1 }") {
+            if case .dataCorrupted = $0 { return true }
+            return false
+        }
+        check(Address.self, "[1]") {
+            if case .typeMismatch = $0 { return true }
+            return false
+        }
+        check([Int].self, "[1, 2.5]") {
+            if case .dataCorrupted(let context) = $0 { return context.codingPath.first?.intValue == 1 }
+            return false
+        }
+        check(Bool.self, "nil") {
+            if case .typeMismatch = $0 { return true }
+            return false
+        }
+        check(UInt64.self, "-(2**64 - 1)") {
+            if case .dataCorrupted = $0 { return true }
+            return false
+        }
+        check(UInt64.self, "2**64") {
+            if case .dataCorrupted = $0 { return true }
+            return false
+        }
+    }
+
+    /// Class hierarchies and nested containers
+    class Base: Codable {
+        let id: Int
+        init(id: Int) { self.id = id }
+    }
+
+    final class Derived: Base {
+        let extra: [[Int]]
+
+        init(id: Int, extra: [[Int]]) {
+            self.extra = extra
+            super.init(id: id)
+        }
+
+        enum CodingKeys: String, CodingKey {
+            case extra
+        }
+
+        required init(from decoder: Decoder) throws {
+            let container = try decoder.container(keyedBy: CodingKeys.self)
+            extra = try container.decode([[Int]].self, forKey: .extra)
+            try super.init(from: container.superDecoder())
+        }
+
+        override func encode(to encoder: Encoder) throws {
+            var container = encoder.container(keyedBy: CodingKeys.self)
+            try container.encode(extra, forKey: .extra)
+            try super.encode(to: container.superEncoder())
+        }
+    }
+
+    func testSuperAndNesting() {
+        doErrorFree {
+            let encoded = try RbEncoder().encode(Derived(id: 4, extra: [[1], [2, 3]]))
+            try XCTAssertEqual(Ruby.eval(ruby: "{ extra: [[1], [2, 3]], super: { id: 4 } }"), encoded)
+
+            let decoded = try RbDecoder().decode(Derived.self, from: encoded)
+            XCTAssertEqual(4, decoded.id)
+            XCTAssertEqual([[1], [2, 3]], decoded.extra)
+        }
+    }
+}
@@ -52,6 +52,42 @@ class TestCollection: XCTestCase {
         XCTAssertEqual([5], Array<Int>(arr))
     }
 
+    // iterate across chunks, and notice the array growing
+    func testIterate() {
+        let arr = Array(0..<200).rubyObject
+        XCTAssertEqual(Array(0..<200), arr.collection.map { Int($0)! })
+
+        var seen: [Int] = []
+        for element in arr.collection {
+            seen.append(Int(element)!)
+            if seen.count == 150 {
+                arr.collection.append(RbObject(200))
+            }
+        }
+        XCTAssertEqual(Array(0...200), seen)
+
+        XCTAssertEqual([], RbObjectCollection().map { $0 })
+    }
+
+    // non-Array objects go through methods
+    func testDuckTyped() {
+        doErrorFree {
+            let obj = try Ruby.eval(ruby: """
+                          Class.new do
+                            def initialize; @a = [1, 2, 3]; end
+                            def length; @a.length; end
+                            def [](i); @a[i]; end
+                            def []=(i, v); @a[i] = v; end
+                          end.new
+                          """)
+            let coll = obj.collection
+            XCTAssertEqual(3, coll.count)
+            XCTAssertEqual([1, 2, 3], coll.map { Int($0)! })
+            obj.collection[1] = 5
+            XCTAssertEqual(5, Int(coll[1]))
+        }
+    }
+
     // constructivist API, can't avoid supporting from protocols
     func testConstructivist() {
         let el = "Fish"
@@ -25,6 +25,30 @@ class TestDictionaries: XCTestCase {
         XCTAssertEqual(dict, backDict)
     }
 
+    func testRoundTripBig() {
+        let count = 1000
+        let dict = Dictionary(uniqueKeysWithValues: (0..<count).map { ("key\($0)", Double($0) / 2) })
+
+        let hashObj = RbObject(dict)
+        XCTAssertEqual(count, Int(try hashObj.call("size")))
+        XCTAssertEqual(250.5, Double(hashObj["key501"]))
+        XCTAssertEqual(dict, Dictionary<String, Double>(hashObj))
+
+        // Untyped keys and values
+        guard let objDict = Dictionary<RbObject, RbObject>(hashObj) else {
+            XCTFail("Couldn't convert to RbObject dictionary")
+            return
+        }
+        XCTAssertEqual(count, objDict.count)
+        XCTAssertEqual(RbObject(10.0), objDict["key20"])
+
+        // Ruby freezes string keys
+        doErrorFree {
+            let keyObj = try hashObj.call("keys").call("first")
+            XCTAssertTrue(try keyObj.call("frozen?").isTruthy)
+        }
+    }
+
     private func getSymNumHash(method: String = "get_sym_num_hash") -> RbObject {
         return doErrorFree(fallback: .nilObject) {
             try Ruby.require(filename: Helpers.fixturePath("methods.rb"))
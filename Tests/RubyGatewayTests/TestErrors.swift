@@ -91,6 +91,49 @@ class TestErrors: XCTestCase {
         }
     }
 
+    /// Error history ordering across the wrap
+    func testErrorHistoryOrder() {
+        RbError.history.clear()
+
+        for n in 0..<20 {
+            try? raise(error: RbError.badParameter("\(n)"))
+        }
+        let messages = RbError.history.errors.map { error -> String in
+            guard case let .badParameter(msg) = error else {
+                return ""
+            }
+            return msg
+        }
+        XCTAssertEqual((8..<20).map { "\($0)" }, messages)
+    }
+
+    /// Not recording errors
+    func testErrorHistoryOff() {
+        RbError.history.clear()
+
+        RbError.history.isEnabled = false
+        try? raise(error: RbError.setup(""))
+        XCTAssertNil(RbError.history.mostRecent)
+        RbError.history.isEnabled = true
+
+        RbError.history.withoutRecording {
+            try? raise(error: RbError.setup(""))
+            RbError.history.withoutRecording {
+                try? raise(error: RbError.setup(""))
+            }
+            try? raise(error: RbError.setup(""))
+        }
+        XCTAssertNil(RbError.history.mostRecent)
+
+        doErrorFree {
+            let obj = try Ruby.eval(ruby: "Object.new")
+            XCTAssertNil(obj.failable.withoutHistory.call("not_a_method"))
+            XCTAssertNil(RbError.history.mostRecent)
+            XCTAssertNil(obj.failable.call("not_a_method"))
+            XCTAssertNotNil(RbError.history.mostRecent)
+        }
+    }
+
     /// Ruby exception details
     func testRubyException() {
         RbError.history.clear()
@@ -111,6 +154,82 @@ class TestErrors: XCTestCase {
         }
     }
 
+    /// Exceptions raised from Swift
+    func testSwiftException() {
+        doErrorFree {
+            RbError.history.clear()
+            let exn = RbException(message: "Lazy")
+            XCTAssertEqual("RuntimeError: Lazy", exn.description)
+            XCTAssertEqual("Lazy", String(exn.exception))
+            try XCTAssertEqual("RuntimeError", exn.exception.get("class").description)
+            XCTAssertTrue(exn.exception === exn.exception)
+            XCTAssertNotNil(RbError.history.mostRecent)
+
+            RbError.history.clear()
+            let _ = RbException(message: "Unrecorded", recordHistory: false)
+            XCTAssertNil(RbError.history.mostRecent)
+
+            let stopIteration = try Ruby.get("StopIteration")
+            let stop = try RbException(class: stopIteration, message: "Done", recordHistory: false)
+            XCTAssertEqual("StopIteration: Done", stop.description)
+            XCTAssertNil(RbError.history.mostRecent)
+            try Ruby.defineGlobalFunction("swiftStop") { _, _ in
+                throw try RbException(class: stopIteration, message: "Stopped", recordHistory: false)
+            }
+            let stopped = try Ruby.eval(ruby: "loop { swiftStop }")
+            XCTAssertTrue(stopped.isNil)
+            let stopMessage = try Ruby.eval(ruby: "begin; swiftStop; rescue StopIteration => e; e.message; end")
+            XCTAssertEqual("Stopped", String(stopMessage))
+
+            // History holds the exception that Ruby rescued
+            try Ruby.defineGlobalFunction("swiftRecorded") { _, _ in
+                throw RbException(message: "Recorded")
+            }
+            let recorded = try Ruby.eval(ruby: "begin; swiftRecorded; rescue => e; e; end")
+            guard case .rubyException(let recordedExn)? = RbError.history.mostRecent else {
+                XCTFail("Raise not recorded")
+                return
+            }
+            try XCTAssertTrue(recorded.call("equal?", args: [recordedExn.exception]).isTruthy)
+            try XCTAssertFalse(recorded.get("backtrace").isNil)
+
+            doError {
+                let exn = try RbException(class: RbObject(3), message: "Number")
+                XCTFail("Made exception with number class: \(exn)")
+            }
+            doError {
+                let exn = try RbException(class: Ruby.get("String"), message: "String")
+                XCTFail("Made exception with non-exception class: \(exn)")
+            }
+            RbError.history.clear()
+
+            try Ruby.defineGlobalFunction("swiftRaise",
+                                          argsSpec: RbMethodArgsSpec(leadingMandatoryCount: 1)) { _, method in
+                throw RbException(message: "From Swift \(method.args.mandatory[0])", recordHistory: false)
+            }
+            try Ruby.defineGlobalFunction("swiftArity",
+                                          argsSpec: RbMethodArgsSpec(leadingMandatoryCount: 1,
+                                                                     optionalValues: [1])) { _, _ in
+                .nilObject
+            }
+
+            let rescued = try Ruby.eval(ruby: "begin; swiftRaise(3); rescue RuntimeError => e; e.message; end")
+            XCTAssertEqual("From Swift 3", String(rescued))
+            XCTAssertNil(RbError.history.mostRecent)
+
+            let arity = try Ruby.eval(ruby: "begin; swiftArity(1, 2, 3); rescue ArgumentError => e; e.message; end")
+            XCTAssertEqual("wrong number of arguments (given 3, expected 1..2)", String(arity))
+
+            do {
+                try Ruby.call("swiftRaise", args: ["again"])
+                XCTFail("Didn't raise")
+            } catch RbError.rubyException(let exn) {
+                XCTAssertEqual("RuntimeError: From Swift again", exn.description)
+                XCTAssertTrue(exn.backtrace.count > 0)
+            }
+        }
+    }
+
     /// Ruby stack overflow
     func testRubyStackOverflow() {
         doErrorFree {
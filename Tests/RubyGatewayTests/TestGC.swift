@@ -0,0 +1,149 @@
+//
+//  TestGC.swift
+//  RubyGatewayTests
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+import XCTest
+import RubyGateway
+
+/// GC control and compaction
+class TestGC: XCTestCase {
+
+    private var haveCompaction: Bool {
+        let version = Ruby.apiVersion
+        return version.0 > 2 || (version.0 == 2 && version.1 >= 7)
+    }
+
+    func testDisable() {
+        doErrorFree {
+            let gc = Ruby.gc
+            try XCTAssertFalse(gc.disable())
+            try XCTAssertTrue(gc.disable())
+            try XCTAssertTrue(gc.enable())
+            try XCTAssertFalse(gc.enable())
+
+            let result = try gc.withDisabled { () -> Int in
+                try XCTAssertTrue(gc.disable())
+                return 12
+            }
+            XCTAssertEqual(12, result)
+            try XCTAssertFalse(gc.disable())
+
+            // Leaves it disabled if it was
+            try gc.withDisabled {}
+            try XCTAssertTrue(gc.enable())
+        }
+    }
+
+    func testCollectAndStats() {
+        doErrorFree {
+            let gc = Ruby.gc
+            let count = gc.count
+            try gc.start()
+            XCTAssertGreaterThan(gc.count, count)
+
+            let stats = try gc.stats()
+            XCTAssertEqual(gc.count, stats.count)
+            XCTAssertEqual(stats.count, stats.minorCount + stats.majorCount)
+            XCTAssertGreaterThan(stats.heapLiveSlots, 0)
+            XCTAssertGreaterThan(stats.totalAllocatedObjects, stats.totalFreedObjects)
+            XCTAssertEqual(stats.values["heap_live_slots"], stats.heapLiveSlots)
+
+            try gc.step()
+            try XCTAssertGreaterThan(gc.stats().minorCount, stats.minorCount)
+
+            try gc.adjustMemoryUsage(by: 1024 * 1024)
+            try gc.adjustMemoryUsage(by: -1024 * 1024)
+        }
+    }
+
+    /// Objects held by Swift survive being moved
+    func testCompact() {
+        guard haveCompaction else {
+            doError {
+                try Ruby.gc.compact()
+            }
+            return
+        }
+        doErrorFree {
+            guard try Ruby.get("GC").call("respond_to?", args: [RbSymbol("compact")]).isTruthy else {
+                print("Skipping testCompact, platform does not support it")
+                return
+            }
+            let strings = (0..<1000).map { RbObject("string \($0)") }
+            let copies = strings.map { RbObject($0) }
+            let interned = RbObject(interned: "gc interned")
+            let encoder = RbEncoder(keyStyle: .strings)
+            let _ = try encoder.encode(["key": 1])
+
+            let gcClass = try Ruby.defineClass("GCCompactTest")
+            try gcClass.defineMethod("answer") { _, _ in 42 }
+            let instance = try gcClass.call("new")
+
+            let batch = RbBatch()
+            let length = try batch.call(strings[5], "length")
+            try batch.run()
+
+            try Ruby.gc.compact()
+            // Debug method that moves every object that can move
+            if try Ruby.get("GC").call("respond_to?", args: [RbSymbol("verify_compaction_references")]).isTruthy {
+                let version = Ruby.apiVersion
+                if version.0 > 3 || (version.0 == 3 && version.1 >= 2) {
+                    try Ruby.get("GC").call("verify_compaction_references",
+                                            kwArgs: ["toward": RbSymbol("empty"), "expand_heap": true])
+                } else {
+                    try Ruby.get("GC").call("verify_compaction_references",
+                                            kwArgs: ["toward": RbSymbol("empty"), "double_heap": true])
+                }
+            }
+            try Ruby.gc.start()
+
+            for (index, string) in strings.enumerated() {
+                XCTAssertEqual("string \(index)", String(string))
+                XCTAssertEqual("string \(index)", String(copies[index]))
+            }
+            try XCTAssertTrue(interned.call("equal?", args: [RbObject(interned: "gc interned")]).isTruthy)
+            try XCTAssertEqual(Ruby.eval(ruby: #"{ "key" => 2 }"#), encoder.encode(["key": 2]))
+            try XCTAssertEqual(42, Int(instance.call("answer")))
+            try XCTAssertEqual(42, Int(gcClass.call("new").call("answer")))
+
+            XCTAssertEqual(8, Int(batch[length]))
+            try batch.run()
+            XCTAssertEqual(8, Int(batch[length]))
+            if Ruby.apiVersion.0 >= 3 {
+                try XCTAssertGreaterThan(Ruby.gc.stats().compactCount, 0)
+            }
+        }
+    }
+
+    /// String bytes stay put while borrowed
+    func testCompactInStringBytes() {
+        guard haveCompaction else {
+            return
+        }
+        doErrorFree {
+            guard try Ruby.get("GC").call("respond_to?", args: [RbSymbol("compact")]).isTruthy else {
+                print("Skipping testCompactInStringBytes, platform does not support it")
+                return
+            }
+            let string = RbObject("short embedded string")
+            let fill = (0..<1000).map { RbObject("fill \($0)") }
+            let bytes = try string.withUnsafeStringBytes { buffer -> [UInt8] in
+                let before = buffer.baseAddress
+                try Ruby.gc.compact()
+                try Ruby.gc.start()
+                XCTAssertEqual(before, try string.withUnsafeStringBytes { $0.baseAddress })
+                return Array(buffer)
+            }
+            XCTAssertEqual("short embedded string", String(decoding: bytes, as: UTF8.self))
+            XCTAssertEqual("short embedded string", String(string))
+            XCTAssertEqual(1000, fill.count)
+
+            // Unlocked afterwards
+            try string.call("concat", args: ["!"])
+            XCTAssertEqual("short embedded string!", String(string))
+        }
+    }
+}
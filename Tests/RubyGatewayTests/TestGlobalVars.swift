@@ -92,4 +92,63 @@ class TestGlobalVars: XCTestCase {
             }
         }
     }
+
+    // readonly, Ruby reads stashed value
+    func testCachedReadonly() {
+        doErrorFree {
+            let gvarName = "$myCachedGlobal"
+
+            let gvar = try Ruby.defineGlobalVar(gvarName, cachedValue: "Fish")
+            try XCTAssertEqual("Fish", String(Ruby.eval(ruby: gvarName)))
+
+            gvar.value = "Bucket"
+            try Ruby.gc.start()
+            try XCTAssertEqual("Bucket", String(Ruby.eval(ruby: gvarName)))
+            XCTAssertEqual("Bucket", gvar.value)
+
+            doError {
+                let answer = try Ruby.eval(ruby: "\(gvarName) = 'Wife'")
+                XCTFail("Managed to assign to readonly gvar: \(answer)")
+            }
+            XCTAssertEqual("Bucket", gvar.value)
+
+            // Redefine, old one is disconnected
+            try Ruby.defineGlobalVar(gvarName, cachedValue: 12)
+            gvar.value = "Goat"
+            try XCTAssertEqual(12, Int(Ruby.eval(ruby: gvarName)))
+        }
+    }
+
+    // read/write, Ruby writes go through setter
+    func testCachedReadWrite() {
+        doErrorFree {
+            let gvarName = "$myCachedGlobal"
+            var setValues: [Int] = []
+
+            let gvar = try Ruby.defineGlobalVar(gvarName, cachedValue: 22) { newValue in
+                guard newValue >= 0 else {
+                    throw RbException(message: "Negative!")
+                }
+                setValues.append(newValue)
+            }
+
+            let _ = try Ruby.eval(ruby: "\(gvarName) = 44")
+            XCTAssertEqual([44], setValues)
+            XCTAssertEqual(44, gvar.value)
+            try XCTAssertEqual(44, Int(Ruby.eval(ruby: gvarName)))
+
+            doError {
+                let _ = try Ruby.eval(ruby: "\(gvarName) = -1")
+            }
+            doError {
+                let _ = try Ruby.eval(ruby: "\(gvarName) = 'fishcakes'")
+            }
+            XCTAssertEqual([44], setValues)
+            try XCTAssertEqual(44, Int(Ruby.eval(ruby: gvarName)))
+
+            gvar.value = 100
+            XCTAssertEqual([44], setValues)
+            try XCTAssertEqual(100, Int(Ruby.eval(ruby: gvarName)))
+        }
+    }
 }
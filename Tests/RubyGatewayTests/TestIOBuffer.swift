@@ -0,0 +1,99 @@
+//
+//  TestIOBuffer.swift
+//  RubyGatewayTests
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+import XCTest
+import RubyGateway
+
+/// Swift memory as IO::Buffers
+class TestIOBuffer: XCTestCase {
+
+    private var haveIOBuffer: Bool {
+        let version = Ruby.apiVersion
+        return version.0 > 3 || (version.0 == 3 && version.1 >= 1)
+    }
+
+    final class Memory {
+        let bytes: UnsafeMutableRawBufferPointer
+
+        init(_ string: String) {
+            bytes = .allocate(byteCount: string.utf8.count, alignment: 1)
+            bytes.copyBytes(from: string.utf8)
+        }
+
+        deinit {
+            bytes.deallocate()
+        }
+    }
+
+    func testReadOnly() {
+        guard haveIOBuffer else {
+            doError {
+                let memory = Memory("abc")
+                let buffer = try RbObject(ioBufferFor: UnsafeRawBufferPointer(memory.bytes), owner: memory)
+                XCTFail("Managed to make IO::Buffer on old Ruby: \(buffer)")
+            }
+            return
+        }
+        doErrorFree {
+            var memory: Memory? = Memory("Hello world")
+            weak var weakMemory = memory
+            let buffer = try RbObject(ioBufferFor: UnsafeRawBufferPointer(memory!.bytes), owner: memory)
+            memory = nil
+            XCTAssertNotNil(weakMemory)
+
+            try XCTAssertEqual("Hello", String(buffer.call("get_string", args: [0, 5])))
+            try XCTAssertEqual("world", String(buffer.call("slice", args: [6, 5]).call("get_string")))
+            try XCTAssertTrue(buffer.call("readonly?").isTruthy)
+            try XCTAssertTrue(buffer.call("external?").isTruthy)
+            doError {
+                try buffer.call("set_string", args: ["J"])
+            }
+            doError {
+                try buffer.call("free")
+            }
+        }
+    }
+
+    func testWritable() {
+        guard haveIOBuffer else {
+            return
+        }
+        doErrorFree {
+            let memory = Memory("Hello world")
+            let buffer = try RbObject(ioBufferFor: memory.bytes, owner: memory)
+            try buffer.call("set_string", args: ["J"])
+            XCTAssertEqual("Jello world", String(decoding: memory.bytes, as: UTF8.self))
+        }
+    }
+
+    func testInitializing() {
+        guard haveIOBuffer else {
+            return
+        }
+        doErrorFree {
+            let buffer = try RbObject(ioBufferCount: 4) { bytes in
+                bytes.copyBytes(from: [1, 2, 3, 4] as [UInt8])
+            }
+            try XCTAssertEqual(4, Int(buffer.call("size")))
+            try XCTAssertEqual(3, Int(buffer.call("get_value", args: [RbSymbol("U8"), 2])))
+            try XCTAssertTrue(buffer.call("readonly?").isTruthy)
+
+            let writable = try RbObject(ioBufferCount: 2, readOnly: false) { bytes in
+                bytes.copyBytes(from: [0, 0] as [UInt8])
+            }
+            try writable.call("set_value", args: [RbSymbol("U8"), 1, 9])
+            try XCTAssertEqual(9, Int(writable.call("get_value", args: [RbSymbol("U8"), 1])))
+
+            // Throwing body
+            doError {
+                let _ = try RbObject(ioBufferCount: 2) { _ in
+                    throw RbError.badParameter("Test")
+                }
+            }
+        }
+    }
+}
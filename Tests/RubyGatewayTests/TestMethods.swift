@@ -24,6 +24,7 @@ extension RbMethodArgsSpec {
         let expectedKeywords = mandatoryKeywords.union(optionalKeywordValues.keys).sorted()
         let actualKeywords = args.keyword.keys.sorted()
         XCTAssertEqual(expectedKeywords, actualKeywords)
+        XCTAssertEqual(keywordNames.count, args.keywordValues.count)
     }
 }
 
@@ -540,6 +541,43 @@ class TestMethods: XCTestCase {
         }
     }
 
+    // Keywords by position
+    func testKeywordValues() {
+        doErrorFree {
+            // def f(b:, a:, d: 4, c: 3)
+            let spec_f = RbMethodArgsSpec(mandatoryKeywords: ["b", "a"],
+                                          optionalKeywordValues: ["d": 4, "c": 3])
+            XCTAssertEqual(["a", "b", "c", "d"], spec_f.keywordNames)
+            XCTAssertEqual(1, spec_f.keywordIndex(of: "b"))
+            XCTAssertNil(spec_f.keywordIndex(of: "e"))
+
+            let bIndex = spec_f.keywordIndex(of: "b")!
+            let cIndex = spec_f.keywordIndex(of: "c")!
+            try Ruby.defineGlobalFunction("f", argsSpec: spec_f) { _, method in
+                method.checkArgs()
+                XCTAssertEqual(4, method.args.keywordValues.count)
+                return method.args.keywordValues[bIndex] * 10 + method.args.keywordValues[cIndex]
+            }
+
+            XCTAssertEqual(23, try Int(Ruby.call("f", kwArgs: ["a": 1, "b": 2])))
+            XCTAssertEqual(57, try Int(Ruby.call("f", kwArgs: ["c": 7, "b": 5, "a": 0, "d": 1])))
+
+            do {
+                try Ruby.call("f", kwArgs: ["a": 1])
+                XCTFail("Missing keyword not noticed")
+            } catch RbError.rubyException(let exn) {
+                XCTAssertTrue(exn.description.contains("Missing keyword argument: \"b\""))
+            }
+
+            do {
+                try Ruby.call("f", kwArgs: ["a": 1, "b": 2, "e": 5])
+                XCTFail("Unknown keyword not noticed")
+            } catch RbError.rubyException(let exn) {
+                XCTAssertTrue(exn.description.contains("Unknown keyword arguments: [\"e\"]"))
+            }
+        }
+    }
+
     // Ruby confusion corner case, internals
     func testBadArgsHash() {
         doError {
@@ -597,4 +635,148 @@ class TestMethods: XCTestCase {
             XCTAssertEqual(3, Logger.logCount)
         }
     }
+
+    // Borrowed-args methods
+    func testBorrowedArgs() {
+        doErrorFree {
+            let clazz = try Ruby.defineClass("BorrowedArgsTest")
+            var stored: RbObject? = nil
+
+            try clazz.defineMethod("process", argCount: 4) { method in
+                XCTAssertEqual(4, method.args.count)
+                XCTAssertEqual(.T_OBJECT, method.rubySelf.rubyType)
+                let count = try method.args[0].convert(to: Int.self)
+                let factor = try method.args[1].convert(to: Double.self)
+                let name = try method.args[2].convert(to: String.self)
+                XCTAssertTrue(try method.args[3].convert(to: Bool.self))
+                XCTAssertFalse(method.isBlockGiven)
+                stored = method.args[2].retained
+                return RbObject("\(name) \(Double(count) * factor)")
+            }
+
+            let obj = try clazz.call("new")
+            XCTAssertEqual("fish 5.0", try obj.call("process", args: [2, 2.5, "fish", true]))
+            try Ruby.get("GC").call("start")
+            XCTAssertEqual("fish", stored)
+
+            // Arity
+            doError {
+                let res = try obj.call("process", args: [1])
+                XCTFail("Managed to call with wrong arg count: \(res)")
+            }
+
+            // Conversion failure
+            doError {
+                let res = try obj.call("process", args: ["a", 1.0, "b", true])
+                XCTFail("Managed to convert string to int: \(res)")
+            }
+
+            // Any number, singleton
+            try clazz.defineSingletonMethod("count", argCount: nil) { method in
+                if method.isBlockGiven {
+                    try method.yieldBlock(args: [method.args.count])
+                }
+                return RbObject(method.args.retained)
+            }
+            XCTAssertEqual([], try clazz.call("count"))
+            XCTAssertEqual([1, "b"], try clazz.call("count", args: [1, "b"]))
+            var blockArg: RbObject? = nil
+            try clazz.call("count", args: [1, 2, 3]) { args in
+                blockArg = args[0]
+                return .nilObject
+            }
+            XCTAssertEqual(3, blockArg)
+        }
+    }
+
+    // Methods whose bodies give up the GVL
+    func testWithoutGvl() {
+        doErrorFree {
+            let clazz = try Ruby.defineClass("GvlReleaser")
+
+            try clazz.defineMethod("slow_upcase",
+                                   argsSpec: RbMethodArgsSpec(leadingMandatoryCount: 1),
+                                   prepare: { _, method in try method.args.mandatory[0].convert(to: String.self) },
+                                   withoutGvlBody: { (text: String) -> String in
+                                       XCTAssertTrue(RbThread.isRubyThread()) // still a Ruby thread, just no GVL
+                                       usleep(300_000)
+                                       return text.uppercased()
+                                   })
+
+            // Another thread gets to run while the method sleeps
+            try Ruby.eval(ruby: "$gvl_ticks = 0; $gvl_ticker = Thread.new { loop { $gvl_ticks += 1; sleep 0.01 } }")
+            let obj = try clazz.call("new")
+            XCTAssertEqual("HELLO", try obj.call("slow_upcase", args: ["hello"]))
+            try Ruby.eval(ruby: "$gvl_ticker.kill.join")
+            XCTAssertGreaterThan(Int(try Ruby.getGlobalVar("$gvl_ticks"))!, 5)
+
+            // Errors from the GVL-free part
+            try clazz.defineSingletonMethod("fail",
+                                            prepare: { _, _ in 0 },
+                                            withoutGvlBody: { (_: Int) -> Int in
+                                                throw RbError.badParameter("No GVL here")
+                                            })
+            do {
+                try clazz.call("fail")
+                XCTFail("Managed to call failing method")
+            } catch RbError.rubyException(let exn) {
+                XCTAssertTrue(exn.exception.description.contains("No GVL here"))
+            }
+
+            try Ruby.defineGlobalFunction("gvl_double",
+                                          argsSpec: RbMethodArgsSpec(leadingMandatoryCount: 1),
+                                          prepare: { _, method in try method.args.mandatory[0].convert(to: Int.self) },
+                                          withoutGvlBody: { $0 * 2 })
+            XCTAssertEqual(42, try Ruby.call("gvl_double", args: [21]))
+        }
+    }
+
+    // GVL-free method bodies can be interrupted
+    func testWithoutGvlInterrupt() {
+        doErrorFree {
+            let condition = NSCondition()
+            var running = false
+            var cancelled = false
+            var finished = false
+
+            try Ruby.defineGlobalFunction("gvl_spin",
+                                          unblocking: .custom({
+                                              condition.lock()
+                                              cancelled = true
+                                              condition.unlock()
+                                          }),
+                                          prepare: { _, _ in 0 },
+                                          withoutGvlBody: { (_: Int) -> Int in
+                                              condition.lock()
+                                              running = true
+                                              condition.unlock()
+                                              // CPU-bound, checks for cancellation
+                                              while true {
+                                                  condition.lock()
+                                                  defer { condition.unlock() }
+                                                  if cancelled { break }
+                                              }
+                                              finished = true
+                                              return 1
+                                          })
+
+            let thread = try Ruby.eval(ruby: "Thread.new { Thread.current.report_on_exception = false; gvl_spin }")
+            func isRunning() -> Bool {
+                condition.lock()
+                defer { condition.unlock() }
+                return running
+            }
+            while !isRunning() {
+                try Ruby.call("sleep", args: [0.05])
+            }
+            try thread.call("raise", args: ["Stop spinning"])
+            do {
+                try thread.call("join")
+                XCTFail("Thread not interrupted")
+            } catch RbError.rubyException(let exn) {
+                XCTAssertTrue(exn.description.contains("Stop spinning"))
+            }
+            XCTAssertTrue(finished)
+        }
+    }
 }
@@ -0,0 +1,88 @@
+//
+//  TestMetrics.swift
+//  RubyGatewayTests
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+import XCTest
+import RubyGateway
+
+/// Metrics and tracing hooks
+class TestMetrics: XCTestCase {
+
+    final class Tracer: RbTracer {
+        var began: [(RbMetrics.Event, String?)] = []
+        var ended: [(RbMetrics.Event, String?)] = []
+
+        func began(_ event: RbMetrics.Event, name: String?) {
+            began.append((event, name))
+        }
+
+        func ended(_ event: RbMetrics.Event, name: String?, nanoseconds: UInt64) {
+            ended.append((event, name))
+        }
+    }
+
+    override func tearDown() {
+        RbMetrics.isEnabled = false
+        RbMetrics.tracer = nil
+        RbMetrics.reset()
+    }
+
+    // Nothing collected while off
+    func testDisabled() {
+        doErrorFree {
+            RbMetrics.reset()
+            try Ruby.call("rand")
+            XCTAssertTrue(RbMetrics.snapshot().values.allSatisfy { $0.count == 0 })
+        }
+    }
+
+    // Counts and histograms
+    func testCounts() {
+        doErrorFree {
+            let obj = try Ruby.eval(ruby: "%w(a b c)")
+            RbMetrics.reset()
+            RbMetrics.isEnabled = true
+            for _ in 0..<10 {
+                let _ = try obj.call("first")
+            }
+            try obj.call("each") { _ in .nilObject }
+            RbThread.callWithoutGvl {}
+            RbMetrics.isEnabled = false
+
+            let stats = RbMetrics.snapshot()
+            XCTAssertEqual(11, stats[.methodCall]!.count)
+            XCTAssertGreaterThanOrEqual(stats[.protectedCall]!.count, 11)
+            XCTAssertEqual(3, stats[.swiftBlock]!.count)
+            XCTAssertEqual(1, stats[.gvlWait]!.count)
+            XCTAssertGreaterThan(stats[.objectRetain]!.count, 0)
+
+            let calls = stats[.methodCall]!
+            XCTAssertEqual(calls.count, calls.buckets.reduce(0, +))
+            XCTAssertGreaterThan(calls.totalNanoseconds, 0)
+            XCTAssertLessThanOrEqual(calls.percentile(50), calls.percentile(99))
+            XCTAssertLessThanOrEqual(calls.percentile(99), calls.maxNanoseconds)
+        }
+    }
+
+    // Tracer spans with names
+    func testTracer() {
+        doErrorFree {
+            let obj = try Ruby.eval(ruby: "Object.new")
+            try obj.defineSingletonMethod("swift_method") { _, _ in .nilObject }
+
+            let tracer = Tracer()
+            RbMetrics.tracer = tracer
+            RbMetrics.isEnabled = true
+            try obj.call("swift_method")
+            RbMetrics.isEnabled = false
+
+            XCTAssertEqual(tracer.began.count, tracer.ended.count)
+            XCTAssertTrue(tracer.began.contains { $0.0 == .methodCall && $0.1 == "swift_method" })
+            XCTAssertTrue(tracer.began.contains { $0.0 == .swiftMethod && $0.1 == "swift_method" })
+            XCTAssertTrue(tracer.began.contains { $0.0 == .protectedCall && $0.1 == nil })
+        }
+    }
+}
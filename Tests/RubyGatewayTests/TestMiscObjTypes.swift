@@ -77,6 +77,9 @@ class TestMiscObjTypes: XCTestCase {
         XCTAssertEqual("RbSymbol(name)", sym.description)
         let obj = sym.rubyObject
         XCTAssertEqual(.T_SYMBOL, obj.rubyType)
+        XCTAssertEqual(obj, sym.rubyObject)
+        XCTAssertEqual(RbSymbol("name"), sym)
+        XCTAssertNotEqual(RbSymbol("other"), sym)
 
         if let backSym = RbSymbol(obj) {
             XCTFail("Managed to create symbol from object: \(backSym)")
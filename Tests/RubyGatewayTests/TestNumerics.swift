@@ -23,6 +23,44 @@ class TestNumerics: XCTestCase {
         }
     }
 
+    /// Swift versions of the fixnum and flonum tagging
+    func testImmediateTagging() {
+        XCTAssertTrue(Ruby.softSetup())
+        let ints = [0, 1, -1, RUBY_FIXNUM_MAX, RUBY_FIXNUM_MIN, RUBY_FIXNUM_MAX + 1, RUBY_FIXNUM_MIN - 1, Int.max, Int.min]
+        ints.forEach { int in
+            let value = rb_long2num_inline(int)
+            XCTAssertEqual(RB_FIXABLE(int), RB_FIXNUM_P(value))
+            XCTAssertFalse(RB_FLONUM_P(value))
+            if RB_FIXABLE(int) {
+                XCTAssertEqual(value, RB_LONG2FIX(int))
+                XCTAssertEqual(int, RB_FIX2LONG(value))
+                XCTAssertTrue(RB_SPECIAL_CONST_P(value))
+            }
+        }
+        let specials: [RbObject] = [.nilObject, true, false, RbSymbol("sym").rubyObject]
+        specials.forEach { obj in
+            XCTAssertTrue(RB_SPECIAL_CONST_P(obj.withRubyValue { $0 }))
+        }
+        XCTAssertFalse(RB_SPECIAL_CONST_P(RbObject("string").withRubyValue { $0 }))
+
+        let doubles = [0.0, -0.0, 1.0, -1.5, 0.1, 1e300, -1e-300, 1.72723e-77, Double.infinity, Double.pi]
+        doubles.forEach { dbl in
+            let value = rb_float_new(dbl)
+            XCTAssertEqual(RB_FLONUM_P(value), RB_DBL2FLONUM(dbl) != nil, "\(dbl)")
+            if RB_FLONUM_P(value) {
+                XCTAssertEqual(value, RB_DBL2FLONUM(dbl))
+                XCTAssertEqual(dbl, RB_FLONUM2DBL(value))
+            }
+            XCTAssertEqual(dbl, Double(RbObject(dbl)))
+        }
+
+        XCTAssertEqual(3, Int(RbObject(3.7)))
+        XCTAssertEqual(-3, Int(RbObject(-3.7)))
+        XCTAssertEqual(12.0, Double(RbObject(12)))
+        XCTAssertNil(Int(RbObject(Double.nan)))
+        XCTAssertNil(UInt(RbObject(-1)))
+    }
+
     /// Again, UInt
     func testUIntNumRoundtrip() {
         let values = [UInt.min, 0, UInt.max]
@@ -39,6 +39,35 @@ class TestOperators: XCTestCase {
         XCTAssertEqual(bVal.magnitude, UInt(bValObj.magnitude))
     }
 
+    /// Fixnum and flonum operators done in Swift agree with Ruby
+    func testImmediateArithmetic() {
+        doErrorFree {
+            let fixnumMax = (1 << 62) - 1
+            let values: [RbObject] = [0, 7, -7, 2, -3, 3.5, -0.5, 0.1, -0.0, 1e300,
+                                      RbObject(Double.infinity),
+                                      RbObject(fixnumMax), RbObject(-fixnumMax - 1),
+                                      RbObject(Int.max), RbObject(Int.min)]
+            let ops: [(String, (RbObject, RbObject) -> RbObject)] = [
+                ("+", { $0 + $1 }), ("-", { $0 - $1 }), ("*", { $0 * $1 }),
+                ("/", { $0 / $1 }), ("%", { $0 % $1 })
+            ]
+            for lhs in values {
+                for rhs in values {
+                    for (name, op) in ops {
+                        if (name == "/" || name == "%") && rhs == 0 {
+                            continue
+                        }
+                        let expected = try lhs.call(name, args: [rhs])
+                        let actual = op(lhs, rhs)
+                        XCTAssertEqual(expected.description, actual.description, "\(lhs) \(name) \(rhs)")
+                        XCTAssertEqual(try expected.call("class"), try actual.call("class"))
+                    }
+                }
+                XCTAssertEqual(try lhs.call("-@").description, (-lhs).description)
+            }
+        }
+    }
+
     func testMutating() {
         var aVal = 3.4
         let bVal = 5.8
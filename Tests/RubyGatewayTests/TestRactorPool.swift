@@ -0,0 +1,80 @@
+//
+//  TestRactorPool.swift
+//  RubyGatewayTests
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+import XCTest
+import RubyGateway
+
+/// Ractor pools
+class TestRactorPool: XCTestCase {
+
+    private var haveRactors: Bool {
+        Ruby.apiVersion.0 >= 3
+    }
+
+    func testMap() {
+        guard haveRactors else {
+            return
+        }
+        doErrorFree {
+            let pool = try RbRactorPool(size: 4, ruby: "sleep(n == 0 ? 0.5 : 0); n * 2", inputName: "n")
+            XCTAssertEqual(4, pool.size)
+
+            let results = try pool.map(Array(0..<20))
+            XCTAssertEqual((0..<20).map { RbObject($0 * 2) }, results)
+            XCTAssertEqual([], try pool.map([]))
+
+            // Copied inputs
+            let strings = try pool.map(["a", "b"])
+            XCTAssertEqual(["aa", "bb"], strings.map { String($0) })
+
+            pool.shutdown()
+            doError {
+                let results = try pool.map([1])
+                XCTFail("Managed to use pool after shutdown: \(results)")
+            }
+        }
+    }
+
+    func testErrors() {
+        guard haveRactors else {
+            doError {
+                let pool = try RbRactorPool(size: 1, ruby: "input")
+                XCTFail("Managed to create pool without Ractors: \(pool)")
+            }
+            return
+        }
+        doErrorFree {
+            doError {
+                let pool = try RbRactorPool(size: 0, ruby: "input")
+                XCTFail("Managed to create empty pool: \(pool)")
+            }
+            doError {
+                let pool = try RbRactorPool(size: 1, ruby: "input", inputName: "Input")
+                XCTFail("Managed to create pool with bad input name: \(pool)")
+            }
+
+            let pool = try RbRactorPool(size: 2, ruby: "Integer(input)")
+            do {
+                let results = try pool.map(["1", "x", "3"])
+                XCTFail("Managed to convert bad input: \(results)")
+            } catch RbError.rubyException(let exn) {
+                XCTAssertTrue(exn.description.contains("job 1 failed"))
+            }
+            // Pool still works
+            XCTAssertEqual([4], try pool.map(["4"]))
+
+            // Input that can't be sent leaves other jobs running: their
+            // results mustn't turn up in the next call.
+            let thread = try Ruby.get("Thread").call("current")
+            doError {
+                let results = try pool.map(["1", thread, "3", "4"])
+                XCTFail("Managed to send a thread: \(results)")
+            }
+            XCTAssertEqual([10, 20, 30], try pool.map(["10", "20", "30"]))
+        }
+    }
+}
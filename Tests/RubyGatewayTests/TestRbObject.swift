@@ -104,6 +104,47 @@ class TestRbObject: XCTestCase {
         }
     }
 
+    // hashable without calling Ruby
+    func testFastHashing() {
+        doErrorFree {
+            let str1 = RbObject("key")
+            let str2 = try str1.call("dup")
+            XCTAssertTrue(str1 == str2)
+            XCTAssertEqual(str1.hashValue, str2.hashValue)
+            XCTAssertFalse(str1 == RbObject(RbSymbol("key")))
+
+            let dynSym = try Ruby.eval(ruby: "('dyn' + '123sym').to_sym")
+            XCTAssertTrue(dynSym == RbObject(RbSymbol("dyn123sym")))
+            XCTAssertEqual(dynSym.hashValue, RbObject(RbSymbol("dyn123sym")).hashValue)
+
+            let dict: [RbObject: Int] = [str1: 1, RbObject(RbSymbol("key")): 2, 3: 3, .nilObject: 4]
+            XCTAssertEqual(1, dict[str2])
+            XCTAssertEqual(2, dict[RbObject(RbSymbol("key"))])
+            XCTAssertEqual(3, dict[RbObject(3)])
+            XCTAssertEqual(4, dict[.nilObject])
+
+            // Still asks Ruby
+            XCTAssertTrue(RbObject(1) == RbObject(1.0))
+            let nan = RbObject(Double.nan)
+            XCTAssertFalse(nan == nan)
+            let array1: RbObject = [1, 2]
+            XCTAssertTrue(array1 == [1, 2])
+            XCTAssertEqual(array1.hashValue, RbObject([1, 2]).hashValue)
+
+            // Frozen strings can't change
+            let frozen = try Ruby.eval(ruby: "'frozen'.freeze")
+            let frozenHash = frozen.hashValue
+            XCTAssertEqual(frozenHash, RbObject(frozen).hashValue)
+            XCTAssertEqual(frozenHash, RbObject("frozen").hashValue)
+
+            // Mutable ones can
+            let mutable = RbObject("mutable")
+            let mutableHash = mutable.hashValue
+            try mutable.call("concat", args: ["!"])
+            XCTAssertNotEqual(mutableHash, mutable.hashValue)
+        }
+    }
+
     // comparable
     func testComparable() {
         let objneg = RbObject(Int.min)
@@ -215,6 +256,52 @@ class TestRbObject: XCTestCase {
         }
     }
 
+    // Test lots of RbObjects spanning several root table slabs, released out of order
+    func testManyObjectsGc() {
+        doErrorFree {
+            let count = 5000
+            var objects = (0..<count).map { RbObject("string \($0)") }
+            try runGC()
+            XCTAssertEqual("string 1234", String(objects[1234]))
+
+            // Release every other one + reuse the slots
+            for i in stride(from: 0, to: count, by: 2) {
+                objects[i] = RbObject([i])
+            }
+            try runGC()
+            for i in 0..<count {
+                if i % 2 == 0 {
+                    XCTAssertEqual([i], Array<Int>(objects[i]))
+                } else {
+                    XCTAssertEqual("string \(i)", String(objects[i]))
+                }
+            }
+        }
+    }
+
+    // Test copies sharing a root keep the object alive until the last goes
+    func testSharedCopiesGc() {
+        doErrorFree {
+            var copies: [RbObject] = []
+            do {
+                let original = RbObject("shared string")
+                copies = (0..<10).map { _ in RbObject(original) }
+            }
+            try runGC()
+            copies.removeFirst(9)
+            try runGC()
+            XCTAssertEqual("shared string", String(copies[0]))
+
+            // Special constants have no root
+            let immediates: [RbObject] = [.nilObject, true, 42, RbSymbol("sym").rubyObject]
+            let immediateCopies = immediates.map { RbObject($0) }
+            try runGC()
+            XCTAssertEqual(immediates, immediateCopies)
+            XCTAssertTrue(immediateCopies[0].isNil)
+            XCTAssertEqual(42, Int(immediateCopies[2]))
+        }
+    }
+
     // Test Ruby stack snooping GC works
     // Xcode 11.4 - give up on trying to make this work.
     func ignore_testStackGc() {
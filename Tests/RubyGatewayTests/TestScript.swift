@@ -0,0 +1,92 @@
+//
+//  TestScript.swift
+//  RubyGatewayTests
+//
+//  Distributed under the MIT license, see LICENSE
+//
+
+import XCTest
+import RubyGateway
+
+/// Compiled scripts and the eval cache
+class TestScript: XCTestCase {
+
+    func testCompile() {
+        doErrorFree {
+            let script = try Ruby.compile(ruby: "[1, 2, 3].sum")
+            XCTAssertEqual("[1, 2, 3].sum", script.source)
+            XCTAssertEqual([], script.localNames)
+            XCTAssertEqual(6, Int(try script.run()))
+            XCTAssertEqual(6, Int(try script.run()))
+
+            // runs at the top level
+            try Ruby.compile(ruby: "def script_defined_method; 22; end").run()
+            XCTAssertEqual(22, Int(try Ruby.call("script_defined_method")))
+        }
+    }
+
+    func testLocals() {
+        doErrorFree {
+            let script = try Ruby.compile(ruby: "return :big if a > 10\n a + b",
+                                          localNames: ["a", "b"])
+            XCTAssertEqual(["a", "b"], script.localNames)
+            XCTAssertEqual(3, Int(try script.run(locals: [1, 2])))
+            XCTAssertEqual("x1", String(try script.run(locals: ["x", "1"])))
+            XCTAssertEqual("big", String(try script.run(locals: [11, 0])))
+        }
+    }
+
+    func testErrors() {
+        doErrorFree {
+            do {
+                let script = try Ruby.compile(ruby: "1 +")
+                XCTFail("Managed to compile bad script: \(script)")
+            } catch RbError.rubyException(let exn) {
+                XCTAssertTrue(exn.description.contains("SyntaxError"))
+            }
+
+            do {
+                let script = try Ruby.compile(ruby: "a", localNames: ["Fred"])
+                XCTFail("Managed to compile with bad local name: \(script)")
+            } catch RbError.badIdentifier(let type, let id) {
+                XCTAssertEqual("local var", type)
+                XCTAssertEqual("Fred", id)
+            }
+
+            let script = try Ruby.compile(ruby: "a", localNames: ["a"])
+            do {
+                try script.run()
+                XCTFail("Managed to run script without locals")
+            } catch RbError.badParameter(let msg) {
+                XCTAssertTrue(msg.contains("1 locals"))
+            }
+
+            do {
+                try Ruby.compile(ruby: "raise 'oops'").run()
+                XCTFail("Managed to run raising script")
+            } catch RbError.rubyException(let exn) {
+                XCTAssertEqual("oops", exn.exception.description)
+            }
+        }
+    }
+
+    func testEvalCache() {
+        doErrorFree {
+            let oldCapacity = Ruby.evalCacheCapacity
+            XCTAssertEqual(0, oldCapacity)
+            defer { Ruby.evalCacheCapacity = oldCapacity }
+
+            Ruby.evalCacheCapacity = 2
+            try Ruby.eval(ruby: "$script_count = 0")
+            for _ in 0..<3 {
+                try Ruby.eval(ruby: "$script_count += 1")
+                try Ruby.eval(ruby: "$script_count += 10")
+                try Ruby.eval(ruby: "$script_count += 100")
+            }
+            XCTAssertEqual(333, Int(try Ruby.eval(ruby: "$script_count")))
+
+            Ruby.evalCacheCapacity = 0
+            XCTAssertEqual(333, Int(try Ruby.eval(ruby: "$script_count")))
+        }
+    }
+}
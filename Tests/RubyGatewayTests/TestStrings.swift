@@ -77,4 +77,70 @@ class TestStrings: XCTestCase {
         let obj: RbObject = "test string"
         XCTAssertEqual("test string", String(obj))
     }
+
+    func testBigString() {
+        doTestRoundTrip(String(repeating: "abë🐽", count: 100_000))
+    }
+
+    func testInvalidUtf8() {
+        doErrorFree {
+            let binary = try Ruby.eval(ruby: "\"ab\\xff\\xfecd\".b")
+            XCTAssertEqual(6, Int(try binary.call("length")))
+            XCTAssertNil(String(binary))
+        }
+    }
+
+    func testStringBytes() {
+        doErrorFree {
+            let obj = RbObject("abë\0d")
+            let bytes = try obj.withUnsafeStringBytes { Array($0) }
+            XCTAssertEqual(Array("abë\0d".utf8), bytes)
+
+            // Locked while borrowed, nesting OK
+            try obj.withUnsafeStringBytes { outer in
+                try obj.withUnsafeStringBytes { inner in
+                    XCTAssertEqual(outer.baseAddress, inner.baseAddress)
+                }
+                doError {
+                    try obj.call("<<", args: ["more"])
+                }
+            }
+            // Unlocked afterwards
+            try obj.call("<<", args: ["more"])
+            XCTAssertEqual("abë\0dmore", String(obj))
+
+            // Frozen
+            let frozen = try RbObject("frozen").call("freeze")
+            XCTAssertEqual(6, try frozen.withUnsafeStringBytes { $0.count })
+
+            // Conversion
+            XCTAssertEqual(3, try RbObject(123).withUnsafeStringBytes { $0.count })
+        }
+    }
+
+    func testInterned() {
+        doErrorFree {
+            let first = RbObject(interned: "status ok")
+            let second = RbObject(interned: "status ok")
+            XCTAssertEqual("status ok", String(first))
+            try XCTAssertTrue(first.call("frozen?").isTruthy)
+            try XCTAssertTrue(first.call("equal?", args: [second]).isTruthy)
+
+            // Same object as Ruby's deduplicated string
+            let ruby = try RbObject("status ok").call("-@")
+            try XCTAssertTrue(first.call("equal?", args: [ruby]).isTruthy)
+
+            doError {
+                try first.call("<<", args: ["more"])
+            }
+
+            // Not cached, still shared
+            let capacity = Ruby.internedStringCacheCapacity
+            defer { Ruby.internedStringCacheCapacity = capacity }
+            Ruby.internedStringCacheCapacity = 0
+            let uncached = RbObject(interned: "status ok")
+            try XCTAssertTrue(first.call("equal?", args: [uncached]).isTruthy)
+            XCTAssertEqual("", String(RbObject(interned: "")))
+        }
+    }
 }
@@ -121,4 +121,102 @@ class TestThreads: XCTestCase {
             XCTAssertTrue(slept)
         }
     }
+
+    // Executor runs work from other threads
+    func testExecutor() {
+        doErrorFree {
+            let executor = RbExecutor()
+            var results: [Int] = []
+
+            Thread.detachNewThread {
+                XCTAssertFalse(RbThread.isRubyThread())
+                executor.submit {
+                    XCTAssertTrue(RbThread.isRubyThread())
+                    results.append(Int(try! Ruby.eval(ruby: "1 + 1"))!)
+                }
+                executor.submit(batch: (0..<3).map { n in { results.append(n) } })
+                executor.stop()
+            }
+            try executor.run()
+            XCTAssertEqual([2, 0, 1, 2], results)
+        }
+    }
+
+    // Executor lets other Ruby threads run while it waits
+    func testExecutorReleasesGvl() {
+        doErrorFree {
+            let executor = RbExecutor()
+            var rubyThreadRan = false
+
+            let threadObj = RbThread.create {
+                rubyThreadRan = true
+                executor.stop()
+            }!
+            try executor.run()
+            try threadObj.call("join")
+            XCTAssertTrue(rubyThreadRan)
+        }
+    }
+
+    // Executor can be interrupted while waiting
+    func testExecutorInterrupt() {
+        doErrorFree {
+            let executor = RbExecutor()
+            var executorError: Error? = nil
+
+            let threadObj = RbThread.create {
+                do {
+                    try executor.run()
+                } catch {
+                    executorError = error
+                }
+            }!
+            try Ruby.call("sleep", args: [0.2])
+            try threadObj.call("raise", args: ["Stop waiting"])
+            try? threadObj.call("join")
+
+            guard let error = executorError else {
+                XCTFail("Executor not interrupted")
+                return
+            }
+            XCTAssertTrue("\(error)".contains("Stop waiting"))
+
+            // Still usable, work is kept for the next run
+            var ranLater = false
+            executor.submit { ranLater = true }
+            executor.stop()
+            try executor.run()
+            XCTAssertTrue(ranLater)
+        }
+    }
+
+    #if compiler(>=5.5) && canImport(_Concurrency)
+    // Async calls
+    func testExecutorAsync() {
+        guard #available(macOS 10.15, *) else {
+            return
+        }
+        doErrorFree {
+            let executor = RbExecutor()
+            var total: Int? = nil
+            var batchResults: [Int?] = []
+
+            Task.detached {
+                total = try await executor.call {
+                    try Int(Ruby.eval(ruby: "[1, 2, 3].sum"))
+                }
+                let results = await executor.call(batch: [
+                    { 1 },
+                    { throw RbError.badType("Nope") },
+                    { try Int(Ruby.eval(ruby: "3"))! }
+                ])
+                batchResults = results.map { try? $0.get() }
+                executor.stop()
+            }
+            try executor.run()
+            XCTAssertEqual(6, total)
+            XCTAssertEqual([1, nil, 3], batchResults)
+        }
+    }
+    #endif
 }
@@ -73,6 +73,91 @@ class TestVM: XCTestCase {
         }
     }
 
+    /// batch 'require'
+    func testRequireFilenames() {
+        doErrorFree {
+            let rcs = try Ruby.require(filenames: ["ostruct", Helpers.fixturePath("nesting.rb"), "ostruct"])
+            XCTAssertEqual(3, rcs.count)
+            XCTAssertFalse(rcs[2])
+            XCTAssertEqual(1, try Int(Ruby.eval(ruby: "Outer::OUTER_CONSTANT")))
+
+            do {
+                let rcs = try Ruby.require(filenames: ["not-ruby", "also-not-ruby"])
+                XCTFail("vm.require unexpectedly passed, rcs=\(rcs)")
+            } catch RbError.rubyException(let exn) {
+                XCTAssertTrue(exn.description.contains("not-ruby"))
+                XCTAssertFalse(exn.description.contains("also-not-ruby"))
+            }
+        }
+    }
+
+    /// compiled file cache
+    func testLoadCache() {
+        doErrorFree {
+            let tmpDir = URL(fileURLWithPath: NSTemporaryDirectory())
+                .appendingPathComponent("RubyGatewayTests-\(getpid())").path
+            let cacheDir = tmpDir + "/cache"
+            let scriptPath = tmpDir + "/cached.rb"
+            defer {
+                Ruby.disableLoadCache()
+                try? FileManager.default.removeItem(atPath: tmpDir)
+            }
+            try FileManager.default.createDirectory(atPath: tmpDir, withIntermediateDirectories: true)
+
+            XCTAssertNil(Ruby.loadCacheDirectory)
+            try Ruby.enableLoadCache(directory: cacheDir)
+            XCTAssertEqual(cacheDir, Ruby.loadCacheDirectory)
+
+            // First load compiles and saves
+            try "$load_cache_test = 1\n".write(toFile: scriptPath, atomically: false, encoding: .utf8)
+            try Ruby.load(filename: scriptPath)
+            XCTAssertEqual(1, try Int(Ruby.getGlobalVar("$load_cache_test")))
+            let iseqPath = cacheDir + scriptPath + ".iseq"
+            XCTAssertTrue(FileManager.default.fileExists(atPath: iseqPath))
+
+            // The cache file is replaced, so a new inode, only when compiling
+            func iseqFileNumber() throws -> Int {
+                (try FileManager.default.attributesOfItem(atPath: iseqPath)[.systemFileNumber] as! NSNumber).intValue
+            }
+            let compiledFileNumber = try iseqFileNumber()
+
+            // Second load uses cache
+            try Ruby.setGlobalVar("$load_cache_test", newValue: 0)
+            try Ruby.load(filename: scriptPath)
+            XCTAssertEqual(1, try Int(Ruby.getGlobalVar("$load_cache_test")))
+            XCTAssertEqual(compiledFileNumber, try iseqFileNumber())
+
+            // Touched file is recompiled
+            let touched = Date(timeIntervalSinceNow: -3600)
+            try FileManager.default.setAttributes([.modificationDate: touched], ofItemAtPath: scriptPath)
+            try Ruby.load(filename: scriptPath)
+            XCTAssertEqual(1, try Int(Ruby.getGlobalVar("$load_cache_test")))
+            let touchedFileNumber = try iseqFileNumber()
+            XCTAssertNotEqual(compiledFileNumber, touchedFileNumber)
+
+            // Changed file is recompiled
+            try "$load_cache_test = 22\n".write(toFile: scriptPath, atomically: false, encoding: .utf8)
+            try Ruby.load(filename: scriptPath)
+            XCTAssertEqual(22, try Int(Ruby.getGlobalVar("$load_cache_test")))
+            XCTAssertNotEqual(touchedFileNumber, try iseqFileNumber())
+
+            // Errors still reported
+            try "def (\n".write(toFile: scriptPath, atomically: false, encoding: .utf8)
+            do {
+                try Ruby.load(filename: scriptPath)
+                XCTFail("Managed to load unloadable file")
+            } catch RbError.rubyException(let exn) {
+                XCTAssertTrue(exn.description.contains("SyntaxError:"))
+            }
+
+            Ruby.disableLoadCache()
+            XCTAssertNil(Ruby.loadCacheDirectory)
+            try "$load_cache_test = 333\n".write(toFile: scriptPath, atomically: false, encoding: .utf8)
+            try Ruby.load(filename: scriptPath)
+            XCTAssertEqual(333, try Int(Ruby.getGlobalVar("$load_cache_test")))
+        }
+    }
+
     /// 'load' works
     func testLoad() {
         doErrorFree {
@@ -248,6 +333,27 @@ class TestVM: XCTestCase {
         }
     }
 
+    /// ID cache, including growth through several snapshots
+    func testIDs() {
+        doErrorFree {
+            let names = (0..<100).map { "test_id_\($0)" }
+            let ids = try names.map { try Ruby.getID(for: $0) }
+            XCTAssertEqual(Set(ids).count, names.count)
+            try zip(names, ids).forEach { name, id in
+                XCTAssertEqual(id, try Ruby.getID(for: name))
+            }
+
+            let preloadNames = ["test_preload_a", "test_preload_b", names[3]]
+            try Ruby.preloadIDs(for: preloadNames)
+            XCTAssertEqual(ids[3], try Ruby.getID(for: names[3]))
+
+            let sym = try Ruby.eval(ruby: ":test_preload_a")
+            try sym.withSymbolId { symId in
+                XCTAssertEqual(symId, try Ruby.getID(for: "test_preload_a"))
+            }
+        }
+    }
+
     /// ARGV
     func testArgv() {
         doErrorFree {